@@ -0,0 +1,20 @@
+#version 450
+
+uniform vec3 diffuseMaterial;
+
+in vec3 vPosition;
+in vec3 vNormal;
+
+out vec4 fragColor;
+
+void main()
+{
+	// Headlight shading, the light sits at the camera
+	vec3 N = normalize(vNormal);
+	vec3 V = normalize(-vPosition);
+
+	float diffuse = max(dot(N, V), 0.0);
+	float specular = pow(diffuse, 32.0);
+
+	fragColor = vec4(diffuseMaterial * (0.2 + 0.8 * diffuse) + vec3(0.3 * specular), 1.0);
+}
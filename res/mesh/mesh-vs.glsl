@@ -0,0 +1,19 @@
+#version 450
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+
+uniform mat4 modelViewMatrix;
+uniform mat4 projectionMatrix;
+uniform mat3 normalMatrix;
+
+out vec3 vPosition;
+out vec3 vNormal;
+
+void main()
+{
+	vec4 viewPosition = modelViewMatrix * vec4(position, 1.0);
+	vPosition = viewPosition.xyz;
+	vNormal = normalMatrix * normal;
+	gl_Position = projectionMatrix * viewPosition;
+}
@@ -19,6 +19,8 @@ layout(std140, binding = 7) buffer VertexBuffer
     Cell cells[];
 };
 
+out float vWeight;
+
 void main() {
     uint prevCount = atomicExchange(cells[gridIndex].count, 0);
     if (prevCount == 0)
@@ -29,4 +31,5 @@ void main() {
     pos.w = uintBitsToFloat(id);
 
     gl_Position = pos;
+    vWeight = 1.0;
 }
\ No newline at end of file
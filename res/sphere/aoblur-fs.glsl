@@ -10,7 +10,12 @@
 const float KERNEL_RADIUS = 5;
   
 uniform float sharpness = 32.0;
-uniform vec2  offset; // either set x to 1/width or y to 1/height
+uniform ivec2 direction; // either (1,0) or (0,1)
+// The ambient target may have a reduced resolution, its pixels take the depth of the surface pixel at the center of
+// their block like in aosample-fs.glsl
+uniform int resolutionDivisor = 1;
+uniform ivec2 ambientSize;
+uniform ivec2 framebufferSize;
 
 layout(binding=0) uniform sampler2D normalTexture;
 layout(binding=1) uniform sampler2D ambientTexture;
@@ -22,10 +27,16 @@ out vec4 fragColor;
 
 //-------------------------------------------------------------------------
 
-vec4 BlurFunction(vec2 uv, float r, vec4 centerNormal, inout float w_total)
+ivec2 surfacePixel(ivec2 pixel)
 {
-  vec4 value = texture2D( ambientTexture, uv );
-  vec4 normal = texture2D( normalTexture, uv );
+  return min(pixel * resolutionDivisor + resolutionDivisor / 2, framebufferSize - 1);
+}
+
+vec4 BlurFunction(ivec2 pixel, float r, vec4 centerNormal, inout float w_total)
+{
+  pixel = clamp(pixel, ivec2(0), ambientSize - 1);
+  vec4 value = texelFetch( ambientTexture, pixel, 0 );
+  vec4 normal = texelFetch( normalTexture, surfacePixel(pixel), 0 );
   
   const float BlurSigma = float(KERNEL_RADIUS) * 0.5;
   const float BlurFalloff = 1.0 / (2.0*BlurSigma*BlurSigma);
@@ -39,25 +50,22 @@ vec4 BlurFunction(vec2 uv, float r, vec4 centerNormal, inout float w_total)
 
 void main()
 {
-  vec4  ambient = texelFetch( ambientTexture, ivec2(gl_FragCoord.xy),0);
-  vec4  normal = texelFetch( normalTexture, ivec2(gl_FragCoord.xy),0);
+  ivec2 pixel = ivec2(gl_FragCoord.xy);
+  vec4  ambient = texelFetch( ambientTexture, pixel,0);
+  vec4  normal = texelFetch( normalTexture, surfacePixel(pixel),0);
   normal.w = min(1.0,normal.w);
   
   vec4 total = ambient;
   float w_total = 1.0;
 
-  vec2 texCoord = (gFragmentPosition.xy+1.0)*0.5;
-  
-  for (float r = 1; r <= KERNEL_RADIUS; ++r)
+  for (int r = 1; r <= int(KERNEL_RADIUS); ++r)
   {
-    vec2 uv = texCoord + offset * (r+0.5);
-    total += BlurFunction(uv, r, normal, w_total);  
+    total += BlurFunction(pixel + direction * r, float(r), normal, w_total);  
   }
   
-  for (float r = 1; r <= KERNEL_RADIUS; ++r)
+  for (int r = 1; r <= int(KERNEL_RADIUS); ++r)
   {
-    vec2 uv = texCoord - offset * (r+0.5);
-    total += BlurFunction(uv, r, normal, w_total);  
+    total += BlurFunction(pixel - direction * r, float(r), normal, w_total);  
   }
   
   fragColor = total / max(w_total,0.0001);
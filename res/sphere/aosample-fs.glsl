@@ -6,6 +6,8 @@
 // http://casual-effects.com/research/McGuire2012SAO/
 
 #version 450
+#extension GL_ARB_shading_language_include : require
+#include "/temporal.glsl"
 
 // total number of samples at each fragment
 #define PI						3.1415926535897932384626433832795
@@ -18,6 +20,22 @@ in vec4 gFragmentPosition;
 out vec4 fragAmbient;
 
 uniform sampler2D surfaceNormalTexture;
+uniform sampler2D surfacePositionTexture;
+
+// Pixels outside of the refreshed subset whose surface was visible in the previous frame are only marked with a
+// negative occlusion, aotemporal-fs.glsl takes them from the history
+uniform bool temporalReuse = false;
+uniform uint temporalFrame = 0;
+uniform uint temporalPeriod = 1;
+uniform mat4 previousModelViewProjectionMatrix;
+uniform float historyTolerance = 2.0;
+uniform float pixelFootprint;
+uniform ivec2 framebufferSize;
+uniform sampler2D historyPositionTexture;
+
+// At a reduced resolution every pixel samples the surface pixel at the center of its block and only the occlusion is
+// written, for a single channel target that aoupsample-fs.glsl brings back to the surface
+uniform int resolutionDivisor = 1;
 
 uniform vec4 projectionInfo;
 uniform float projectionScale;
@@ -130,7 +148,25 @@ float rand(vec2 co)
 
 void main()
 {
-	ivec2 positionSS = ivec2(gl_FragCoord.xy);
+	ivec2 positionSS = min(ivec2(gl_FragCoord.xy) * resolutionDivisor + resolutionDivisor / 2, framebufferSize - 1);
+	vec4 surfacePosition = texelFetch(surfacePositionTexture, positionSS, 0);
+
+	if (surfacePosition.w >= 65535.0)
+	{
+		fragAmbient = resolutionDivisor > 1 ? vec4(1.0) : vec4(0.0, 0.0, 0.0, 1.0);
+		return;
+	}
+
+	if (temporalReuse && !refreshPixel(positionSS, temporalFrame, temporalPeriod))
+	{
+		ivec2 previousPixel = reprojectPixel(surfacePosition.xyz, previousModelViewProjectionMatrix, framebufferSize);
+
+		if (previousPixel.x >= 0 && matchingHistory(surfacePosition.xyz, texelFetch(historyPositionTexture, previousPixel, 0), historyTolerance*pixelFootprint*surfacePosition.w))
+		{
+			fragAmbient = vec4(-1.0);
+			return;
+		}
+	}
 
 	vec3 normalVS;
 	vec3 positionVS = getPosition(positionSS, normalVS);
@@ -169,5 +205,5 @@ void main()
         occlusion -= dFdy(occlusion) * ((positionSS.y & 1) - 0.5);
     }
 	*/
-	fragAmbient = occlusion;//vec4(occlusion, occlusion, occlusion, positionVS.z);
+	fragAmbient = resolutionDivisor > 1 ? vec4(occlusion.w) : occlusion;//vec4(occlusion, occlusion, occlusion, positionVS.z);
 }
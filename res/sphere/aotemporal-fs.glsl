@@ -0,0 +1,63 @@
+#version 450
+#extension GL_ARB_shading_language_include : require
+#include "/temporal.glsl"
+
+// Resolves the ambient occlusion of the pixels that aosample-fs.glsl marked for reuse from the previous frame. The
+// history is clamped to the range of the freshly sampled neighbours on the same surface, so occlusion that has changed
+// since it was sampled cannot linger. Reused pixels without such neighbours keep the history as it is.
+
+layout(pixel_center_integer) in vec4 gl_FragCoord;
+in vec4 gFragmentPosition;
+out vec4 fragAmbient;
+
+layout(binding = 0) uniform sampler2D ambientTexture;
+layout(binding = 1) uniform sampler2D surfacePositionTexture;
+layout(binding = 2) uniform sampler2D historyAmbientTexture;
+
+uniform mat4 previousModelViewProjectionMatrix;
+uniform ivec2 framebufferSize;
+// Neighbours farther from the pixel are on another surface and do not clamp it
+uniform float occlusionRadius = 1.0;
+// Widens the range of the neighbours, the sampling noise of a few pixels underestimates it
+uniform float clampSlack = 0.05;
+
+void main()
+{
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+	vec4 ambient = texelFetch(ambientTexture, pixel, 0);
+
+	if (ambient.w >= 0.0)
+	{
+		fragAmbient = ambient;
+		return;
+	}
+
+	vec4 position = texelFetch(surfacePositionTexture, pixel, 0);
+	vec4 history = texelFetch(historyAmbientTexture, reprojectPixel(position.xyz, previousModelViewProjectionMatrix, framebufferSize), 0);
+
+	vec4 minimumAmbient = vec4(65535.0);
+	vec4 maximumAmbient = vec4(-65535.0);
+	bool sampled = false;
+
+	for (int y = -1; y <= 1; y++)
+	{
+		for (int x = -1; x <= 1; x++)
+		{
+			ivec2 neighbour = clamp(pixel + ivec2(x, y), ivec2(0), framebufferSize - 1);
+			vec4 neighbourAmbient = texelFetch(ambientTexture, neighbour, 0);
+			vec4 neighbourPosition = texelFetch(surfacePositionTexture, neighbour, 0);
+
+			if (neighbourAmbient.w < 0.0 || neighbourPosition.w >= 65535.0 || distance(neighbourPosition.xyz, position.xyz) > occlusionRadius)
+				continue;
+
+			minimumAmbient = min(minimumAmbient, neighbourAmbient);
+			maximumAmbient = max(maximumAmbient, neighbourAmbient);
+			sampled = true;
+		}
+	}
+
+	if (sampled)
+		history = clamp(history, minimumAmbient - clampSlack, maximumAmbient + clampSlack);
+
+	fragAmbient = history;
+}
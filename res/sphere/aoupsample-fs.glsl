@@ -0,0 +1,69 @@
+#version 450
+
+// Bilateral upsampling of ambient occlusion computed at a reduced resolution (aosample-fs.glsl). Every surface pixel
+// blends the four closest reduced pixels with their bilinear weights, scaled down by the difference in view depth and
+// normal to the surface pixel at the center of their block, so occlusion does not bleed across silhouettes. If all
+// four lie on other surfaces the one closest in depth is taken.
+
+layout(pixel_center_integer) in vec4 gl_FragCoord;
+in vec4 gFragmentPosition;
+out vec4 fragAmbient;
+
+layout(binding = 0) uniform sampler2D normalTexture;
+layout(binding = 1) uniform sampler2D ambientTexture;
+
+uniform int resolutionDivisor = 2;
+uniform ivec2 ambientSize;
+uniform ivec2 framebufferSize;
+// Falloff of the weights with the relative depth difference and the exponent of the normal similarity
+uniform float depthSharpness = 64.0;
+uniform float normalSharpness = 8.0;
+
+void main()
+{
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+	vec4 normal = texelFetch(normalTexture, pixel, 0);
+
+	// Pixels without surface keep the clear value of the surface pass
+	if (normal.w >= 65535.0)
+	{
+		fragAmbient = vec4(0.0, 0.0, 0.0, 1.0);
+		return;
+	}
+
+	// Reduced pixel i holds the surface pixel i * divisor + divisor / 2
+	vec2 position = (vec2(pixel) - float(resolutionDivisor / 2)) / float(resolutionDivisor);
+	ivec2 base = ivec2(floor(position));
+	vec2 fraction = position - vec2(base);
+
+	float occlusion = 0.0;
+	float totalWeight = 0.0;
+	float closestOcclusion = 1.0;
+	float closestDifference = 65535.0;
+
+	for (int y = 0; y <= 1; y++)
+	{
+		for (int x = 0; x <= 1; x++)
+		{
+			ivec2 reduced = clamp(base + ivec2(x, y), ivec2(0), ambientSize - 1);
+			vec4 reducedNormal = texelFetch(normalTexture, min(reduced * resolutionDivisor + resolutionDivisor / 2, framebufferSize - 1), 0);
+			float reducedOcclusion = texelFetch(ambientTexture, reduced, 0).r;
+
+			float difference = abs(reducedNormal.w - normal.w) / max(abs(normal.w), 1e-4);
+			float bilinear = (x == 0 ? 1.0 - fraction.x : fraction.x) * (y == 0 ? 1.0 - fraction.y : fraction.y);
+			float weight = bilinear * exp(-depthSharpness * difference) * pow(max(dot(reducedNormal.xyz, normal.xyz), 0.0), normalSharpness);
+
+			occlusion += weight * reducedOcclusion;
+			totalWeight += weight;
+
+			if (difference < closestDifference)
+			{
+				closestDifference = difference;
+				closestOcclusion = reducedOcclusion;
+			}
+		}
+	}
+
+	// The bent direction of the full resolution occlusion is not kept, which leaves the light occlusion neutral
+	fragAmbient = vec4(0.0, 0.0, 0.0, totalWeight > 1e-4 ? occlusion / totalWeight : closestOcclusion);
+}
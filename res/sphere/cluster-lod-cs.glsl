@@ -0,0 +1,152 @@
+#version 450
+
+// Level of detail selection per cluster of SparseClusterSize consecutive atoms (Protein.h). The bounding sphere of the
+// atoms of a cluster is projected to find its size in pixels, which is mapped to a detail between the sparse (0), the
+// atom (0.5) and the dense level (1) like the global interpolation. Every cluster draws at most the two neighbouring
+// levels of its detail with the blend weights of the global interpolation. The draws of a level are written as
+// DrawArraysIndirectCommand per cluster, clusters that do not use the level get empty draws.
+layout(local_size_x = 64) in;
+
+uniform mat4 modelViewMatrix;
+uniform mat4 projectionMatrix;
+uniform ivec2 framebufferSize;
+uniform uint clusterCount;
+uniform uint clusterSize;
+uniform uint denseChildCount;
+uniform uint atomCount;
+uniform uint sparseCount;
+uniform uint denseCount;
+uniform float atomRadius = 1.7;
+// Projected cluster radius in pixels at which the sparse level ends and the dense level starts
+uniform float coarsePixels = 4.0;
+uniform float finePixels = 64.0;
+// Same as PAIR_EPSILON of SphereRenderer.cpp, details this close to a level only draw that level
+uniform float pairEpsilon = 0.002;
+uniform float animationDelta = 0.0;
+
+// Protein::HierchicalPoints of the atom level, tightly packed as in occlusion-cull-cs.glsl
+layout(std430, binding = 0) readonly buffer vertexBuffer
+{
+	float vertices[];
+};
+
+layout(std430, binding = 10) readonly buffer nextVertexBuffer
+{
+	float nextVertices[];
+};
+
+// DrawArraysIndirectCommand, baseInstance is the cluster to fetch its weights as an instanced attribute
+struct DrawCommand
+{
+	uint count;
+	uint instanceCount;
+	uint first;
+	uint baseInstance;
+};
+
+// Commands of the sparse level followed by those of the atom and the dense level, clusterCount each
+layout(std430, binding = 13) writeonly buffer commandBuffer
+{
+	DrawCommand commands[];
+};
+
+// Weight of each level per cluster, only the first three components are used
+layout(std430, binding = 14) writeonly buffer weightBuffer
+{
+	vec4 weights[];
+};
+
+// Number of clusters that draw each level
+layout(std430, binding = 15) buffer levelBuffer
+{
+	uint levelClusters[3];
+};
+
+vec3 atomPosition(uint index)
+{
+	uint base = index * 9u;
+	vec3 position = vec3(vertices[base], vertices[base + 1u], vertices[base + 2u]);
+
+	if (animationDelta > 0.0)
+		position = mix(position, vec3(nextVertices[base], nextVertices[base + 1u], nextVertices[base + 2u]), animationDelta);
+
+	return position;
+}
+
+void main()
+{
+	uint cluster = gl_GlobalInvocationID.x;
+
+	if (cluster >= clusterCount)
+		return;
+
+	uint firstAtom = cluster * clusterSize;
+	uint lastAtom = min(firstAtom + clusterSize, atomCount);
+
+	vec3 center = vec3(0.0);
+
+	for (uint i = firstAtom; i < lastAtom; i++)
+		center += atomPosition(i);
+
+	center /= float(lastAtom - firstAtom);
+
+	float radius = 0.0;
+
+	for (uint i = firstAtom; i < lastAtom; i++)
+		radius = max(radius, distance(center, atomPosition(i)));
+
+	radius += atomRadius;
+
+	// Clusters around or behind the camera get the full detail
+	vec4 c = modelViewMatrix * vec4(center, 1.0);
+	float viewRadius = length(modelViewMatrix * vec4(radius, 0.0, 0.0, 0.0));
+	float distanceToCamera = -c.z - viewRadius;
+	float detail = 1.0;
+
+	if (distanceToCamera > 0.0)
+	{
+		float pixels = viewRadius * projectionMatrix[1][1] * 0.5 * float(framebufferSize.y) / -c.z;
+		detail = clamp(log2(max(pixels, 1e-6) / coarsePixels) / log2(finePixels / coarsePixels), 0.0, 1.0);
+	}
+
+	// Same pairs as getPairwiseLODs
+	float scaled = 2.0 * detail;
+	uint level = min(uint(floor(scaled)), 1u);
+	float blend = scaled - float(level);
+
+	if (abs(scaled - round(scaled)) < pairEpsilon)
+	{
+		level = uint(round(scaled));
+		blend = 0.0;
+	}
+
+	vec3 weight = vec3(0.0);
+	weight[level] = 1.0 - blend;
+
+	if (blend > 0.0)
+		weight[level + 1u] = blend;
+
+	// The last atoms have no sparse point of their own
+	if (cluster >= sparseCount)
+	{
+		weight.y += weight.x;
+		weight.x = 0.0;
+	}
+
+	weights[cluster] = vec4(weight, 0.0);
+
+	uint firstDense = min(firstAtom * denseChildCount, denseCount);
+	uint lastDense = min(lastAtom * denseChildCount, denseCount);
+
+	uvec3 first = uvec3(min(cluster, sparseCount), firstAtom, firstDense);
+	uvec3 count = uvec3(cluster < sparseCount ? 1u : 0u, lastAtom - firstAtom, lastDense - firstDense);
+
+	for (uint i = 0u; i < 3u; i++)
+	{
+		bool drawn = weight[i] > 0.0 && count[i] > 0u;
+		commands[i * clusterCount + cluster] = DrawCommand(drawn ? count[i] : 0u, 1u, first[i], cluster);
+
+		if (drawn)
+			atomicAdd(levelClusters[i], 1u);
+	}
+}
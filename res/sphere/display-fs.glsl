@@ -5,6 +5,8 @@ uniform mat4 inverseModelViewProjectionMatrix;
 
 uniform sampler2D colorTexture;
 uniform sampler2D depthTexture;
+// Rendered part in the lower left corner of the textures, all of them if zero
+uniform ivec2 sourceSize = ivec2(0);
 
 in vec4 gFragmentPosition;
 out vec4 fragColor;
@@ -21,7 +23,7 @@ vec4 cubic(float v)
     return vec4(x, y, z, w) * (1.0/6.0);
 }
 
-vec4 textureBicubic(sampler2D sampler, vec2 texCoords)
+vec4 textureBicubic(sampler2D sampler, vec2 texCoords, vec2 regionSize)
 {
 	vec2 texSize = textureSize(sampler, 0);
 	vec2 invTexSize = 1.0 / texSize;
@@ -39,6 +41,8 @@ vec4 textureBicubic(sampler2D sampler, vec2 texCoords)
 	vec4 s = vec4(xcubic.xz + xcubic.yw, ycubic.xz + ycubic.yw);
 	vec4 offset = c + vec4 (xcubic.yw, ycubic.yw) / s;
 
+	// The bilinear taps stay within the texel centers of the rendered part
+	offset = clamp(offset, vec4(0.5), vec4(regionSize.xx, regionSize.yy) - 0.5);
 	offset *= invTexSize.xxyy;
 
 	vec4 sample0 = texture(sampler, offset.xz);
@@ -54,10 +58,12 @@ vec4 textureBicubic(sampler2D sampler, vec2 texCoords)
 
 void main()
 {
-	vec2 coords = (gFragmentPosition.xy+vec2(1.0))*0.5;
+	vec2 colorSize = vec2(textureSize(colorTexture, 0));
+	vec2 source = any(equal(sourceSize, ivec2(0))) ? colorSize : vec2(sourceSize);
+	vec2 coords = (gFragmentPosition.xy+vec2(1.0))*0.5 * source / colorSize;
 
-	vec4 color = textureBicubic(colorTexture,coords);
-	float depth = texture(depthTexture,coords).r;
+	vec4 color = textureBicubic(colorTexture,coords,source);
+	float depth = texture(depthTexture,min(coords, (source - 0.5) / colorSize)).r;
 
 	fragColor = color;
 	gl_FragDepth = depth;
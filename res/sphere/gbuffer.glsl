@@ -0,0 +1,39 @@
+// Encodings of the compact G-buffer, mirrored on the CPU in CompactGBuffer.cpp
+
+// Octahedral mapping of a unit vector to [0,1]^2 for a GL_RG16 target
+vec2 packNormal(vec3 n)
+{
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	vec2 p = n.xy;
+
+	if (n.z < 0.0)
+		p = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+
+	return p * 0.5 + 0.5;
+}
+
+vec3 unpackNormal(vec2 p)
+{
+	p = p * 2.0 - 1.0;
+	vec3 n = vec3(p, 1.0 - abs(p.x) - abs(p.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+// Position from the depth buffer with w as the distance from the near plane along the view ray, like the surface pass.
+// Pixels without surface keep the far plane depth and get the END_PLANE distance.
+vec4 reconstructPosition(vec2 ndc, float depth, mat4 inverseModelViewProjectionMatrix)
+{
+	if (depth >= 1.0)
+		return vec4(0.0, 0.0, 0.0, 65535.0);
+
+	vec4 near = inverseModelViewProjectionMatrix * vec4(ndc, -1.0, 1.0);
+	near /= near.w;
+
+	vec4 position = inverseModelViewProjectionMatrix * vec4(ndc, depth * 2.0 - 1.0, 1.0);
+	position /= position.w;
+
+	return vec4(position.xyz, length(position.xyz - near.xyz));
+}
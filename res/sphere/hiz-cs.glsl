@@ -0,0 +1,40 @@
+#version 450
+
+// One level of the hierarchical Z pyramid (DepthPyramid.cpp): level 0 copies the closest inner sphere distance of
+// every pixel, the other levels keep the farthest distance of the covered texels of the level below
+layout(local_size_x = 8, local_size_y = 8) in;
+
+uniform bool fromPositions = false;
+uniform ivec2 sourceSize;
+uniform ivec2 destinationSize;
+
+layout(binding = 0) uniform sampler2D positionTexture;
+layout(binding = 0, r32f) uniform readonly image2D source;
+layout(binding = 1, r32f) uniform writeonly image2D destination;
+
+void main()
+{
+	ivec2 coordinate = ivec2(gl_GlobalInvocationID.xy);
+
+	if (any(greaterThanEqual(coordinate, destinationSize)))
+		return;
+
+	if (fromPositions)
+	{
+		imageStore(destination, coordinate, vec4(texelFetch(positionTexture, coordinate, 0).w));
+		return;
+	}
+
+	// The last texel of an odd sized level also covers the remaining row or column
+	ivec2 first = min(coordinate * 2, sourceSize - 1);
+	ivec2 last = mix(first + 1, sourceSize - 1, equal(coordinate, destinationSize - 1));
+	last = min(last, sourceSize - 1);
+
+	float farthest = 0.0;
+
+	for (int y = first.y; y <= last.y; y++)
+		for (int x = first.x; x <= last.x; x++)
+			farthest = max(farthest, imageLoad(source, ivec2(x, y)).r);
+
+	imageStore(destination, coordinate, vec4(farthest));
+}
@@ -0,0 +1,130 @@
+#version 450
+
+// Hierarchical Z occlusion culling of the spheres of one level of detail before the spawn pass. A sphere is culled
+// if it is not drawn by sphere-gs.glsl or if its outer sphere lies behind the closest inner sphere of every pixel it
+// covers, so that spawn-fs.glsl would discard all of its fragments. The indices of the others are appended to
+// the index list of an indirect draw.
+layout(local_size_x = 256) in;
+
+uniform mat4 modelViewMatrix;
+uniform mat4 projectionMatrix;
+uniform float radiusScale;
+uniform float clipRadiusScale;
+uniform float clustering = 0.0;
+uniform float nearPlaneZ = -0.125;
+// Near plane in model space with unit normal, the sphere distances are measured from it in model space
+uniform vec4 nearPlane;
+uniform ivec2 framebufferSize;
+uniform int levels;
+uniform uint sphereCount;
+uniform uint command;
+uniform uint indexOffset;
+// Interpolation towards the next timestep of the vertices, only read if larger than zero
+uniform float animationDelta = 0.0;
+
+layout(binding = 1) uniform sampler2D depthPyramid;
+
+// Protein::HierchicalPoints (position, parent position, radius) is tightly packed, which has no std430 struct equivalent
+layout(std430, binding = 0) readonly buffer vertexBuffer
+{
+	float vertices[];
+};
+
+layout(std430, binding = 10) readonly buffer nextVertexBuffer
+{
+	float nextVertices[];
+};
+
+layout(std430, binding = 11) buffer indexBuffer
+{
+	uint indices[];
+};
+
+// DrawElementsIndirectCommand
+struct DrawCommand
+{
+	uint count;
+	uint instanceCount;
+	uint firstIndex;
+	uint baseVertex;
+	uint baseInstance;
+};
+
+layout(std430, binding = 12) buffer commandBuffer
+{
+	DrawCommand commands[];
+};
+
+bool visible(vec3 center, float sphereRadius, float sphereClipRadius)
+{
+	vec4 c = modelViewMatrix * vec4(center, 1.0);
+	float radius = length(modelViewMatrix * vec4(sphereRadius, 0.0, 0.0, 0.0));
+	float clipRadius = length(modelViewMatrix * vec4(sphereClipRadius, 0.0, 0.0, 0.0));
+
+	// Same as sphere-gs.glsl, which draws nothing for spheres intersecting the near plane
+	if (c.z + clipRadius >= nearPlaneZ)
+		return false;
+
+	// Conservative pixel rectangle from the projected corners of the view space bounding box, as in tile-footprint-cs.glsl
+	vec2 minimum = vec2(1.0);
+	vec2 maximum = vec2(-1.0);
+
+	for (int corner = 0; corner < 8; corner++)
+	{
+		vec3 offset = vec3((corner & 1) != 0 ? radius : -radius, (corner & 2) != 0 ? radius : -radius, (corner & 4) != 0 ? radius : -radius);
+		vec4 clip = projectionMatrix * vec4(c.xyz + offset, 1.0);
+		vec2 ndc = clip.xy / clip.w;
+		minimum = min(minimum, ndc);
+		maximum = max(maximum, ndc);
+	}
+
+	ivec2 lower = max(ivec2(floor((minimum * 0.5 + 0.5) * vec2(framebufferSize))), ivec2(0));
+	ivec2 upper = min(ivec2(ceil((maximum * 0.5 + 0.5) * vec2(framebufferSize))), framebufferSize - 1);
+
+	if (any(greaterThan(lower, upper)))
+		return false;
+
+	// Level on which the rectangle covers at most two by two texels
+	ivec2 extent = upper - lower + 1;
+	int level = min(int(ceil(log2(float(max(extent.x, extent.y))))), levels - 1);
+	ivec2 levelSize = textureSize(depthPyramid, level);
+	ivec2 first = min(lower >> level, levelSize - 1);
+	ivec2 last = min(upper >> level, levelSize - 1);
+
+	float farthest = 0.0;
+
+	for (int y = first.y; y <= last.y; y++)
+		for (int x = first.x; x <= last.x; x++)
+			farthest = max(farthest, texelFetch(depthPyramid, ivec2(x, y), level).r);
+
+	// No ray through the rectangle hits the sphere closer than its distance to the near plane minus its radius
+	float closest = dot(nearPlane, vec4(center, 1.0)) - sphereRadius;
+	return closest <= farthest;
+}
+
+void main()
+{
+	uint index = gl_GlobalInvocationID.x;
+
+	if (index >= sphereCount)
+		return;
+
+	uint base = index * 9u;
+	vec4 position = vec4(vertices[base], vertices[base + 1u], vertices[base + 2u], vertices[base + 3u]);
+	vec3 parentPosition = vec3(vertices[base + 4u], vertices[base + 5u], vertices[base + 6u]);
+
+	// Same as sphere-vs.glsl and sphere-gs.glsl
+	if (animationDelta > 0.0)
+		position.xyz = mix(position.xyz, vec3(nextVertices[base], nextVertices[base + 1u], nextVertices[base + 2u]), animationDelta);
+
+	uint sphereId = floatBitsToUint(position.w);
+	uint elementId = bitfieldExtract(sphereId, 0, 8);
+	float instanceScale = mix(1.0, 2.0, float(elementId) / 1000.0);
+	vec3 center = mix(position.xyz, parentPosition, clustering);
+
+	if (!visible(center, radiusScale * instanceScale, clipRadiusScale * instanceScale))
+		return;
+
+	uint slot = atomicAdd(commands[command].count, 1u);
+	indices[indexOffset + slot] = index;
+}
@@ -0,0 +1,28 @@
+#version 450
+
+// Adds the scanned work group totals to the 1024 values of every work group
+layout(local_size_x = 256) in;
+
+uniform uint count;
+
+layout(std430, binding = 1) buffer outputBuffer
+{
+	uint scanned[];
+};
+
+layout(std430, binding = 2) buffer sumBuffer
+{
+	uint sums[];
+};
+
+void main()
+{
+	uint base = gl_WorkGroupID.x * 1024u + gl_LocalInvocationID.x * 4u;
+	uint blockSum = sums[gl_WorkGroupID.x];
+
+	for (uint i = 0u; i < 4u; i++)
+	{
+		if (base + i < count)
+			scanned[base + i] += blockSum;
+	}
+}
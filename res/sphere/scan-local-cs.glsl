@@ -0,0 +1,62 @@
+#version 450
+
+// Exclusive scan of 1024 values per work group, the total of every work group goes to sums
+layout(local_size_x = 256) in;
+
+uniform uint count;
+
+layout(std430, binding = 0) buffer inputBuffer
+{
+	uint values[];
+};
+
+layout(std430, binding = 1) buffer outputBuffer
+{
+	uint scanned[];
+};
+
+layout(std430, binding = 2) buffer sumBuffer
+{
+	uint sums[];
+};
+
+shared uint partialSums[256];
+
+void main()
+{
+	uint localIndex = gl_LocalInvocationID.x;
+	uint base = gl_WorkGroupID.x * 1024u + localIndex * 4u;
+
+	// Every invocation scans four consecutive values sequentially
+	uint local[4];
+	uint sum = 0u;
+
+	for (uint i = 0u; i < 4u; i++)
+	{
+		local[i] = sum;
+		sum += base + i < count ? values[base + i] : 0u;
+	}
+
+	partialSums[localIndex] = sum;
+	barrier();
+
+	// Inclusive scan of the invocation sums in shared memory
+	for (uint offset = 1u; offset < 256u; offset <<= 1u)
+	{
+		uint value = localIndex >= offset ? partialSums[localIndex - offset] : 0u;
+		barrier();
+		partialSums[localIndex] += value;
+		barrier();
+	}
+
+	uint prefix = localIndex > 0u ? partialSums[localIndex - 1u] : 0u;
+
+	for (uint i = 0u; i < 4u; i++)
+	{
+		if (base + i < count)
+			scanned[base + i] = prefix + local[i];
+	}
+
+	if (localIndex == 255u)
+		sums[gl_WorkGroupID.x] = partialSums[255];
+}
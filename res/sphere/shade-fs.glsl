@@ -1,6 +1,7 @@
 #version 450
 #include "/defines.glsl"
 #include "/globals.glsl"
+#include "/gbuffer.glsl"
 
 layout(pixel_center_integer) in vec4 gl_FragCoord;
 
@@ -33,6 +34,8 @@ uniform sampler2D environmentTexture;
 uniform sampler2D shadowColorTexture;
 uniform sampler2D shadowDepthTexture;
 uniform bool environment;
+// Octahedral normals and no position target, see gbuffer.glsl
+uniform bool compactGBuffer = false;
 
 uniform float maximumCoCRadius = 0.0;
 uniform float aparture = 0.0;
@@ -114,10 +117,20 @@ void main()
 	vec4 sphereNormal = texelFetch(sphereNormalTexture,ivec2(gl_FragCoord.xy),0);
 	vec4 sphereDiffuse = texelFetch(sphereDiffuseTexture,ivec2(gl_FragCoord.xy),0);
 
-	vec4 surfacePosition = texelFetch(surfacePositionTexture,ivec2(gl_FragCoord.xy),0);
+	vec4 surfacePosition;
 	vec4 surfaceNormal = texelFetch(surfaceNormalTexture,ivec2(gl_FragCoord.xy),0);
 	vec4 surfaceDiffuse = texelFetch(surfaceDiffuseTexture,ivec2(gl_FragCoord.xy),0);
 
+	if (compactGBuffer)
+	{
+		surfacePosition = reconstructPosition(fragCoord.xy, texelFetch(depthTexture,ivec2(gl_FragCoord.xy),0).x, inverseModelViewProjectionMatrix);
+		surfaceNormal = vec4(unpackNormal(surfaceNormal.xy), 0.0);
+	}
+	else
+	{
+		surfacePosition = texelFetch(surfacePositionTexture,ivec2(gl_FragCoord.xy),0);
+	}
+
 	vec3 directLight = vec3(1.0);
 
 	if (surfacePosition.w >= 65535.0)	
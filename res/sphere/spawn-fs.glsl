@@ -3,7 +3,12 @@
 uniform mat4 modelViewProjectionMatrix;
 uniform mat4 inverseModelViewProjectionMatrix;
 uniform float interpolation = 0.0;
-uniform uint bucketSize = 8u;
+uniform uint capacity = 0u;
+uniform ivec2 framebufferSize;
+
+// The spheres are drawn twice with identical fragments: the count pass counts entries per pixel,
+// the fill pass writes them to the per-pixel ranges given by the exclusive scan of the counts
+uniform bool countPass = false;
 
 in vec4 gFragmentPosition;
 flat in vec4 gSpherePosition;
@@ -14,8 +19,6 @@ flat in float gWeight;
 flat in uint gSphereId;
 
 layout(binding = 0) uniform sampler2D positionTexture;
-layout(binding = 1) uniform sampler2D positionNearTexture;
-layout(r32ui, binding = 0) uniform uimage3D offsetImage;
 
 struct BufferEntry
 {
@@ -23,19 +26,27 @@ struct BufferEntry
 	float far;
 	vec3 center;
 	uint id;
-	uint previous;
 	float radius;
 	float sharpness;
 	float weight;
 };
 
-layout(binding = 1) uniform atomic_uint count;
-
 layout(std430, binding = 1) buffer intersectionBuffer
 {
 	BufferEntry intersections[];
 };
 
+layout(std430, binding = 3) buffer offsetBuffer
+{
+	uint offsets[];
+};
+
+// Entries per pixel in the count pass, reset and reused as write cursor in the fill pass
+layout(std430, binding = 4) buffer countBuffer
+{
+	uint counts[];
+};
+
 struct Sphere
 {			
 	bool hit;
@@ -98,26 +109,24 @@ void main()
 	if (entry.near > position.w)
 		discard;
 
-	vec4 nearPosition = texelFetch(positionNearTexture,ivec2(gl_FragCoord.xy),0);
-	/**
-	f(x) = ax + b
-	f(x_0) = 0 = a * x_0 + b => a * x_0 = -b
-	f(x_1) = 8 = a * x_1 + b => a * x_1 = 8 - b
-	a * x_1 = 8 + (a * x_0) => a * (x_1 - x_0) = 8 => a = 8 / (x_1 - x_0)
-	a * x_0 = -b => 8 / (x_1 - x_0) * x_0 = -b => b = -(8 * x_0) / (x_1 - x_0)
-	f(x) = x * 8 / (x_1 - x_0) - (8 * x_0) / (x_1 - x_0)
-		 => (x * 8 - 8 * x_0) / (x_1 - x_0) => 8 * (x - x_0) / (x_1 - x_0) = f(x)
-	 */
-	uint bucketIndex = clamp(uint(float(bucketSize) * (entry.near - nearPosition.w) / (position.w - nearPosition.w)), 0u, bucketSize - 1u);
-
-	uint index = atomicCounterIncrement(count);
-	uint prev = imageAtomicExchange(offsetImage,ivec3(ivec2(gl_FragCoord.xy), bucketIndex),index);
+	uint pixel = uint(gl_FragCoord.y) * uint(framebufferSize.x) + uint(gl_FragCoord.x);
+
+	if (countPass)
+	{
+		atomicAdd(counts[pixel], 1u);
+		discard;
+	}
+
+	uint index = offsets[pixel] + atomicAdd(counts[pixel], 1u);
+
+	// The total is read back by the host to size the buffer, entries beyond the capacity are dropped for this frame
+	if (index >= capacity)
+		discard;
 
 	entry.far = length(sphere.far.xyz-near.xyz);
 
 	entry.center = gSpherePosition.xyz;
 	entry.id = gSphereId;
-	entry.previous = prev;
 	
 	entry.radius = gOuterRadius;
 	entry.sharpness = gSharpness;
@@ -8,6 +8,7 @@
 #version 450
 
 in float vRadius[];
+in float vWeight[];
 
 uniform mat4 modelViewMatrix;
 uniform mat4 projectionMatrix;
@@ -257,7 +258,7 @@ void main()
 	gSphereRadius = sphereRadius;
     gOuterRadius = outerRadius;
     gSharpness = individualSharpness;
-    gWeight = weight;
+    gWeight = weight * vWeight[0];
 
 	vec4 c = modelViewMatrix * vec4(gl_in[0].gl_Position.xyz,1.0);
 	
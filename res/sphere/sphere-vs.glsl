@@ -6,7 +6,13 @@ in vec4 position;
 in vec4 parentPosition;
 in float radius;
 #ifdef INTERPOLATION
-in vec4 nextPosition;
+// Same vertex of the next timestep, bound to the position itself for vertices without trajectory
+layout(location = 3) in vec4 nextPosition;
+#endif
+#ifdef CLUSTER_LOD
+// Level weights of the cluster (cluster-lod-cs.glsl), instanced with the cluster as base instance of the draw
+layout(location = 4) in vec4 clusterWeights;
+uniform uint lodLevel = 0;
 #endif
 uniform float animationDelta;
 uniform float animationTime;
@@ -19,6 +25,8 @@ uniform vec3 maxb;
 uniform vec3 minb;
 
 out float vRadius;
+// Multiplied with the weight of the whole draw in sphere-gs.glsl
+out float vWeight;
 
 struct Cell
 {
@@ -142,9 +150,18 @@ uint powi(uint x, uint p) {
 void main()
 {
   vRadius = radius;
+  vWeight = 1.0;
+
+#ifdef CLUSTER_LOD
+	vWeight = clusterWeights[lodLevel];
+#endif
 
 	vec4 vertexPosition = position;
 
+#ifdef INTERPOLATION
+	vertexPosition.xyz = mix(position.xyz,nextPosition.xyz,animationDelta);
+#endif
+
   vertexPosition.xyz = mix(vertexPosition.xyz, parentPosition.xyz, clustering);
 
   // if (0.1 < clustering) {
@@ -217,10 +234,6 @@ void main()
   //   }
   // }
 
-#ifdef INTERPOLATION
-	vertexPosition.xyz = mix(position.xyz,nextPosition.xyz,animationDelta);
-#endif
-
 #ifdef ANIMATION
 	vec3 offset;
 	offset.x = snoise(vec4(vertexPosition.xyz,animationFrequency*animationTime));
@@ -0,0 +1,29 @@
+#version 450
+
+// Depth of the surface written by surface-tile-cs.glsl, which cannot write the depth attachment itself
+
+layout(pixel_center_integer) in vec4 gl_FragCoord;
+
+uniform mat4 modelViewProjectionMatrix;
+
+// Read as an image since the texture is still attached to the bound framebuffer
+layout(rgba32f, binding = 0) uniform readonly image2D surfacePosition;
+
+float calcDepth(vec3 pos)
+{
+	float far = gl_DepthRange.far;
+	float near = gl_DepthRange.near;
+	vec4 clip_space_pos = modelViewProjectionMatrix * vec4(pos, 1.0);
+	float ndc_depth = clip_space_pos.z / clip_space_pos.w;
+	return (((far - near) * ndc_depth) + near + far) / 2.0;
+}
+
+void main()
+{
+	vec4 position = imageLoad(surfacePosition, ivec2(gl_FragCoord.xy));
+
+	if (position.w >= 65535.0)
+		discard;
+
+	gl_FragDepth = calcDepth(position.xyz);
+}
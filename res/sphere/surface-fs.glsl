@@ -2,10 +2,16 @@
 #extension GL_ARB_shading_language_include : require
 #include "/defines"
 #include "/globals.glsl"
+#include "/gbuffer.glsl"
+#include "/temporal.glsl"
 
 #define BIAS 0.001
 #define END_PLANE 65535.0
 
+#if defined(ITERATION_STATISTICS) || defined(ITERATION_HEATMAP)
+#define MARCH_COUNTERS
+#endif
+
 layout(pixel_center_integer) in vec4 gl_FragCoord;
 
 uniform mat4 modelViewMatrix;
@@ -17,6 +23,8 @@ uniform float sharpness;
 uniform uint coloring;
 uniform bool environment;
 uniform bool lens;
+// Normals are written octahedral encoded and positions are reconstructed from depth by the shading
+uniform bool compactGBuffer = false;
 
 uniform vec3 lightPosition;
 uniform vec3 diffuseMaterial;
@@ -27,13 +35,43 @@ uniform vec2 focusPosition;
 
 uniform float interpolation = 0.0;
 
-layout(binding = 0) uniform usampler3D offsetTexture;
-layout(binding = 1) uniform usampler3D offsetTexture2;
+uniform ivec2 framebufferSize;
+// Entries of the intersection buffer, the spawn pass drops those beyond it while offsets keep counting them.
+// Renderers without an adaptive buffer leave it unbounded.
+uniform uint capacity = 0xffffffffu;
+
 layout(binding = 2) uniform sampler2D positionTexture;
 layout(binding = 3) uniform sampler2D normalTexture;
 // layout(binding = 4) uniform sampler2D positionTexture2;
 // layout(binding = 5) uniform sampler2D normalTexture2;
 
+// Surface of the previous frame, reused for pixels outside of the refreshed subset whose ray it still lies on
+uniform bool temporalReuse = false;
+uniform uint temporalFrame = 0;
+uniform uint temporalPeriod = 1;
+uniform mat4 previousModelViewProjectionMatrix;
+// Maps the normals of the previous view space to the current one
+uniform mat3 historyNormalMatrix;
+// Distance from the ray that is accepted, in pixels, and the size of a pixel at unit distance
+uniform float historyTolerance = 0.75;
+uniform float pixelFootprint;
+layout(binding = 4) uniform sampler2D historyPositionTexture;
+layout(binding = 5) uniform sampler2D historyNormalTexture;
+layout(binding = 6) uniform sampler2D historyDiffuseTexture;
+
+// Interleaved evaluation: 1 marches every other pixel in a checkerboard, 2 one pixel of every 2x2 block. The marched
+// pixels are written to the sparse targets, the reconstruction copies them and interpolates the others where the
+// marched neighbours agree on one smooth surface.
+uniform uint interleaving = 0;
+uniform bool reconstruct = false;
+// Spread of the neighbour distances along the ray that is interpolated, in pixels, and the minimum mean resultant
+// length of their normals
+uniform float reconstructionTolerance = 4.0;
+uniform float reconstructionNormalAgreement = 0.95;
+layout(binding = 7) uniform sampler2D sparsePositionTexture;
+layout(binding = 8) uniform sampler2D sparseNormalTexture;
+layout(binding = 9) uniform sampler2D sparseDiffuseTexture;
+
 uniform uint gridScale = 1;
 uniform uint gridDepth = 1;
 uniform vec3 minb;
@@ -90,7 +128,6 @@ struct BufferEntry
 	float far;
 	vec3 center;
 	uint id;
-	uint previous;
 	float radius;
 	float sharpness;
 	float weight;
@@ -112,27 +149,24 @@ layout(std430, binding = 7) buffer scenegraphBuffer
 	Cell cells[];
 };
 
-layout(binding = 1) uniform atomic_uint count;
-
 layout(std430, binding = 1) buffer intersectionBuffer
 {
 	BufferEntry intersections[];
 };
 
-layout(binding = 2) uniform atomic_uint count2;
-
-layout(std430, binding = 2) buffer intersectionBuffer2
+// Exclusive scan of the entry counts, the entries of a pixel are intersections[offsets[pixel]] to intersections[offsets[pixel + 1] - 1]
+layout(std430, binding = 3) buffer offsetBuffer
 {
-	BufferEntry intersections2[];
+	uint offsets[];
 };
 
-// layout(std430, binding = 2) buffer statisticsBuffer
-// {
-// 	uint intersectionCount;
-// 	uint totalPixelCount;
-// 	uint totalEntryCount;
-// 	uint maximumEntryCount;
-// };
+#ifdef ITERATION_STATISTICS
+// Work per pixel: entries, selection sort comparisons, sphere tracing steps and atom evaluations
+layout(std430, binding = 2) buffer statisticsBuffer
+{
+	uvec4 pixelStatistics[];
+};
+#endif
 
 struct Sphere
 {			
@@ -151,6 +185,17 @@ float calcDepth(vec3 pos)
 	return (((far - near) * ndc_depth) + near + far) / 2.0;
 }
 
+bool marchedPixel(ivec2 coord)
+{
+	if (interleaving == 1u)
+		return ((coord.x + coord.y) & 1) == 0;
+
+	if (interleaving == 2u)
+		return ((coord.x | coord.y) & 1) == 0;
+
+	return true;
+}
+
 void swap(inout uint a, inout uint b) {
 	uint temp = a;
 	a = b;
@@ -159,9 +204,14 @@ void swap(inout uint a, inout uint b) {
 
 void main()
 {
-	uint offset = texelFetch(offsetTexture,ivec3(ivec2(gl_FragCoord.xy), 0),0).r;
-	// Note: Offset == 0 doesn't mean offset2 != 0
-	if (offset == 0)
+	if (!reconstruct && !marchedPixel(ivec2(gl_FragCoord.xy)))
+		discard;
+
+	uint pixel = uint(gl_FragCoord.y) * uint(framebufferSize.x) + uint(gl_FragCoord.x);
+	uint entryBegin = min(offsets[pixel], capacity);
+	uint entryEnd = min(offsets[pixel + 1u], capacity);
+
+	if (entryBegin == entryEnd)
 		discard;
 
 	vec4 position = texelFetch(positionTexture,ivec2(gl_FragCoord.xy),0);
@@ -180,36 +230,136 @@ void main()
 
 	vec3 V = normalize(far.xyz-near.xyz);
 
-	const uint maxEntries = 128;
-	uint entryCount = 0;
-	uint entryCount2 = 0;
-	uint indices[maxEntries];
-	uint indices2[maxEntries];
+	/** Reconstruction of the pixels that were not marched from the plane through their marched neighbours.
+	 * Neighbours without surface, a spread in distance or diverging normals mark a silhouette or a crease, the ray
+	 * grazing the plane leaves the intersection unreliable. These pixels are marched like in a full evaluation.
+	 */
+	if (reconstruct)
+	{
+		ivec2 coord = ivec2(gl_FragCoord.xy);
+
+		if (marchedPixel(coord))
+		{
+			vec4 sparsePosition = texelFetch(sparsePositionTexture, coord, 0);
+
+			if (sparsePosition.w >= END_PLANE)
+				discard;
+
+			surfacePosition = sparsePosition;
+			surfaceNormal = texelFetch(sparseNormalTexture, coord, 0);
+			surfaceDiffuse = texelFetch(sparseDiffuseTexture, coord, 0);
+			gl_FragDepth = calcDepth(sparsePosition.xyz);
+			return;
+		}
 
-	uint bucketContentSize[BUCKET_SIZE];
-	uint bucketContentSize2[BUCKET_SIZE];
+		vec3 positionSum = vec3(0.0);
+		vec3 normalSum = vec3(0.0);
+		vec4 diffuseSum = vec4(0.0);
+		float minimumDistance = END_PLANE;
+		float maximumDistance = 0.0;
+		uint neighbourCount = 0;
+		bool silhouette = false;
 
-	for (uint i = 0; i < BUCKET_SIZE; ++i) {
-		bucketContentSize[i] = i == 0 ? 0 : bucketContentSize[i-1];
+		for (int y = -1; y <= 1; y++)
+		{
+			for (int x = -1; x <= 1; x++)
+			{
+				ivec2 neighbour = coord + ivec2(x, y);
+
+				if (!marchedPixel(neighbour) || any(lessThan(neighbour, ivec2(0))) || any(greaterThanEqual(neighbour, framebufferSize)))
+					continue;
 
-		if (i != 0) {
-			offset = texelFetch(offsetTexture,ivec3(ivec2(gl_FragCoord.xy), i),0).r;
+				vec4 neighbourPosition = texelFetch(sparsePositionTexture, neighbour, 0);
+				silhouette = silhouette || neighbourPosition.w >= END_PLANE;
+
+				positionSum += neighbourPosition.xyz;
+				normalSum += texelFetch(sparseNormalTexture, neighbour, 0).xyz;
+				diffuseSum += texelFetch(sparseDiffuseTexture, neighbour, 0);
+				minimumDistance = min(minimumDistance, neighbourPosition.w);
+				maximumDistance = max(maximumDistance, neighbourPosition.w);
+				neighbourCount++;
+			}
 		}
 
-		// Traverse a-buffer and extract entries. (0 means empty)
-		while (offset > 0 && entryCount < maxEntries)
+		float count = float(neighbourCount);
+
+		if (neighbourCount > 0u && !silhouette && maximumDistance - minimumDistance <= reconstructionTolerance*pixelFootprint*minimumDistance &&
+			length(normalSum) >= reconstructionNormalAgreement*count)
 		{
-			indices[entryCount++] = offset;
-			offset = intersections[offset].previous;
-			bucketContentSize[i]++;
+			// Normals are in view space, the plane is intersected with the ray in world space
+			vec3 viewNormal = normalize(normalSum);
+			vec3 worldNormal = normalize(transpose(mat3(modelViewMatrix))*viewNormal);
+			float cosine = dot(V, worldNormal);
+			float t = dot(positionSum/count - near.xyz, worldNormal) / cosine;
+
+			if (abs(cosine) >= 0.1 && t >= minimumDistance - BIAS && t <= maximumDistance + BIAS)
+			{
+				vec3 reconstructedPosition = near.xyz + V*t;
+				vec4 cp = modelViewMatrix*vec4(reconstructedPosition, 1.0);
+
+				surfacePosition = vec4(reconstructedPosition, t);
+				surfaceNormal = vec4(viewNormal, cp.z / cp.w);
+				surfaceDiffuse = diffuseSum/count;
+				gl_FragDepth = calcDepth(reconstructedPosition);
+				return;
+			}
 		}
 	}
 
+	/** Reprojection through the closest inner sphere, the surface lies in front of it along the ray.
+	 * The surface found there in the previous frame is reused if it lies on the ray of this pixel, otherwise the pixel
+	 * was disoccluded or moved too far and is marched like the refreshed ones.
+	 */
+	if (temporalReuse && position.w < END_PLANE && !refreshPixel(ivec2(gl_FragCoord.xy), temporalFrame, temporalPeriod))
+	{
+		ivec2 previousPixel = reprojectPixel(position.xyz, previousModelViewProjectionMatrix, framebufferSize);
+
+		if (previousPixel.x >= 0)
+		{
+			vec4 history = texelFetch(historyPositionTexture, previousPixel, 0);
+			float t = dot(history.xyz - near.xyz, V);
+			float rayDistance = length(history.xyz - (near.xyz + V*t));
+
+			if (history.w < END_PLANE && t <= position.w + BIAS && rayDistance <= historyTolerance*pixelFootprint*t)
+			{
+				vec3 historyNormal = normalize(historyNormalMatrix*texelFetch(historyNormalTexture, previousPixel, 0).xyz);
+				vec4 cp = modelViewMatrix*vec4(history.xyz, 1.0);
+
+				surfacePosition = vec4(history.xyz, length(history.xyz - near.xyz));
+				surfaceNormal = vec4(historyNormal, cp.z / cp.w);
+				surfaceDiffuse = texelFetch(historyDiffuseTexture, previousPixel, 0);
+				gl_FragDepth = calcDepth(history.xyz);
+				return;
+			}
+		}
+	}
+
+	const uint maxEntries = 128;
+	uint entryCount = min(entryEnd - entryBegin, maxEntries);
+	uint entryCount2 = 0;
+	uint indices[maxEntries];
+	uint indices2[maxEntries];
+
+	// The entries of a pixel are contiguous, near distances are fetched once for sorting
+	float nearDistances[maxEntries];
+
+	for (uint i = 0; i < entryCount; ++i)
+	{
+		indices[i] = entryBegin + i;
+		nearDistances[i] = intersections[entryBegin + i].near;
+	}
+
 #ifdef VISUALIZE_OVERLAPS
-	fragColor = vec4(vec3(bucketContentSize[0]) / 128.0, 1.0);
+	fragColor = vec4(vec3(entryCount) / 128.0, 1.0);
 	return;
 #endif
 
+#ifdef MARCH_COUNTERS
+	uint sortComparisons = 0;
+	uint marchSteps = 0;
+	uint atomEvaluations = 0;
+#endif
+
 	// Simplified algorithm if we only have a single list
 	const bool bFirstEmpty = entryCount == 0;
 	const bool bSecondEmpty = entryCount2 == 0;
@@ -247,9 +397,6 @@ void main()
 	uint endIndex = 0;
 	uint endIndex2 = 0;
 	
-	uint currentBucket = 0;
-	uint currentBucket2 = 0;
-
 	const uint maxEntryCount = max(entryCount, entryCount2);
 
 	// sphere tracing parameters
@@ -265,6 +412,178 @@ void main()
 // 	return;
 // #endif
 
+#ifdef SLIDING_WINDOW
+	/** Incremental variant (algorithm_sketch.md), validated against marchSlidingWindow() in SurfaceMarching.cpp.
+	 * A window [startIndex, endIndex) of overlapping entries follows the ray position t and the selection sort
+	 * only advances as far as the window end, so entries behind the surface are never sorted.
+	 */
+	uint sortedCount = 0;
+	float t = 0.0;
+
+	uint groupSteps = 0;
+	float minimumDistance = END_PLANE;
+	vec4 candidatePosition = vec4(0.0);
+	vec3 candidateNormal = vec3(0.0);
+
+	vec4 rayOrigin = vec4(near.xyz,0.);
+	vec4 rayDirection = vec4(V,1.0);
+
+	while (startIndex < entryCount)
+	{
+		// Sort through startIndex, then drop entries the ray has already left
+		while (true)
+		{
+			while (sortedCount <= startIndex && sortedCount < entryCount)
+			{
+				uint minimumIndex = sortedCount;
+
+				for (uint i = sortedCount+1; i < entryCount; i++)
+					if (nearDistances[i] < nearDistances[minimumIndex])
+						minimumIndex = i;
+
+#ifdef MARCH_COUNTERS
+				sortComparisons += entryCount - sortedCount - 1;
+#endif
+				if (minimumIndex != sortedCount)
+				{
+					swap(indices[minimumIndex], indices[sortedCount]);
+					float nearDistance = nearDistances[minimumIndex];
+					nearDistances[minimumIndex] = nearDistances[sortedCount];
+					nearDistances[sortedCount] = nearDistance;
+				}
+
+				sortedCount++;
+			}
+
+			if (startIndex >= entryCount || intersections[indices[startIndex]].far >= t)
+				break;
+
+			startIndex++;
+		}
+
+		if (startIndex >= entryCount)
+			break;
+
+		// Jump over gaps, which start a new group of overlapping entries
+		if (t < nearDistances[startIndex])
+		{
+			t = nearDistances[startIndex];
+			groupSteps = 0;
+			minimumDistance = END_PLANE;
+		}
+
+		// Extend the window by all entries that start before the first one ends
+		float startFar = intersections[indices[startIndex]].far;
+		endIndex = max(endIndex, startIndex + 1);
+
+		while (endIndex < entryCount)
+		{
+			while (sortedCount <= endIndex)
+			{
+				uint minimumIndex = sortedCount;
+
+				for (uint i = sortedCount+1; i < entryCount; i++)
+					if (nearDistances[i] < nearDistances[minimumIndex])
+						minimumIndex = i;
+
+#ifdef MARCH_COUNTERS
+				sortComparisons += entryCount - sortedCount - 1;
+#endif
+				if (minimumIndex != sortedCount)
+				{
+					swap(indices[minimumIndex], indices[sortedCount]);
+					float nearDistance = nearDistances[minimumIndex];
+					nearDistances[minimumIndex] = nearDistances[sortedCount];
+					nearDistances[sortedCount] = nearDistance;
+				}
+
+				sortedCount++;
+			}
+
+			if (nearDistances[endIndex] >= startFar)
+				break;
+
+			endIndex++;
+		}
+
+		vec4 currentPosition = rayOrigin + rayDirection*t;
+
+		if (currentPosition.w > closestPosition.w)
+			break;
+
+		float sumValue = 0.0;
+		vec3 sumNormal = vec3(0.0);
+#ifdef LIPSCHITZ_STEPPING
+		float sumWeight = 0.0;
+		float minimumRadius = END_PLANE;
+#endif
+
+		for (uint j = startIndex; j < endIndex; j++)
+		{
+			uint ij = indices[j];
+
+			vec3 aj = intersections[ij].center;
+			float rj = intersections[ij].radius;
+			float weight = intersections[ij].weight;
+
+			vec3 atomOffset = currentPosition.xyz-aj;
+			float atomDistanceSquared = dot(atomOffset, atomOffset)/(rj*rj);
+
+			float atomValue = exp(-s*atomDistanceSquared) * weight;
+			sumValue += atomValue;
+			sumNormal += atomValue*normalize(atomOffset);
+#ifdef LIPSCHITZ_STEPPING
+			sumWeight += weight;
+			minimumRadius = min(minimumRadius, rj);
+#endif
+		}
+
+#ifdef MARCH_COUNTERS
+		marchSteps++;
+		atomEvaluations += endIndex - startIndex;
+#endif
+
+		float surfaceDistance = sqrt(-log(sumValue) / (s))-1.0;
+
+		if (surfaceDistance < eps)
+		{
+			closestPosition = currentPosition;
+			closestNormal = sumNormal;
+			break;
+		}
+
+#ifdef LIPSCHITZ_STEPPING
+		float lipschitz = sqrt(1.0 + log(max(sumWeight, 1.0)) / s) / minimumRadius;
+
+		// Nothing to find before the first entry of the window ends, continue just behind it
+		if (surfaceDistance > lipschitz*(startFar - t))
+		{
+			t = startFar + eps;
+			continue;
+		}
+#endif
+
+		if (surfaceDistance < minimumDistance)
+		{
+			minimumDistance = surfaceDistance;
+			candidatePosition = currentPosition;
+			candidateNormal = sumNormal;
+		}
+
+		if (++groupSteps >= maximumSteps)
+		{
+			closestPosition = candidatePosition;
+			closestNormal = candidateNormal;
+			break;
+		}
+
+#ifdef LIPSCHITZ_STEPPING
+		t += surfaceDistance/lipschitz;
+#else
+		t += surfaceDistance*omega;
+#endif
+	}
+#else
 	/** N^2 - selection sort
 	 * N => 2 * n/2 => 2 * (n/2)^2 = n^2 / 2
 	 * ^ Splitting the sorting into two lists, halves the complexity
@@ -278,18 +597,23 @@ void main()
 		if (currentIndex < entryCount - 1) {
 			uint minimumIndex = currentIndex;
 
-			// Increment bucket index
-			while (bucketContentSize[currentBucket] <= currentIndex)
-				currentBucket++;
-
-			// Find minimum index in bucket (based on near distance)
-			for(uint i = minimumIndex+1; i < bucketContentSize[currentBucket]; i++)
-				if(intersections[indices[i]].near < intersections[indices[minimumIndex]].near)
+			// Find minimum index in the remaining entries (based on near distance)
+			for(uint i = minimumIndex+1; i < entryCount; i++)
+				if(nearDistances[i] < nearDistances[minimumIndex])
 					minimumIndex = i;
+
+#ifdef MARCH_COUNTERS
+			sortComparisons += entryCount - currentIndex - 1;
+#endif
 			
 			// Selection sort swap:
 			if (minimumIndex != currentIndex)
+			{
 				swap(indices[minimumIndex], indices[currentIndex]);
+				float nearDistance = nearDistances[minimumIndex];
+				nearDistances[minimumIndex] = nearDistances[currentIndex];
+				nearDistances[currentIndex] = nearDistance;
+			}
 		}
 
 		// Increment endIndex (first list)
@@ -338,6 +662,10 @@ void main()
 			float sumValue = 0.0;
 			vec3 sumNormal = vec3(0.0);
 			vec3 sumColor = vec3(0.0);
+#ifdef LIPSCHITZ_STEPPING
+			float sumWeight = 0.0;
+			float minimumRadius = END_PLANE;
+#endif
 			
 			// sum contributions of atoms in the neighborhood (for first surface)
 			for (uint j = startIndex; j < endIndex; j++)
@@ -359,8 +687,17 @@ void main()
 				
 				sumValue += atomValue;
 				sumNormal += atomNormal;
+#ifdef LIPSCHITZ_STEPPING
+				sumWeight += weight;
+				minimumRadius = min(minimumRadius, rj);
+#endif
 			}
 			
+#ifdef MARCH_COUNTERS
+			marchSteps++;
+			atomEvaluations += endIndex - startIndex;
+#endif
+
 			/** -1 because were searching for the distance to the surface when p(x) = 1.0
 				* Distance is defined as d(x) = p(x) - t, and as described in paper we estimate
 				* t = 1
@@ -377,6 +714,17 @@ void main()
 				break;
 			}
 
+#ifdef LIPSCHITZ_STEPPING
+			/** Outside of the surface the gradient of the distance estimate is bounded by sqrt(1 + log(W) / s) / r for a window
+			 * with total weight W and smallest radius r, so steps of surfaceDistance / lipschitz never pass the surface.
+			 * The same bound shows when the surface cannot be reached before the end of the window.
+			 */
+			float lipschitz = sqrt(1.0 + log(max(sumWeight, 1.0)) / s) / minimumRadius;
+
+			if (surfaceDistance > lipschitz*(farDistance - t))
+				break;
+#endif
+
 			// Note: Commenting out this makes a very cool effect. :o
 			if (surfaceDistance < minimumDistance)
 			{
@@ -393,7 +741,11 @@ void main()
 			// Enhanced Sphere Tracing. Proceedings of Smart Tools and Apps for Graphics (Eurographics Italian Chapter Conference), pp. 1--8, 2014. 
 			// http://dx.doi.org/10.2312/stag.20141233
 			// t += surfaceDistance*omega;
+#ifdef LIPSCHITZ_STEPPING
+			t += surfaceDistance/lipschitz;
+#else
 			t += surfaceDistance*omega;
+#endif
 		}
 		
 		// Only check for new closest position if all iterations passed (if t never overshot farDistance)
@@ -408,6 +760,12 @@ void main()
 		++startIndex;
 	}
 
+#endif
+
+#ifdef ITERATION_STATISTICS
+	pixelStatistics[pixel] = uvec4(entryCount, sortComparisons, marchSteps, atomEvaluations);
+#endif
+
 	if (closestPosition.w >= 65535.0)
 		discard;
 
@@ -452,6 +810,9 @@ void main()
 	closestNormal.xyz = normalize(closestNormal.xyz);
 	surfaceNormal = vec4(closestNormal.xyz,cp.z);
 
+	if (compactGBuffer)
+		surfaceNormal = vec4(packNormal(closestNormal.xyz), 0.0, 0.0);
+
 	// vec3 col = vec3(1.0 - closestPosition.w / 20.0);
 	// float phong = max(dot(closestNormal.xyz, vec3(0, .0, 1.)), 0.15);
 	// // fragColor = vec4(vec3(entryCount) / 128.0, 1.0);
@@ -462,6 +823,12 @@ void main()
 // 	diffuseColor *= materialColor;
 // #endif
 
+#ifdef ITERATION_HEATMAP
+	// Sphere tracing steps of the pixel from blue (none) to red (64 or more)
+	float heat = clamp(float(marchSteps) / 64.0, 0.0, 1.0);
+	diffuseColor = clamp(vec3(1.5) - abs(4.0*heat - vec3(3.0, 2.0, 1.0)), 0.0, 1.0);
+#endif
+
 	surfaceDiffuse = vec4(diffuseColor,1.0);
 	// sphereDiffuse = vec4(diffuseSphereColor,1.0);
 	gl_FragDepth = calcDepth(closestPosition.xyz);
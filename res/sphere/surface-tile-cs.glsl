@@ -0,0 +1,366 @@
+#version 450
+
+#define END_PLANE 65535.0
+#define MAX_TILE_SPHERES 512
+
+// Tiled counterpart of surface-fs.glsl, one work group per 16x16 pixel tile.
+// The spheres of a tile are loaded into shared memory once and sorted by their smallest distance to the eye,
+// so every pixel collects its intersections in nearly sorted order and marches against shared data.
+// Tiles with more spheres than fit fall back to the per-pixel lists in the intersection buffer.
+layout(local_size_x = 16, local_size_y = 16) in;
+
+uniform mat4 modelViewMatrix;
+uniform mat4 inverseModelViewProjectionMatrix;
+uniform mat3 normalMatrix;
+uniform vec3 eyePosition;
+uniform float sharpness;
+uniform ivec2 framebufferSize;
+uniform ivec2 tileCount;
+uniform uint tileCapacity = 0u;
+// Entries of the intersection buffer, the spawn pass drops those beyond it while offsets keep counting them
+uniform uint capacity = 0u;
+
+layout(binding = 2) uniform sampler2D positionTexture;
+layout(binding = 3) uniform sampler2D normalTexture;
+
+layout(rgba32f, binding = 0) uniform writeonly image2D surfacePosition;
+layout(rgba32f, binding = 1) uniform writeonly image2D surfaceNormal;
+layout(rgba32f, binding = 2) uniform writeonly image2D surfaceDiffuse;
+
+struct BufferEntry
+{
+	float near;
+	float far;
+	vec3 center;
+	uint id;
+	float radius;
+	float sharpness;
+	float weight;
+};
+
+struct Footprint
+{
+	vec4 sphere;
+	ivec4 rectangle;
+	uint id;
+	float radius;
+	float sharpness;
+	float weight;
+};
+
+layout(std430, binding = 1) readonly buffer intersectionBuffer
+{
+	BufferEntry intersections[];
+};
+
+layout(std430, binding = 3) readonly buffer offsetBuffer
+{
+	uint offsets[];
+};
+
+layout(std430, binding = 5) readonly buffer footprintBuffer
+{
+	Footprint footprints[];
+};
+
+layout(std430, binding = 8) readonly buffer tileOffsetBuffer
+{
+	uint tileOffsets[];
+};
+
+layout(std430, binding = 9) readonly buffer tileSphereBuffer
+{
+	uint tileSpheres[];
+};
+
+// Center and intersection radius, density radius and weight
+shared vec4 sharedSpheres[MAX_TILE_SPHERES];
+shared vec2 sharedParameters[MAX_TILE_SPHERES];
+shared float sharedKeys[MAX_TILE_SPHERES];
+shared uint sharedOrder[MAX_TILE_SPHERES];
+
+// Entries refer to the shared arrays or, in the fallback, to the intersection buffer
+bool tileShared = false;
+
+vec3 entryCenter(uint index)
+{
+	return tileShared ? sharedSpheres[index].xyz : intersections[index].center;
+}
+
+float entryRadius(uint index)
+{
+	return tileShared ? sharedParameters[index].x : intersections[index].radius;
+}
+
+float entryWeight(uint index)
+{
+	return tileShared ? sharedParameters[index].y : intersections[index].weight;
+}
+
+void main()
+{
+	uint tile = gl_WorkGroupID.y * uint(tileCount.x) + gl_WorkGroupID.x;
+	ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+	bool inside = all(lessThan(pixel, framebufferSize));
+	uint pixelIndex = uint(pixel.y) * uint(framebufferSize.x) + uint(pixel.x);
+
+	uint tileBegin = tileOffsets[tile];
+	uint tileEnd = tileOffsets[tile + 1u];
+	uint tileSphereCount = tileEnd - tileBegin;
+
+	// The tile lists are complete if no reference was dropped by tile-fill-cs.glsl
+	tileShared = tileEnd <= tileCapacity && tileSphereCount <= MAX_TILE_SPHERES;
+
+	if (tileShared)
+	{
+		// Padding up to a power of two for the bitonic sort
+		uint sortCount = 1u;
+
+		while (sortCount < tileSphereCount)
+			sortCount <<= 1u;
+
+		for (uint i = gl_LocalInvocationIndex; i < sortCount; i += 256u)
+		{
+			if (i < tileSphereCount)
+			{
+				Footprint footprint = footprints[tileSpheres[tileBegin + i]];
+				sharedSpheres[i] = footprint.sphere;
+				sharedParameters[i] = vec2(footprint.radius, footprint.weight);
+				sharedKeys[i] = length(footprint.sphere.xyz - eyePosition) - footprint.sphere.w;
+			}
+			else
+			{
+				sharedKeys[i] = END_PLANE;
+			}
+
+			sharedOrder[i] = i;
+		}
+
+		barrier();
+
+		for (uint size = 2u; size <= sortCount; size <<= 1u)
+		{
+			for (uint stride = size >> 1u; stride > 0u; stride >>= 1u)
+			{
+				for (uint t = gl_LocalInvocationIndex; t < sortCount / 2u; t += 256u)
+				{
+					uint i = 2u * stride * (t / stride) + t % stride;
+					uint j = i + stride;
+					bool ascending = (i & size) == 0u;
+
+					if ((sharedKeys[i] > sharedKeys[j]) == ascending)
+					{
+						float key = sharedKeys[i];
+						sharedKeys[i] = sharedKeys[j];
+						sharedKeys[j] = key;
+
+						uint order = sharedOrder[i];
+						sharedOrder[i] = sharedOrder[j];
+						sharedOrder[j] = order;
+					}
+				}
+
+				barrier();
+			}
+		}
+	}
+
+	// No barriers below this point
+	if (!inside)
+		return;
+
+	vec4 position = texelFetch(positionTexture, pixel, 0);
+	vec4 normal = texelFetch(normalTexture, pixel, 0);
+
+	vec2 ndc = 2.0 * (vec2(pixel) + 0.5) / vec2(framebufferSize) - 1.0;
+
+	vec4 near = inverseModelViewProjectionMatrix * vec4(ndc, -1.0, 1.0);
+	near /= near.w;
+
+	vec4 far = inverseModelViewProjectionMatrix * vec4(ndc, 1.0, 1.0);
+	far /= far.w;
+
+	vec3 V = normalize(far.xyz - near.xyz);
+
+	const uint maxEntries = 128;
+	uint entryCount = 0;
+	uint indices[maxEntries];
+	float nearDistances[maxEntries];
+	float farDistances[maxEntries];
+
+	if (tileShared)
+	{
+		// Same intersection and depth test as the list construction, insertion keeps the nearest entries sorted
+		for (uint k = 0u; k < tileSphereCount; k++)
+		{
+			uint index = sharedOrder[k];
+			vec4 sphere = sharedSpheres[index];
+
+			vec3 oc = near.xyz - sphere.xyz;
+			float loc = dot(V, oc);
+			float under_square_root = loc * loc - dot(oc, oc) + sphere.w*sphere.w;
+
+			if (under_square_root <= 0.0)
+				continue;
+
+			float da = -loc + sqrt(under_square_root);
+			float ds = -loc - sqrt(under_square_root);
+			float nearDistance = length(min(da, ds) * V);
+
+			if (nearDistance > position.w)
+				continue;
+
+			if (entryCount == maxEntries && nearDistance >= nearDistances[maxEntries - 1u])
+				continue;
+
+			uint slot = min(entryCount, maxEntries - 1u);
+			entryCount = min(entryCount + 1u, maxEntries);
+
+			while (slot > 0u && nearDistances[slot - 1u] > nearDistance)
+			{
+				indices[slot] = indices[slot - 1u];
+				nearDistances[slot] = nearDistances[slot - 1u];
+				farDistances[slot] = farDistances[slot - 1u];
+				slot--;
+			}
+
+			indices[slot] = index;
+			nearDistances[slot] = nearDistance;
+			farDistances[slot] = length(max(da, ds) * V);
+		}
+	}
+	else
+	{
+		uint entryBegin = min(offsets[pixelIndex], capacity);
+		entryCount = min(min(offsets[pixelIndex + 1u], capacity) - entryBegin, maxEntries);
+
+		for (uint i = 0; i < entryCount; ++i)
+		{
+			uint index = entryBegin + i;
+			float nearDistance = intersections[index].near;
+			uint slot = i;
+
+			while (slot > 0u && nearDistances[slot - 1u] > nearDistance)
+			{
+				indices[slot] = indices[slot - 1u];
+				nearDistances[slot] = nearDistances[slot - 1u];
+				farDistances[slot] = farDistances[slot - 1u];
+				slot--;
+			}
+
+			indices[slot] = index;
+			nearDistances[slot] = nearDistance;
+			farDistances[slot] = intersections[index].far;
+		}
+	}
+
+	if (entryCount == 0u)
+		return;
+
+	// From here on the same as surface-fs.glsl, with the entries already sorted
+	vec4 closestPosition = position;
+	vec3 closestNormal = normal.xyz;
+
+	uint startIndex = 0;
+	uint endIndex = 0;
+
+	// sphere tracing parameters
+	const uint maximumSteps = 32; // maximum number of steps
+	const float eps = 0.0125; // threshold for detected intersection
+	const float omega = 1.2; // over-relaxation factor
+
+	const float s = sharpness;
+
+	for (uint currentIndex = 0; currentIndex <= entryCount; ++currentIndex)
+	{
+		while (endIndex < currentIndex && nearDistances[endIndex] <= farDistances[startIndex])
+			++endIndex;
+
+		// If we've yet to find a set of intersecting spheres, keep looping
+		if (endIndex < entryCount && nearDistances[endIndex] <= farDistances[startIndex])
+			continue;
+
+		float nearDistance = nearDistances[startIndex];
+		float farDistance = farDistances[endIndex-1];
+
+		float maximumDistance = (farDistance-nearDistance);
+		float surfaceDistance = 1.0;
+
+		vec4 rayOrigin = vec4(near.xyz,0.);
+		vec4 rayDirection = vec4(V,1.0);
+		vec4 currentPosition;
+
+		vec4 candidatePosition = rayOrigin + rayDirection * nearDistance;
+		vec3 candidateNormal = vec3(0.0);
+
+		float minimumDistance = maximumDistance;
+
+		uint currentStep = 0;
+		float t = nearDistance;
+
+		while (++currentStep <= maximumSteps && t <= farDistance)
+		{
+			currentPosition = rayOrigin + rayDirection*t;
+
+			if (currentPosition.w > closestPosition.w)
+				break;
+
+			float sumValue = 0.0;
+			vec3 sumNormal = vec3(0.0);
+
+			for (uint j = startIndex; j < endIndex; j++)
+			{
+				uint ij = indices[j];
+				float rj = entryRadius(ij);
+
+				vec3 atomOffset = currentPosition.xyz-entryCenter(ij);
+				float atomDistanceSquared = dot(atomOffset, atomOffset)/(rj*rj);
+
+				float atomValue = exp(-s*atomDistanceSquared) * entryWeight(ij);
+				vec3 atomNormal = atomValue*normalize(atomOffset);
+
+				sumValue += atomValue;
+				sumNormal += atomNormal;
+			}
+
+			surfaceDistance = sqrt(-log(sumValue) / (s))-1.0;
+
+			if (surfaceDistance < eps)
+			{
+				closestPosition = currentPosition;
+				closestNormal = sumNormal;
+				break;
+			}
+
+			if (surfaceDistance < minimumDistance)
+			{
+				minimumDistance = surfaceDistance;
+				candidatePosition = currentPosition;
+				candidateNormal = sumNormal;
+			}
+
+			t += surfaceDistance*omega;
+		}
+
+		if (currentStep > maximumSteps)
+		{
+			closestPosition = candidatePosition;
+			closestNormal = candidateNormal;
+		}
+
+		++startIndex;
+	}
+
+	if (closestPosition.w >= END_PLANE)
+		return;
+
+	vec4 cp = modelViewMatrix*vec4(closestPosition.xyz, 1.0);
+	cp = cp / cp.w;
+
+	closestNormal.xyz = normalMatrix*closestNormal.xyz;
+	closestNormal.xyz = normalize(closestNormal.xyz);
+
+	imageStore(surfacePosition, pixel, closestPosition);
+	imageStore(surfaceNormal, pixel, vec4(closestNormal.xyz,cp.z));
+	imageStore(surfaceDiffuse, pixel, vec4(1.0));
+}
@@ -0,0 +1,33 @@
+// Temporal reprojection of the surface and the ambient occlusion, the history targets are kept by TemporalHistory.cpp
+
+// Position of each pixel of a 4x4 block in the refresh order, the first n of every 16 are spread over the block
+const uint refreshOrder[16] = uint[16](0u, 8u, 2u, 10u, 12u, 4u, 14u, 6u, 3u, 11u, 1u, 9u, 15u, 7u, 13u, 5u);
+
+// Every pixel is recomputed in one of period frames, for a period of 1, 2, 4, 8 or 16
+bool refreshPixel(ivec2 pixel, uint frame, uint period)
+{
+	uint subset = refreshOrder[(pixel.y & 3) * 4 + (pixel.x & 3)] * period / 16u;
+	return subset == frame % period;
+}
+
+// Pixel of the previous frame that showed a world position, -1 if it was outside of its view
+ivec2 reprojectPixel(vec3 position, mat4 previousModelViewProjectionMatrix, ivec2 size)
+{
+	vec4 clip = previousModelViewProjectionMatrix * vec4(position, 1.0);
+
+	if (clip.w <= 0.0)
+		return ivec2(-1);
+
+	ivec2 pixel = ivec2(floor((clip.xy / clip.w * 0.5 + 0.5) * vec2(size)));
+
+	if (any(lessThan(pixel, ivec2(0))) || any(greaterThanEqual(pixel, size)))
+		return ivec2(-1);
+
+	return pixel;
+}
+
+// The history shows the same surface if it is within tolerance of the position, pixels without surface never match
+bool matchingHistory(vec3 position, vec4 history, float tolerance)
+{
+	return history.w < 65535.0 && distance(position, history.xyz) <= tolerance;
+}
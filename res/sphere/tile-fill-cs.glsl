@@ -0,0 +1,67 @@
+#version 450
+
+// Writes the footprint indices into the ranges given by the exclusive scan of the tile counts
+layout(local_size_x = 256) in;
+
+uniform ivec2 tileCount;
+uniform uint footprintCount;
+uniform uint capacity = 0u;
+
+struct Footprint
+{
+	vec4 sphere;
+	ivec4 rectangle;
+	uint id;
+	float radius;
+	float sharpness;
+	float weight;
+};
+
+layout(std430, binding = 9) buffer tileSphereBuffer
+{
+	uint tileSpheres[];
+};
+
+layout(std430, binding = 8) buffer tileOffsetBuffer
+{
+	uint tileOffsets[];
+};
+
+layout(std430, binding = 5) buffer footprintBuffer
+{
+	Footprint footprints[];
+};
+
+// Reset after counting and reused as write cursor
+layout(std430, binding = 6) buffer tileCountBuffer
+{
+	uint tileCounts[];
+};
+
+void main()
+{
+	uint index = gl_GlobalInvocationID.x;
+
+	if (index >= footprintCount)
+		return;
+
+	ivec4 rectangle = footprints[index].rectangle;
+
+	if (rectangle.x > rectangle.z)
+		return;
+
+	ivec4 tiles = rectangle / 16;
+
+	for (int y = tiles.y; y <= tiles.w; y++)
+	{
+		for (int x = tiles.x; x <= tiles.z; x++)
+		{
+			uint tile = uint(y * tileCount.x + x);
+			uint slot = tileOffsets[tile] + atomicAdd(tileCounts[tile], 1u);
+
+			// The total is read back by the host to size the buffer, references beyond the capacity are dropped for this frame
+			if (slot < capacity)
+				tileSpheres[slot] = index;
+		}
+	}
+}
@@ -0,0 +1,117 @@
+#version 450
+
+// Screen footprints of the spheres of one level of detail, counted per 16x16 pixel tile
+layout(local_size_x = 256) in;
+
+uniform mat4 modelViewMatrix;
+uniform mat4 projectionMatrix;
+uniform float radiusScale;
+uniform float clipRadiusScale;
+uniform float outerRadius = 1.7;
+uniform float individualSharpness = 1.0;
+uniform float weight = 1.0;
+uniform float clustering = 0.0;
+uniform float nearPlaneZ = -0.125;
+uniform ivec2 framebufferSize;
+uniform ivec2 tileCount;
+uniform uint sphereCount;
+uniform uint sphereOffset;
+// Interpolation towards the next timestep of the vertices, only read if larger than zero
+uniform float animationDelta = 0.0;
+
+// Protein::HierchicalPoints (position, parent position, radius) is tightly packed, which has no std430 struct equivalent
+layout(std430, binding = 0) readonly buffer vertexBuffer
+{
+	float vertices[];
+};
+
+layout(std430, binding = 10) readonly buffer nextVertexBuffer
+{
+	float nextVertices[];
+};
+
+struct Footprint
+{
+	vec4 sphere;
+	ivec4 rectangle;
+	uint id;
+	float radius;
+	float sharpness;
+	float weight;
+};
+
+layout(std430, binding = 5) buffer footprintBuffer
+{
+	Footprint footprints[];
+};
+
+layout(std430, binding = 6) buffer tileCountBuffer
+{
+	uint tileCounts[];
+};
+
+void main()
+{
+	uint index = gl_GlobalInvocationID.x;
+
+	if (index >= sphereCount)
+		return;
+
+	uint base = index * 9u;
+	vec4 position = vec4(vertices[base], vertices[base + 1u], vertices[base + 2u], vertices[base + 3u]);
+	vec3 parentPosition = vec3(vertices[base + 4u], vertices[base + 5u], vertices[base + 6u]);
+
+	// Same as INTERPOLATION in sphere-vs.glsl
+	if (animationDelta > 0.0)
+		position.xyz = mix(position.xyz, vec3(nextVertices[base], nextVertices[base + 1u], nextVertices[base + 2u]), animationDelta);
+
+	// Same as sphere-vs.glsl and sphere-gs.glsl
+	uint sphereId = floatBitsToUint(position.w);
+	uint elementId = bitfieldExtract(sphereId, 0, 8);
+	float instanceScale = mix(1.0, 2.0, float(elementId) / 1000.0);
+	vec3 center = mix(position.xyz, parentPosition, clustering);
+
+	Footprint footprint;
+	footprint.sphere = vec4(center, radiusScale * instanceScale);
+	footprint.rectangle = ivec4(0, 0, -1, -1);
+	footprint.id = sphereId;
+	footprint.radius = outerRadius;
+	footprint.sharpness = individualSharpness;
+	footprint.weight = weight;
+
+	vec4 c = modelViewMatrix * vec4(center, 1.0);
+	float radius = length(modelViewMatrix * vec4(footprint.sphere.w, 0.0, 0.0, 0.0));
+	float clipRadius = length(modelViewMatrix * vec4(clipRadiusScale * instanceScale, 0.0, 0.0, 0.0));
+
+	// Skip whole sphere if intersecting with near plane
+	if (c.z + clipRadius < nearPlaneZ)
+	{
+		// Conservative pixel rectangle from the projected corners of the view space bounding box
+		vec2 minimum = vec2(1.0);
+		vec2 maximum = vec2(-1.0);
+
+		for (int corner = 0; corner < 8; corner++)
+		{
+			vec3 offset = vec3((corner & 1) != 0 ? radius : -radius, (corner & 2) != 0 ? radius : -radius, (corner & 4) != 0 ? radius : -radius);
+			vec4 clip = projectionMatrix * vec4(c.xyz + offset, 1.0);
+			vec2 ndc = clip.xy / clip.w;
+			minimum = min(minimum, ndc);
+			maximum = max(maximum, ndc);
+		}
+
+		ivec2 lower = max(ivec2(floor((minimum * 0.5 + 0.5) * vec2(framebufferSize))), ivec2(0));
+		ivec2 upper = min(ivec2(ceil((maximum * 0.5 + 0.5) * vec2(framebufferSize))), framebufferSize - 1);
+
+		if (all(lessThanEqual(lower, upper)))
+		{
+			footprint.rectangle = ivec4(lower, upper);
+			ivec4 tiles = footprint.rectangle / 16;
+
+			for (int y = tiles.y; y <= tiles.w; y++)
+				for (int x = tiles.x; x <= tiles.z; x++)
+					atomicAdd(tileCounts[y * tileCount.x + x], 1u);
+		}
+	}
+
+	footprints[sphereOffset + index] = footprint;
+}
@@ -0,0 +1,157 @@
+#version 450
+
+// Per-pixel intersection lists from the tile lists, one work group per 16x16 pixel tile.
+// The footprints of a tile are staged in shared memory and every invocation intersects them with the ray through its pixel.
+// The count pass only writes the list lengths, the fill pass writes the entries sorted by near distance into the scanned ranges.
+layout(local_size_x = 16, local_size_y = 16) in;
+
+uniform mat4 inverseModelViewProjectionMatrix;
+uniform ivec2 framebufferSize;
+uniform ivec2 tileCount;
+uniform uint capacity = 0u;
+uniform uint tileCapacity = 0u;
+uniform bool countPass = false;
+
+layout(binding = 0) uniform sampler2D positionTexture;
+
+struct Footprint
+{
+	vec4 sphere;
+	ivec4 rectangle;
+	uint id;
+	float radius;
+	float sharpness;
+	float weight;
+};
+
+struct BufferEntry
+{
+	float near;
+	float far;
+	vec3 center;
+	uint id;
+	float radius;
+	float sharpness;
+	float weight;
+};
+
+layout(std430, binding = 1) buffer intersectionBuffer
+{
+	BufferEntry intersections[];
+};
+
+layout(std430, binding = 3) buffer offsetBuffer
+{
+	uint offsets[];
+};
+
+layout(std430, binding = 4) buffer countBuffer
+{
+	uint counts[];
+};
+
+layout(std430, binding = 5) readonly buffer footprintBuffer
+{
+	Footprint footprints[];
+};
+
+layout(std430, binding = 8) readonly buffer tileOffsetBuffer
+{
+	uint tileOffsets[];
+};
+
+layout(std430, binding = 9) readonly buffer tileSphereBuffer
+{
+	uint tileSpheres[];
+};
+
+shared Footprint tileFootprints[256];
+
+void main()
+{
+	uint tile = gl_WorkGroupID.y * uint(tileCount.x) + gl_WorkGroupID.x;
+	ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+	bool inside = all(lessThan(pixel, framebufferSize));
+	uint pixelIndex = uint(pixel.y) * uint(framebufferSize.x) + uint(pixel.x);
+
+	// Ray through the pixel center, starting on the near plane as in spawn-fs.glsl
+	vec2 ndc = 2.0 * (vec2(pixel) + 0.5) / vec2(framebufferSize) - 1.0;
+
+	vec4 near = inverseModelViewProjectionMatrix * vec4(ndc, -1.0, 1.0);
+	near /= near.w;
+
+	vec4 far = inverseModelViewProjectionMatrix * vec4(ndc, 1.0, 1.0);
+	far /= far.w;
+
+	vec3 V = normalize(far.xyz - near.xyz);
+	float depthLimit = inside ? texelFetch(positionTexture, pixel, 0).w : 0.0;
+
+	uint entryBegin = (inside && !countPass) ? offsets[pixelIndex] : 0u;
+	uint entryCount = 0u;
+
+	// References beyond the capacity were dropped by tile-fill-cs.glsl
+	uint tileBegin = min(tileOffsets[tile], tileCapacity);
+	uint tileEnd = min(tileOffsets[tile + 1u], tileCapacity);
+
+	for (uint chunk = tileBegin; chunk < tileEnd; chunk += 256u)
+	{
+		uint chunkSize = min(tileEnd - chunk, 256u);
+
+		if (gl_LocalInvocationIndex < chunkSize)
+			tileFootprints[gl_LocalInvocationIndex] = footprints[tileSpheres[chunk + gl_LocalInvocationIndex]];
+
+		barrier();
+
+		for (uint i = 0u; inside && i < chunkSize; i++)
+		{
+			ivec4 rectangle = tileFootprints[i].rectangle;
+
+			if (any(lessThan(pixel, rectangle.xy)) || any(greaterThan(pixel, rectangle.zw)))
+				continue;
+
+			// Same as calcSphereIntersection in spawn-fs.glsl
+			vec3 oc = near.xyz - tileFootprints[i].sphere.xyz;
+			float loc = dot(V, oc);
+			float r = tileFootprints[i].sphere.w;
+			float under_square_root = loc * loc - dot(oc, oc) + r*r;
+
+			if (under_square_root <= 0.0)
+				continue;
+
+			float da = -loc + sqrt(under_square_root);
+			float ds = -loc - sqrt(under_square_root);
+
+			BufferEntry entry;
+			entry.near = length(min(da, ds) * V);
+
+			if (entry.near > depthLimit)
+				continue;
+
+			uint index = entryBegin + entryCount++;
+
+			if (countPass || index >= capacity)
+				continue;
+
+			entry.far = length(max(da, ds) * V);
+			entry.center = tileFootprints[i].sphere.xyz;
+			entry.id = tileFootprints[i].id;
+			entry.radius = tileFootprints[i].radius;
+			entry.sharpness = tileFootprints[i].sharpness;
+			entry.weight = tileFootprints[i].weight;
+
+			// Insertion into the sorted range, which belongs to this invocation alone
+			while (index > entryBegin && intersections[index - 1u].near > entry.near)
+			{
+				intersections[index] = intersections[index - 1u];
+				index--;
+			}
+
+			intersections[index] = entry;
+		}
+
+		barrier();
+	}
+
+	if (inside && countPass)
+		counts[pixelIndex] = entryCount;
+}
@@ -0,0 +1,84 @@
+#include "CompactGBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace dynamol;
+using namespace glm;
+
+namespace
+{
+	// Background value of the w component of the surface position target
+	constexpr float endPlane = 65535.0f;
+
+	// Stored in a GL_RG16 target
+	vec2 quantize(const vec2& value)
+	{
+		return round(clamp(value, 0.0f, 1.0f) * 65535.0f) / 65535.0f;
+	}
+
+	vec3 reconstructPosition(const vec2& ndc, float depth, const mat4& inverseModelViewProjectionMatrix)
+	{
+		vec4 position = inverseModelViewProjectionMatrix * vec4(ndc, depth * 2.0f - 1.0f, 1.0f);
+		return vec3(position) / position.w;
+	}
+}
+
+vec2 dynamol::packNormal(const vec3& normal)
+{
+	const vec3 n = normal / (std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z));
+	vec2 p = vec2(n.x, n.y);
+
+	if (n.z < 0.0f)
+		p = (1.0f - abs(vec2(n.y, n.x))) * vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+
+	return p * 0.5f + 0.5f;
+}
+
+vec3 dynamol::unpackNormal(const vec2& packed)
+{
+	const vec2 p = packed * 2.0f - 1.0f;
+	vec3 n = vec3(p, 1.0f - std::abs(p.x) - std::abs(p.y));
+	const float t = std::max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return normalize(n);
+}
+
+GBufferComparison dynamol::compareCompactGBuffer(std::span<const vec4> positions, std::span<const vec4> normals, std::span<const float> depths, const ivec2& size, const mat4& inverseModelViewProjectionMatrix)
+{
+	GBufferComparison comparison;
+
+	for (int y = 0; y < size.y; y++)
+	{
+		for (int x = 0; x < size.x; x++)
+		{
+			const std::size_t i = std::size_t(y) * size.x + x;
+
+			if (i >= positions.size() || i >= normals.size() || i >= depths.size() || positions[i].w >= endPlane)
+				continue;
+
+			const vec3 normal = normalize(vec3(normals[i]));
+			const vec3 decoded = unpackNormal(quantize(packNormal(normal)));
+			const double normalError = degrees(std::acos(double(clamp(dot(normal, decoded), -1.0f, 1.0f))));
+
+			const vec2 ndc = 2.0f * (vec2(x, y) + 0.5f) / vec2(size) - 1.0f;
+			const vec3 position = reconstructPosition(ndc, depths[i], inverseModelViewProjectionMatrix);
+			const double positionError = double(length(position - vec3(positions[i])));
+
+			comparison.pixels++;
+			comparison.meanNormalError += normalError;
+			comparison.maximumNormalError = std::max(comparison.maximumNormalError, normalError);
+			comparison.meanPositionError += positionError;
+			comparison.maximumPositionError = std::max(comparison.maximumPositionError, positionError);
+		}
+	}
+
+	if (comparison.pixels > 0)
+	{
+		comparison.meanNormalError /= double(comparison.pixels);
+		comparison.meanPositionError /= double(comparison.pixels);
+	}
+
+	return comparison;
+}
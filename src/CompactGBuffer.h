@@ -0,0 +1,28 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <span>
+
+namespace dynamol
+{
+	// Octahedral normal encoding of gbuffer.glsl, both components in [0,1] for a GL_RG16 target
+	glm::vec2 packNormal(const glm::vec3& normal);
+	glm::vec3 unpackNormal(const glm::vec2& packed);
+
+	// Errors of the compact G-buffer against the full precision surface targets, over the pixels with surface
+	struct GBufferComparison
+	{
+		std::size_t pixels = 0;
+		// Angle between the stored and the decoded 16 bit normal in degrees
+		double meanNormalError = 0.0;
+		double maximumNormalError = 0.0;
+		// Distance between the stored position and the one reconstructed from the depth buffer
+		double meanPositionError = 0.0;
+		double maximumPositionError = 0.0;
+	};
+
+	// Positions and normals are the RGBA32F surface targets, depths the window space depth of the same frame, all
+	// row by row from the bottom as read back from OpenGL
+	GBufferComparison compareCompactGBuffer(std::span<const glm::vec4> positions, std::span<const glm::vec4> normals, std::span<const float> depths, const glm::ivec2& size, const glm::mat4& inverseModelViewProjectionMatrix);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace dynamol
+{
+	// Scalar field on a sparse grid of cubic blocks, the surface is where the field equals isovalue() and larger values are inside.
+	// Grid point g lies at origin() + g * spacing(), block b covers the cells between grid points b * BlockSize and (b + 1) * BlockSize.
+	class DensityField
+	{
+	public:
+		static constexpr int BlockSize = 8;
+		// Samples per block edge, including one grid point of apron on each side for central differences
+		static constexpr int SampleSize = BlockSize + 3;
+		static constexpr int SampleCount = SampleSize * SampleSize * SampleSize;
+
+		virtual ~DensityField() = default;
+
+		virtual float isovalue() const = 0;
+		virtual float spacing() const = 0;
+		virtual glm::vec3 origin() const = 0;
+
+		// Blocks that can contain the surface, every other block is either completely inside or outside
+		virtual const std::vector<glm::ivec3>& blocks() const = 0;
+
+		// Fills SampleCount values for the grid points b * BlockSize - 1 to (b + 1) * BlockSize + 1, x runs fastest
+		virtual void sampleBlock(const glm::ivec3& block, float* samples) const = 0;
+
+		virtual float value(const glm::vec3& position) const = 0;
+		virtual glm::vec3 gradient(const glm::vec3& position) const = 0;
+
+		glm::vec3 position(const glm::vec3& gridPoint) const
+		{
+			return origin() + gridPoint * spacing();
+		}
+
+		static int sampleIndex(int x, int y, int z)
+		{
+			return ((z + 1) * SampleSize + (y + 1)) * SampleSize + (x + 1);
+		}
+
+		static std::uint64_t blockKey(const glm::ivec3& block)
+		{
+			constexpr std::int64_t bias = 1 << 20;
+			return std::uint64_t(block.x + bias) | (std::uint64_t(block.y + bias) << 21) | (std::uint64_t(block.z + bias) << 42);
+		}
+
+		static int floorDivide(int a, int b)
+		{
+			return (a >= 0) ? a / b : -((-a + b - 1) / b);
+		}
+	};
+}
@@ -0,0 +1,414 @@
+#include "DensityVolume.h"
+#include "ThreadPool.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <tuple>
+#include <unordered_set>
+
+using namespace dynamol;
+using namespace glm;
+
+namespace
+{
+	constexpr char volumeMagic[4] = { 'D', 'M', 'V', 'B' };
+	constexpr std::uint32_t volumeVersion = 1;
+	constexpr std::uint32_t halfPrecisionFlag = 1;
+	constexpr std::size_t dataAlignment = 64;
+
+	// Little endian file layout: header, brick table, brick values (x runs fastest)
+	struct FileHeader
+	{
+		char magic[4];
+		std::uint32_t version;
+		std::uint32_t flags;
+		std::uint32_t brickSize;
+		std::uint32_t brickCount;
+		float spacing;
+		float origin[3];
+		float isovalue;
+		float minimumIsovalue;
+		float maximumIsovalue;
+		std::uint64_t tableOffset;
+		std::uint64_t valueOffset;
+	};
+
+	static_assert(sizeof(FileHeader) == 64, "Unexpected padding in the volume header");
+	static_assert(sizeof(DensityVolume::Brick) == 20, "Unexpected padding in the brick table");
+
+	std::size_t alignOffset(std::size_t offset)
+	{
+		return (offset + dataAlignment - 1) / dataAlignment * dataAlignment;
+	}
+
+	int brickValueIndex(int x, int y, int z)
+	{
+		return (z * DensityField::BlockSize + y) * DensityField::BlockSize + x;
+	}
+}
+
+std::unique_ptr<DensityVolume> DensityVolume::bake(const DensityField& field, bool halfPrecision)
+{
+	return bake(field, halfPrecision, field.isovalue(), field.isovalue());
+}
+
+std::unique_ptr<DensityVolume> DensityVolume::bake(const DensityField& field, bool halfPrecision, float minimumIsovalue, float maximumIsovalue)
+{
+	auto& pool = ThreadPool::instance();
+	const auto& fieldBlocks = field.blocks();
+
+	// Range of the grid points shared with the neighbors in positive direction, this is what decides whether a block has a surface
+	const auto sampleRange = [](const std::vector<float>& samples, float& minimum, float& maximum) {
+		minimum = maximum = samples[sampleIndex(0, 0, 0)];
+
+		for (int z = 0; z <= BlockSize; z++)
+		{
+			for (int y = 0; y <= BlockSize; y++)
+			{
+				for (int x = 0; x <= BlockSize; x++)
+				{
+					minimum = std::min(minimum, samples[sampleIndex(x, y, z)]);
+					maximum = std::max(maximum, samples[sampleIndex(x, y, z)]);
+				}
+			}
+		}
+	};
+
+	std::vector<std::uint8_t> surface(fieldBlocks.size(), 0);
+
+	pool.parallelFor(fieldBlocks.size(), [&](std::size_t i) {
+		std::vector<float> samples(SampleCount);
+		field.sampleBlock(fieldBlocks[i], samples.data());
+
+		float minimum, maximum;
+		sampleRange(samples, minimum, maximum);
+		surface[i] = minimum <= maximumIsovalue && maximum > minimumIsovalue;
+	});
+
+	// Dilate by one brick
+	std::unordered_set<std::uint64_t> selected;
+	std::vector<ivec3> selectedBlocks;
+
+	for (std::size_t i = 0; i < fieldBlocks.size(); i++)
+	{
+		if (!surface[i])
+			continue;
+
+		for (int z = -1; z <= 1; z++)
+		{
+			for (int y = -1; y <= 1; y++)
+			{
+				for (int x = -1; x <= 1; x++)
+				{
+					const ivec3 block = fieldBlocks[i] + ivec3(x, y, z);
+
+					if (selected.insert(blockKey(block)).second)
+						selectedBlocks.push_back(block);
+				}
+			}
+		}
+	}
+
+	// Deterministic brick order, z-major like the blocks of the field
+	std::sort(selectedBlocks.begin(), selectedBlocks.end(), [](const ivec3& a, const ivec3& b) {
+		return std::tie(a.z, a.y, a.x) < std::tie(b.z, b.y, b.x);
+	});
+
+	// Sample the selected bricks, bricks that are zero everywhere are dropped since zero is what missing bricks read as
+	std::vector<Brick> bricks(selectedBlocks.size());
+	std::vector<float> brickValues(selectedBlocks.size() * BrickValueCount);
+
+	pool.parallelFor(selectedBlocks.size(), [&](std::size_t i) {
+		std::vector<float> samples(SampleCount);
+		field.sampleBlock(selectedBlocks[i], samples.data());
+
+		bricks[i].block = selectedBlocks[i];
+		sampleRange(samples, bricks[i].minimum, bricks[i].maximum);
+
+		float* values = brickValues.data() + i * BrickValueCount;
+
+		for (int z = 0; z < BlockSize; z++)
+			for (int y = 0; y < BlockSize; y++)
+				for (int x = 0; x < BlockSize; x++)
+					values[brickValueIndex(x, y, z)] = samples[sampleIndex(x, y, z)];
+	});
+
+	std::vector<std::size_t> kept;
+
+	for (std::size_t i = 0; i < bricks.size(); i++)
+	{
+		const float* values = brickValues.data() + i * BrickValueCount;
+
+		if (std::any_of(values, values + BrickValueCount, [](float value) { return value != 0.0f; }))
+			kept.push_back(i);
+	}
+
+	const std::size_t valueSize = halfPrecision ? sizeof(std::uint16_t) : sizeof(float);
+	const std::size_t tableOffset = sizeof(FileHeader);
+	const std::size_t valueOffset = alignOffset(tableOffset + kept.size() * sizeof(Brick));
+	const std::size_t brickBytes = BrickValueCount * valueSize;
+
+	std::unique_ptr<DensityVolume> volume(new DensityVolume());
+	volume->m_image.resize(valueOffset + kept.size() * brickBytes);
+	std::byte* image = volume->m_image.data();
+
+	FileHeader header = {};
+	std::memcpy(header.magic, volumeMagic, sizeof(volumeMagic));
+	header.version = volumeVersion;
+	header.flags = halfPrecision ? halfPrecisionFlag : 0;
+	header.brickSize = BlockSize;
+	header.brickCount = std::uint32_t(kept.size());
+	header.spacing = field.spacing();
+	header.origin[0] = field.origin().x;
+	header.origin[1] = field.origin().y;
+	header.origin[2] = field.origin().z;
+	header.isovalue = field.isovalue();
+	header.minimumIsovalue = minimumIsovalue;
+	header.maximumIsovalue = maximumIsovalue;
+	header.tableOffset = tableOffset;
+	header.valueOffset = valueOffset;
+	std::memcpy(image, &header, sizeof(header));
+
+	pool.parallelFor(kept.size(), [&](std::size_t i) {
+		std::memcpy(image + tableOffset + i * sizeof(Brick), &bricks[kept[i]], sizeof(Brick));
+
+		const float* values = brickValues.data() + kept[i] * BrickValueCount;
+		std::byte* target = image + valueOffset + i * brickBytes;
+
+		if (halfPrecision)
+		{
+			for (int j = 0; j < BrickValueCount; j++)
+			{
+				const std::uint16_t half = std::uint16_t(packHalf1x16(values[j]));
+				std::memcpy(target + j * sizeof(half), &half, sizeof(half));
+			}
+		}
+		else
+		{
+			std::memcpy(target, values, brickBytes);
+		}
+	});
+
+	volume->attach(volume->m_image.data(), volume->m_image.size());
+	return volume;
+}
+
+std::unique_ptr<DensityVolume> DensityVolume::load(const std::string& filename)
+{
+	std::unique_ptr<DensityVolume> volume(new DensityVolume());
+
+	if (!volume->m_file.open(filename) || !volume->attach(volume->m_file.data(), volume->m_file.size()))
+		return nullptr;
+
+	return volume;
+}
+
+bool DensityVolume::write(const std::string& filename) const
+{
+	std::ofstream file(filename, std::ios::binary);
+
+	if (!file)
+		return false;
+
+	file.write(reinterpret_cast<const char*>(m_begin), std::streamsize(m_size));
+	return bool(file);
+}
+
+bool DensityVolume::attach(const std::byte* image, std::size_t size)
+{
+	if (size < sizeof(FileHeader))
+		return false;
+
+	FileHeader header;
+	std::memcpy(&header, image, sizeof(header));
+
+	if (std::memcmp(header.magic, volumeMagic, sizeof(volumeMagic)) != 0 || header.version != volumeVersion || header.brickSize != std::uint32_t(BlockSize))
+		return false;
+
+	m_halfPrecision = (header.flags & halfPrecisionFlag) != 0;
+	const std::size_t valueSize = m_halfPrecision ? sizeof(std::uint16_t) : sizeof(float);
+
+	if (header.tableOffset + std::size_t(header.brickCount) * sizeof(Brick) > size || header.valueOffset + std::size_t(header.brickCount) * BrickValueCount * valueSize > size)
+		return false;
+
+	m_begin = image;
+	m_size = size;
+	m_brickCount = std::size_t(header.brickCount);
+	m_bricks = reinterpret_cast<const Brick*>(image + header.tableOffset);
+	m_values = image + header.valueOffset;
+	m_spacing = header.spacing;
+	m_origin = vec3(header.origin[0], header.origin[1], header.origin[2]);
+	m_minimumIsovalue = header.minimumIsovalue;
+	m_maximumIsovalue = header.maximumIsovalue;
+
+	m_brickIndices.clear();
+	m_brickIndices.reserve(m_brickCount);
+
+	for (std::size_t i = 0; i < m_brickCount; i++)
+		m_brickIndices[blockKey(m_bricks[i].block)] = i;
+
+	setIsovalue(header.isovalue);
+	return true;
+}
+
+void DensityVolume::setIsovalue(float isovalue)
+{
+	m_isovalue = isovalue;
+	m_blocks.clear();
+
+	for (std::size_t i = 0; i < m_brickCount; i++)
+	{
+		if (m_bricks[i].minimum <= isovalue && m_bricks[i].maximum > isovalue)
+			m_blocks.push_back(m_bricks[i].block);
+	}
+}
+
+float DensityVolume::minimumIsovalue() const
+{
+	return m_minimumIsovalue;
+}
+
+float DensityVolume::maximumIsovalue() const
+{
+	return m_maximumIsovalue;
+}
+
+bool DensityVolume::halfPrecision() const
+{
+	return m_halfPrecision;
+}
+
+std::size_t DensityVolume::brickCount() const
+{
+	return m_brickCount;
+}
+
+std::size_t DensityVolume::sizeInBytes() const
+{
+	return m_size;
+}
+
+float DensityVolume::isovalue() const
+{
+	return m_isovalue;
+}
+
+float DensityVolume::spacing() const
+{
+	return m_spacing;
+}
+
+vec3 DensityVolume::origin() const
+{
+	return m_origin;
+}
+
+const std::vector<ivec3>& DensityVolume::blocks() const
+{
+	return m_blocks;
+}
+
+const DensityVolume::Brick* DensityVolume::findBrick(const ivec3& block, std::size_t& index) const
+{
+	const auto found = m_brickIndices.find(blockKey(block));
+
+	if (found == m_brickIndices.end())
+		return nullptr;
+
+	index = found->second;
+	return m_bricks + index;
+}
+
+float DensityVolume::brickValue(std::size_t index, int x, int y, int z) const
+{
+	const std::size_t valueIndex = index * BrickValueCount + std::size_t(brickValueIndex(x, y, z));
+
+	if (m_halfPrecision)
+	{
+		std::uint16_t half;
+		std::memcpy(&half, m_values + valueIndex * sizeof(half), sizeof(half));
+		return unpackHalf1x16(half);
+	}
+
+	float value;
+	std::memcpy(&value, m_values + valueIndex * sizeof(value), sizeof(value));
+	return value;
+}
+
+void DensityVolume::sampleBlock(const ivec3& block, float* samples) const
+{
+	// The samples of a block come from the brick itself and its direct neighbors
+	std::size_t neighbors[3][3][3];
+	bool present[3][3][3];
+
+	for (int z = 0; z < 3; z++)
+		for (int y = 0; y < 3; y++)
+			for (int x = 0; x < 3; x++)
+				present[z][y][x] = findBrick(block + ivec3(x - 1, y - 1, z - 1), neighbors[z][y][x]) != nullptr;
+
+	for (int z = -1; z < BlockSize + 2; z++)
+	{
+		const int nz = floorDivide(z, BlockSize);
+
+		for (int y = -1; y < BlockSize + 2; y++)
+		{
+			const int ny = floorDivide(y, BlockSize);
+
+			for (int x = -1; x < BlockSize + 2; x++)
+			{
+				const int nx = floorDivide(x, BlockSize);
+				float& sample = samples[sampleIndex(x, y, z)];
+
+				if (present[nz + 1][ny + 1][nx + 1])
+					sample = brickValue(neighbors[nz + 1][ny + 1][nx + 1], x - nx * BlockSize, y - ny * BlockSize, z - nz * BlockSize);
+				else
+					sample = 0.0f;
+			}
+		}
+	}
+}
+
+float DensityVolume::gridValue(const ivec3& gridPoint) const
+{
+	const ivec3 block(floorDivide(gridPoint.x, BlockSize), floorDivide(gridPoint.y, BlockSize), floorDivide(gridPoint.z, BlockSize));
+	std::size_t index;
+
+	if (findBrick(block, index) == nullptr)
+		return 0.0f;
+
+	const ivec3 local = gridPoint - block * BlockSize;
+	return brickValue(index, local.x, local.y, local.z);
+}
+
+float DensityVolume::value(const vec3& position) const
+{
+	const vec3 gridPosition = (position - m_origin) / m_spacing;
+	const vec3 lower = floor(gridPosition);
+	const vec3 t = gridPosition - lower;
+	const ivec3 point = ivec3(lower);
+
+	float corners[8];
+
+	for (int corner = 0; corner < 8; corner++)
+		corners[corner] = gridValue(point + ivec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1));
+
+	const float x00 = mix(corners[0], corners[1], t.x);
+	const float x10 = mix(corners[2], corners[3], t.x);
+	const float x01 = mix(corners[4], corners[5], t.x);
+	const float x11 = mix(corners[6], corners[7], t.x);
+	return mix(mix(x00, x10, t.y), mix(x01, x11, t.y), t.z);
+}
+
+vec3 DensityVolume::gradient(const vec3& position) const
+{
+	const float h = 0.5f * m_spacing;
+
+	return vec3(
+		value(position + vec3(h, 0.0f, 0.0f)) - value(position - vec3(h, 0.0f, 0.0f)),
+		value(position + vec3(0.0f, h, 0.0f)) - value(position - vec3(0.0f, h, 0.0f)),
+		value(position + vec3(0.0f, 0.0f, h)) - value(position - vec3(0.0f, 0.0f, h))) / (2.0f * h);
+}
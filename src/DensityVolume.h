@@ -0,0 +1,84 @@
+#pragma once
+
+#include "DensityField.h"
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace dynamol
+{
+	// Precomputed density field stored as sparse bricks of BlockSize^3 grid points. Only bricks near the surface are kept,
+	// the bytes in memory are exactly the file contents, so an imported volume is used straight from the memory mapping.
+	class DensityVolume : public DensityField
+	{
+	public:
+		static constexpr int BrickValueCount = BlockSize * BlockSize * BlockSize;
+
+		struct Brick
+		{
+			glm::ivec3 block;
+			float minimum; // range of the grid points 0 to BlockSize (inclusive) of the brick
+			float maximum;
+		};
+
+		// Samples the field in parallel and keeps every brick that contains the surface for an isovalue in the given range,
+		// together with its direct neighbors so that all blocks with a surface have their apron available
+		static std::unique_ptr<DensityVolume> bake(const DensityField& field, bool halfPrecision, float minimumIsovalue, float maximumIsovalue);
+		static std::unique_ptr<DensityVolume> bake(const DensityField& field, bool halfPrecision = false);
+
+		// Returns nullptr if the file cannot be mapped or is not a volume
+		static std::unique_ptr<DensityVolume> load(const std::string& filename);
+		bool write(const std::string& filename) const;
+
+		// Re-meshing at another isovalue is exact within the range the volume was baked for
+		void setIsovalue(float isovalue);
+		float minimumIsovalue() const;
+		float maximumIsovalue() const;
+
+		bool halfPrecision() const;
+		std::size_t brickCount() const;
+		std::size_t sizeInBytes() const;
+
+		float isovalue() const override;
+		float spacing() const override;
+		glm::vec3 origin() const override;
+		const std::vector<glm::ivec3>& blocks() const override;
+		void sampleBlock(const glm::ivec3& block, float* samples) const override;
+
+		// Trilinear interpolation of the grid points, zero outside of the stored bricks
+		float value(const glm::vec3& position) const override;
+		glm::vec3 gradient(const glm::vec3& position) const override;
+
+	private:
+		DensityVolume() = default;
+
+		bool attach(const std::byte* image, std::size_t size);
+		const Brick* findBrick(const glm::ivec3& block, std::size_t& index) const;
+		float brickValue(std::size_t index, int x, int y, int z) const;
+		float gridValue(const glm::ivec3& gridPoint) const;
+
+		std::vector<std::byte> m_image;
+		MappedFile m_file;
+
+		const std::byte* m_begin = nullptr;
+		std::size_t m_size = 0;
+		const Brick* m_bricks = nullptr;
+		const std::byte* m_values = nullptr;
+		std::size_t m_brickCount = 0;
+		bool m_halfPrecision = false;
+
+		float m_spacing = 1.0f;
+		glm::vec3 m_origin = glm::vec3(0.0f);
+		float m_isovalue = 0.0f;
+		float m_minimumIsovalue = 0.0f;
+		float m_maximumIsovalue = 0.0f;
+
+		std::unordered_map<std::uint64_t, std::size_t> m_brickIndices;
+		std::vector<glm::ivec3> m_blocks;
+	};
+}
@@ -0,0 +1,85 @@
+#include "DepthPyramid.h"
+
+#include <algorithm>
+
+using namespace dynamol;
+using namespace gl;
+using namespace glm;
+using namespace globjects;
+
+namespace
+{
+	// Work group size of hiz-cs.glsl
+	constexpr GLuint groupSize = 8;
+
+	ivec2 levelSize(const ivec2& size, GLint level)
+	{
+		return max(ivec2(size.x >> level, size.y >> level), ivec2(1));
+	}
+}
+
+void DepthPyramid::resize(const ivec2& size)
+{
+	if (m_texture && size == m_size)
+		return;
+
+	m_size = max(size, ivec2(1));
+	m_levels = 1;
+
+	while ((std::max(m_size.x, m_size.y) >> m_levels) > 0)
+		m_levels++;
+
+	m_texture = Texture::create(GL_TEXTURE_2D);
+	m_texture->setParameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	m_texture->setParameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	m_texture->setParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	m_texture->setParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	m_texture->storage2D(m_levels, GL_R32F, m_size);
+}
+
+void DepthPyramid::build(Program* program, Texture* positions)
+{
+	program->use();
+
+	for (GLint level = 0; level < m_levels; level++)
+	{
+		const ivec2 sourceSize = levelSize(m_size, std::max(level - 1, 0));
+		const ivec2 destinationSize = levelSize(m_size, level);
+
+		if (level == 0)
+			positions->bindActive(0);
+		else
+			m_texture->bindImageTexture(0, level - 1, false, 0, GL_READ_ONLY, GL_R32F);
+
+		m_texture->bindImageTexture(1, level, false, 0, GL_WRITE_ONLY, GL_R32F);
+
+		program->setUniform("fromPositions", level == 0);
+		program->setUniform("sourceSize", sourceSize);
+		program->setUniform("destinationSize", destinationSize);
+		program->dispatchCompute((GLuint(destinationSize.x) + groupSize - 1) / groupSize, (GLuint(destinationSize.y) + groupSize - 1) / groupSize, 1);
+
+		// Every level is read by the next one
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	}
+
+	program->release();
+
+	m_texture->unbindImageTexture(1);
+	m_texture->unbindImageTexture(0);
+	positions->unbindActive(0);
+}
+
+Texture* DepthPyramid::texture() const
+{
+	return m_texture.get();
+}
+
+GLint DepthPyramid::levels() const
+{
+	return m_levels;
+}
+
+const ivec2& DepthPyramid::size() const
+{
+	return m_size;
+}
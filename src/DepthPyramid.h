@@ -0,0 +1,32 @@
+#pragma once
+
+#include <memory>
+
+#include <glm/glm.hpp>
+#include <glbinding/gl/gl.h>
+#include <globjects/Program.h>
+#include <globjects/Texture.h>
+
+namespace dynamol
+{
+	// Hierarchical Z pyramid of the sphere pass: level 0 holds the distance of the closest inner sphere along the view
+	// ray of every pixel (w of the sphere position texture), every further level the farthest of these distances over
+	// the texels it covers. Odd sizes fold the last row and column into the last texel, so a pixel p is always covered
+	// by texel min(p >> level, size of level - 1). The program is hiz-cs.glsl.
+	class DepthPyramid
+	{
+	public:
+		// Keeps the texture if the size is unchanged
+		void resize(const glm::ivec2& size);
+		void build(globjects::Program* program, globjects::Texture* positions);
+
+		globjects::Texture* texture() const;
+		gl::GLint levels() const;
+		const glm::ivec2& size() const;
+
+	private:
+		std::unique_ptr<globjects::Texture> m_texture;
+		glm::ivec2 m_size = glm::ivec2(0);
+		gl::GLint m_levels = 0;
+	};
+}
@@ -0,0 +1,495 @@
+#include "DualContouring.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+
+using namespace dynamol;
+using namespace glm;
+
+namespace
+{
+	constexpr int BlockSize = DensityField::BlockSize;
+	constexpr int CellCount = BlockSize * BlockSize * BlockSize;
+	constexpr int OctreeDepth = 3; // 8 = 2^3 cells per block edge
+	constexpr int noVertex = -1;
+
+	static_assert((1 << OctreeDepth) == BlockSize, "The octree has to span exactly one block");
+
+	ivec3 cornerOffset(int corner)
+	{
+		return ivec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1);
+	}
+
+	constexpr std::array<std::array<int, 2>, 12> cubeEdges = { {
+		{ 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 },
+		{ 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 },
+		{ 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }
+	} };
+
+	// Quadric of squared distances to a set of tangent planes, stored as the upper triangle of A^T A, A^T b and b^T b.
+	// Positions are block-local grid coordinates, which keeps the sums well conditioned.
+	struct Quadric
+	{
+		float ata[6] = {}; // xx, xy, xz, yy, yz, zz
+		vec3 atb = vec3(0.0f);
+		float btb = 0.0f;
+		vec3 massPoint = vec3(0.0f);
+		vec3 normal = vec3(0.0f);
+		int count = 0;
+
+		void add(const vec3& point, const vec3& n)
+		{
+			const float b = dot(n, point);
+			ata[0] += n.x * n.x; ata[1] += n.x * n.y; ata[2] += n.x * n.z;
+			ata[3] += n.y * n.y; ata[4] += n.y * n.z; ata[5] += n.z * n.z;
+			atb += n * b;
+			btb += b * b;
+			massPoint += point;
+			normal += n;
+			count++;
+		}
+
+		void add(const Quadric& other)
+		{
+			for (int i = 0; i < 6; i++)
+				ata[i] += other.ata[i];
+
+			atb += other.atb;
+			btb += other.btb;
+			massPoint += other.massPoint;
+			normal += other.normal;
+			count += other.count;
+		}
+
+		mat3 matrix() const
+		{
+			return mat3(ata[0], ata[1], ata[2], ata[1], ata[3], ata[4], ata[2], ata[4], ata[5]);
+		}
+
+		float error(const vec3& x) const
+		{
+			return std::max(dot(x, matrix() * x) - 2.0f * dot(x, atb) + btb, 0.0f);
+		}
+
+		// Minimizer relative to the mass point with small eigenvalues truncated, so flat and edge-like regions stay near the center
+		vec3 solve() const
+		{
+			const vec3 center = massPoint / float(count);
+			mat3 a = matrix();
+			const vec3 b = atb - a * center;
+
+			// Cyclic Jacobi rotations for the eigen decomposition of the symmetric matrix
+			mat3 v(1.0f);
+
+			for (int sweep = 0; sweep < 8; sweep++)
+			{
+				for (int p = 0; p < 2; p++)
+				{
+					for (int q = p + 1; q < 3; q++)
+					{
+						if (std::abs(a[q][p]) < 1e-12f)
+							continue;
+
+						const float theta = (a[q][q] - a[p][p]) / (2.0f * a[q][p]);
+						const float t = (theta >= 0.0f ? 1.0f : -1.0f) / (std::abs(theta) + std::sqrt(theta * theta + 1.0f));
+						const float c = 1.0f / std::sqrt(t * t + 1.0f);
+						const float s = t * c;
+
+						mat3 rotation(1.0f);
+						rotation[p][p] = c;
+						rotation[q][q] = c;
+						rotation[q][p] = s;
+						rotation[p][q] = -s;
+
+						a = transpose(rotation) * a * rotation;
+						v = v * rotation;
+					}
+				}
+			}
+
+			const float largest = std::max({ std::abs(a[0][0]), std::abs(a[1][1]), std::abs(a[2][2]) });
+			const vec3 projected = transpose(v) * b;
+			vec3 solution(0.0f);
+
+			for (int i = 0; i < 3; i++)
+			{
+				if (std::abs(a[i][i]) > 0.1f * largest)
+					solution[i] = projected[i] / a[i][i];
+			}
+
+			return center + v * solution;
+		}
+	};
+
+	// Octree node index within a level, level 0 are the cells and level OctreeDepth is the whole block
+	int nodeIndex(const ivec3& node, int level)
+	{
+		const int size = BlockSize >> level;
+		return (node.z * size + node.y) * size + node.x;
+	}
+
+	constexpr int nodeCount(int level)
+	{
+		const int size = BlockSize >> level;
+		return size * size * size;
+	}
+
+	struct BlockLevel
+	{
+		std::array<int, CellCount> representatives; // vertex of every cell after collapsing, noVertex if the cell has no surface
+		std::vector<vec3> positions;
+		std::vector<vec3> normals;
+	};
+}
+
+DualContouring::DualContouring(const DensityField& field) : m_field(field)
+{
+}
+
+std::vector<Mesh> DualContouring::extract(std::span<const float> tolerances) const
+{
+	auto& pool = ThreadPool::instance();
+	const auto& blocks = m_field.blocks();
+	const float isovalue = m_field.isovalue();
+	const float spacing = m_field.spacing();
+	const std::size_t levelCount = tolerances.size();
+
+	std::unordered_map<std::uint64_t, std::size_t> blockIndices;
+
+	for (std::size_t i = 0; i < blocks.size(); i++)
+		blockIndices[DensityField::blockKey(blocks[i])] = i;
+
+	// Inside flags of the grid points with the lowest corner in each owned edge, needed again for face generation
+	std::vector<std::vector<std::uint8_t>> blockInside(blocks.size());
+	std::vector<std::vector<BlockLevel>> blockLevels(blocks.size());
+
+	pool.parallelFor(blocks.size(), [&](std::size_t blockIndex) {
+		const ivec3 block = blocks[blockIndex];
+		std::vector<float> samples(DensityField::SampleCount);
+		m_field.sampleBlock(block, samples.data());
+
+		const auto sample = [&samples](const ivec3& p) {
+			return samples[DensityField::sampleIndex(p.x, p.y, p.z)];
+		};
+
+		const auto gradient = [&sample](const ivec3& p) {
+			return vec3(
+				sample(p + ivec3(1, 0, 0)) - sample(p - ivec3(1, 0, 0)),
+				sample(p + ivec3(0, 1, 0)) - sample(p - ivec3(0, 1, 0)),
+				sample(p + ivec3(0, 0, 1)) - sample(p - ivec3(0, 0, 1)));
+		};
+
+		auto& inside = blockInside[blockIndex];
+		inside.resize(std::size_t(BlockSize + 1) * (BlockSize + 1) * (BlockSize + 1));
+
+		for (int z = 0; z <= BlockSize; z++)
+			for (int y = 0; y <= BlockSize; y++)
+				for (int x = 0; x <= BlockSize; x++)
+					inside[(z * (BlockSize + 1) + y) * (BlockSize + 1) + x] = sample(ivec3(x, y, z)) > isovalue;
+
+		const auto isInside = [&inside](const ivec3& p) {
+			return inside[(p.z * (BlockSize + 1) + p.y) * (BlockSize + 1) + p.x] != 0;
+		};
+
+		// Hermite data of the leaf cells: edge crossings and surface normals from the sampled gradient
+		std::array<std::vector<Quadric>, OctreeDepth + 1> quadrics;
+		std::array<std::vector<std::uint8_t>, OctreeDepth + 1> signChange;
+
+		for (int level = 0; level <= OctreeDepth; level++)
+		{
+			quadrics[level].resize(nodeCount(level));
+			signChange[level].resize(nodeCount(level), 0);
+		}
+
+		bool hasSurface = false;
+
+		for (int z = 0; z < BlockSize; z++)
+		{
+			for (int y = 0; y < BlockSize; y++)
+			{
+				for (int x = 0; x < BlockSize; x++)
+				{
+					const ivec3 cell(x, y, z);
+					Quadric& quadric = quadrics[0][nodeIndex(cell, 0)];
+
+					for (const auto& edge : cubeEdges)
+					{
+						const ivec3 p0 = cell + cornerOffset(edge[0]);
+						const ivec3 p1 = cell + cornerOffset(edge[1]);
+
+						if (isInside(p0) == isInside(p1))
+							continue;
+
+						const float v0 = sample(p0);
+						const float v1 = sample(p1);
+						const float t = std::clamp((isovalue - v0) / (v1 - v0), 0.0f, 1.0f);
+
+						vec3 normal = -mix(gradient(p0), gradient(p1), t);
+						const float normalLength = length(normal);
+
+						if (normalLength > 0.0f)
+							normal /= normalLength;
+
+						quadric.add(mix(vec3(p0), vec3(p1), t), normal);
+					}
+
+					if (quadric.count > 0)
+					{
+						signChange[0][nodeIndex(cell, 0)] = 1;
+						hasSurface = true;
+					}
+				}
+			}
+		}
+
+		if (!hasSurface)
+			return;
+
+		// Merged quadrics of the inner nodes, a node only counts as crossing the surface if its own corners disagree,
+		// otherwise collapsing it would remove a feature that lies completely inside of it
+		for (int level = 1; level <= OctreeDepth; level++)
+		{
+			const int size = BlockSize >> level;
+			const int extent = 1 << level;
+
+			for (int z = 0; z < size; z++)
+			{
+				for (int y = 0; y < size; y++)
+				{
+					for (int x = 0; x < size; x++)
+					{
+						const ivec3 node(x, y, z);
+						Quadric& quadric = quadrics[level][nodeIndex(node, level)];
+
+						for (int child = 0; child < 8; child++)
+							quadric.add(quadrics[level - 1][nodeIndex(node * 2 + cornerOffset(child), level - 1)]);
+
+						int insideCorners = 0;
+
+						for (int corner = 0; corner < 8; corner++)
+							insideCorners += isInside(node * extent + cornerOffset(corner) * extent);
+
+						signChange[level][nodeIndex(node, level)] = insideCorners > 0 && insideCorners < 8;
+					}
+				}
+			}
+		}
+
+		auto& levels = blockLevels[blockIndex];
+		levels.resize(levelCount);
+
+		for (std::size_t levelIndex = 0; levelIndex < levelCount; levelIndex++)
+		{
+			const float tolerance = tolerances[levelIndex] / spacing;
+			BlockLevel& result = levels[levelIndex];
+
+			// Collapsed flags per node, leaves are always collapsed
+			std::array<std::vector<std::uint8_t>, OctreeDepth + 1> collapsed;
+			collapsed[0].assign(nodeCount(0), 1);
+			std::array<std::vector<vec3>, OctreeDepth + 1> solutions;
+			solutions[0].resize(nodeCount(0));
+
+			for (int i = 0; i < nodeCount(0); i++)
+			{
+				if (quadrics[0][i].count > 0)
+				{
+					const ivec3 cell(i % BlockSize, (i / BlockSize) % BlockSize, i / (BlockSize * BlockSize));
+					const vec3 solution = quadrics[0][i].solve();
+
+					// Keep the vertex inside its cell, otherwise fall back to the mass point
+					const bool contained = all(greaterThanEqual(solution, vec3(cell))) && all(lessThanEqual(solution, vec3(cell + 1)));
+					solutions[0][i] = contained ? solution : quadrics[0][i].massPoint / float(quadrics[0][i].count);
+				}
+			}
+
+			for (int level = 1; level <= OctreeDepth; level++)
+			{
+				const int size = BlockSize >> level;
+				const int extent = 1 << level;
+				collapsed[level].assign(nodeCount(level), 0);
+				solutions[level].resize(nodeCount(level));
+
+				for (int i = 0; i < nodeCount(level); i++)
+				{
+					const ivec3 node(i % size, (i / size) % size, i / (size * size));
+					const Quadric& quadric = quadrics[level][i];
+
+					if (tolerance <= 0.0f || quadric.count == 0 || !signChange[level][i])
+						continue;
+
+					bool childrenCollapsed = true;
+
+					for (int child = 0; child < 8; child++)
+						childrenCollapsed = childrenCollapsed && collapsed[level - 1][nodeIndex(node * 2 + cornerOffset(child), level - 1)];
+
+					if (!childrenCollapsed)
+						continue;
+
+					vec3 solution = quadric.solve();
+
+					if (!all(greaterThanEqual(solution, vec3(node * extent))) || !all(lessThanEqual(solution, vec3((node + 1) * extent))))
+						solution = quadric.massPoint / float(quadric.count);
+
+					if (quadric.error(solution) <= tolerance * tolerance * float(quadric.count))
+					{
+						collapsed[level][i] = 1;
+						solutions[level][i] = solution;
+					}
+				}
+			}
+
+			// Every cell is represented by its topmost collapsed ancestor
+			std::array<std::vector<int>, OctreeDepth + 1> vertices;
+
+			for (int level = 0; level <= OctreeDepth; level++)
+				vertices[level].assign(nodeCount(level), noVertex);
+
+			for (int i = 0; i < CellCount; i++)
+			{
+				const ivec3 cell(i % BlockSize, (i / BlockSize) % BlockSize, i / (BlockSize * BlockSize));
+				result.representatives[i] = noVertex;
+
+				if (quadrics[0][i].count == 0)
+					continue;
+
+				int representative = 0;
+
+				for (int level = 1; level <= OctreeDepth; level++)
+				{
+					if (collapsed[level][nodeIndex(cell >> level, level)])
+						representative = level;
+				}
+
+				const int node = nodeIndex(cell >> representative, representative);
+				int& vertex = vertices[representative][node];
+
+				if (vertex == noVertex)
+				{
+					const Quadric& quadric = quadrics[representative][node];
+					const float normalLength = length(quadric.normal);
+
+					vertex = int(result.positions.size());
+					result.positions.push_back(m_field.position(vec3(block * BlockSize) + solutions[representative][node]));
+					result.normals.push_back(normalLength > 0.0f ? quadric.normal / normalLength : vec3(0.0f, 0.0f, 1.0f));
+				}
+
+				result.representatives[i] = vertex;
+			}
+		}
+	});
+
+	std::vector<Mesh> meshes(levelCount);
+
+	for (std::size_t levelIndex = 0; levelIndex < levelCount; levelIndex++)
+	{
+		Mesh& mesh = meshes[levelIndex];
+
+		// Global vertex indices by prefix sum over the blocks
+		std::vector<glm::uint> vertexOffsets(blocks.size() + 1, 0);
+
+		for (std::size_t i = 0; i < blocks.size(); i++)
+			vertexOffsets[i + 1] = vertexOffsets[i] + glm::uint(blockLevels[i].empty() ? 0 : blockLevels[i][levelIndex].positions.size());
+
+		mesh.positions.resize(vertexOffsets.back());
+		mesh.normals.resize(vertexOffsets.back());
+
+		std::vector<std::vector<uvec3>> blockTriangles(blocks.size());
+
+		pool.parallelFor(blocks.size(), [&](std::size_t blockIndex) {
+			if (blockLevels[blockIndex].empty())
+				return;
+
+			const BlockLevel& level = blockLevels[blockIndex][levelIndex];
+			std::copy(level.positions.begin(), level.positions.end(), mesh.positions.begin() + vertexOffsets[blockIndex]);
+			std::copy(level.normals.begin(), level.normals.end(), mesh.normals.begin() + vertexOffsets[blockIndex]);
+
+			const ivec3 block = blocks[blockIndex];
+			const auto& inside = blockInside[blockIndex];
+			auto& triangles = blockTriangles[blockIndex];
+
+			// Cells around an edge may lie in neighboring blocks
+			const auto cellVertex = [&](ivec3 cell) -> int {
+				std::size_t index = blockIndex;
+				const ivec3 offset(DensityField::floorDivide(cell.x, BlockSize), DensityField::floorDivide(cell.y, BlockSize), DensityField::floorDivide(cell.z, BlockSize));
+
+				if (offset != ivec3(0))
+				{
+					const auto found = blockIndices.find(DensityField::blockKey(block + offset));
+
+					if (found == blockIndices.end() || blockLevels[found->second].empty())
+						return noVertex;
+
+					index = found->second;
+					cell -= offset * BlockSize;
+				}
+
+				const int vertex = blockLevels[index][levelIndex].representatives[nodeIndex(cell, 0)];
+				return vertex == noVertex ? noVertex : int(vertexOffsets[index]) + vertex;
+			};
+
+			// Every block owns the edges starting at its grid points, each crossing edge becomes a quad of the four cells around it
+			for (int z = 0; z < BlockSize; z++)
+			{
+				for (int y = 0; y < BlockSize; y++)
+				{
+					for (int x = 0; x < BlockSize; x++)
+					{
+						const ivec3 p0(x, y, z);
+						const bool inside0 = inside[(z * (BlockSize + 1) + y) * (BlockSize + 1) + x] != 0;
+
+						for (int axis = 0; axis < 3; axis++)
+						{
+							ivec3 p1 = p0;
+							p1[axis]++;
+
+							if (inside0 == (inside[(p1.z * (BlockSize + 1) + p1.y) * (BlockSize + 1) + p1.x] != 0))
+								continue;
+
+							// Counter-clockwise around the axis, reversed if the surface faces the other way
+							const int u = (axis + 1) % 3;
+							const int v = (axis + 2) % 3;
+							const std::array<ivec2, 4> around = { { { -1, -1 }, { 0, -1 }, { 0, 0 }, { -1, 0 } } };
+							std::array<int, 4> quad;
+							bool complete = true;
+
+							for (int i = 0; i < 4; i++)
+							{
+								ivec3 cell = p0;
+								cell[u] += around[inside0 ? i : 3 - i].x;
+								cell[v] += around[inside0 ? i : 3 - i].y;
+								quad[i] = cellVertex(cell);
+								complete = complete && quad[i] != noVertex;
+							}
+
+							if (!complete)
+								continue;
+
+							// Collapsed cells share vertices, which turns quads into triangles or nothing at all
+							for (const auto& triangle : { uvec3(quad[0], quad[1], quad[2]), uvec3(quad[0], quad[2], quad[3]) })
+							{
+								if (triangle.x != triangle.y && triangle.y != triangle.z && triangle.z != triangle.x)
+									triangles.push_back(triangle);
+							}
+						}
+					}
+				}
+			}
+		});
+
+		std::size_t triangleCount = 0;
+
+		for (const auto& triangles : blockTriangles)
+			triangleCount += triangles.size();
+
+		mesh.triangles.reserve(triangleCount);
+
+		for (auto& triangles : blockTriangles)
+			mesh.triangles.insert(mesh.triangles.end(), triangles.begin(), triangles.end());
+	}
+
+	return meshes;
+}
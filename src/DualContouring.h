@@ -0,0 +1,24 @@
+#pragma once
+
+#include "DensityField.h"
+#include "Mesh.h"
+
+#include <span>
+#include <vector>
+
+namespace dynamol
+{
+	// Adaptive dual contouring of a density field. Every block of the field is an octree of depth three whose cells are
+	// collapsed bottom-up while the quadric error of the merged vertex stays below a tolerance, one mesh is produced per tolerance.
+	class DualContouring
+	{
+	public:
+		explicit DualContouring(const DensityField& field);
+
+		// Tolerances are RMS distances of the vertex to the tangent planes in world units, a tolerance of zero gives the uniform mesh
+		std::vector<Mesh> extract(std::span<const float> tolerances) const;
+
+	private:
+		const DensityField& m_field;
+	};
+}
@@ -0,0 +1,48 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace dynamol;
+
+float DynamicResolution::update(double frameMilliseconds, std::uint64_t measuredFrame, const Settings& settings)
+{
+	const float minimum = std::min(settings.minimumScale, settings.maximumScale);
+	const float maximum = std::max(settings.minimumScale, settings.maximumScale);
+	m_scale = std::clamp(m_scale, minimum, maximum);
+
+	if (measuredFrame == m_lastFrame || frameMilliseconds <= 0.0 || settings.targetMilliseconds <= 0.0f)
+		return m_scale;
+
+	m_lastFrame = measuredFrame;
+
+	if (measuredFrame < m_settleUntil)
+		return m_scale;
+
+	const double ratio = double(settings.targetMilliseconds) / frameMilliseconds;
+
+	if (std::abs(ratio - 1.0) <= Tolerance)
+		return m_scale;
+
+	const float estimate = std::clamp(m_scale * float(std::sqrt(ratio)), minimum, maximum);
+	const float scale = m_scale + (estimate - m_scale) * Damping;
+
+	if (scale != m_scale)
+	{
+		m_scale = scale;
+		m_settleUntil = measuredFrame + SettleFrames;
+	}
+
+	return m_scale;
+}
+
+void DynamicResolution::reset(float scale)
+{
+	m_scale = scale;
+	m_settleUntil = m_lastFrame + SettleFrames;
+}
+
+float DynamicResolution::scale() const
+{
+	return m_scale;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+
+namespace dynamol
+{
+	// Scale of the internal resolution that steers the GPU time of a frame towards a target. The time is assumed to be
+	// proportional to the number of pixels, so the scale follows the square root of the ratio of target and measured time.
+	// Changes are damped and skipped within a tolerance band, and the measurements of the frames that were still in
+	// flight with the previous scale are ignored after a change.
+	class DynamicResolution
+	{
+	public:
+		struct Settings
+		{
+			float targetMilliseconds = 16.6f;
+			float minimumScale = 0.25f;
+			float maximumScale = 1.0f;
+		};
+
+		// Relative deviation from the target that is tolerated without a change
+		static constexpr float Tolerance = 0.05f;
+		// Fraction of the step to the estimated scale that is taken per measurement
+		static constexpr float Damping = 0.5f;
+		// Measurements that are skipped after a change, more than the frame timer can have in flight
+		static constexpr std::uint64_t SettleFrames = 4;
+
+		// Takes the GPU time of the measured frame with the given count and returns the scale for the next frame,
+		// a measurement that has already been seen leaves the scale unchanged
+		float update(double frameMilliseconds, std::uint64_t measuredFrame, const Settings& settings);
+		void reset(float scale);
+
+		float scale() const;
+
+	private:
+		float m_scale = 1.0f;
+		std::uint64_t m_lastFrame = 0;
+		std::uint64_t m_settleUntil = 0;
+	};
+}
@@ -0,0 +1,228 @@
+#include "GaussianDensity.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace dynamol;
+using namespace glm;
+
+namespace
+{
+	constexpr std::size_t atomGrainSize = 4096;
+}
+
+GaussianDensity::GaussianDensity(std::span<const vec4> atoms, float radius, float sharpness, float spacing) :
+	m_radius(radius), m_sharpness(sharpness), m_spacing(spacing)
+{
+	auto& pool = ThreadPool::instance();
+
+	// Same sphere of influence as the spawn pass, contributions beyond it are below 1/32 of the isovalue
+	const float contributingAtoms = 32.0f;
+	m_cutoffRadius = radius * std::sqrt(std::log(contributingAtoms * std::exp(sharpness)) / sharpness);
+
+	m_atoms.resize(atoms.size());
+
+	for (std::size_t i = 0; i < atoms.size(); i++)
+		m_atoms[i] = vec3(atoms[i]);
+
+	if (m_atoms.empty())
+		return;
+
+	vec3 minimumBounds(std::numeric_limits<float>::max());
+
+	for (const auto& atom : m_atoms)
+		minimumBounds = min(minimumBounds, atom);
+
+	m_origin = minimumBounds - vec3(m_cutoffRadius + 2.0f * spacing);
+
+	// Range of blocks whose samples (including the apron) an atom contributes to
+	const auto blockRange = [this](const vec3& atom, ivec3& lower, ivec3& upper) {
+		const ivec3 first = ivec3(ceil((atom - vec3(m_cutoffRadius) - m_origin) / m_spacing));
+		const ivec3 last = ivec3(floor((atom + vec3(m_cutoffRadius) - m_origin) / m_spacing));
+
+		for (int i = 0; i < 3; i++)
+		{
+			lower[i] = floorDivide(first[i] - 2, BlockSize);
+			upper[i] = floorDivide(last[i] + 1, BlockSize);
+		}
+	};
+
+	// Binning of atoms into blocks: count, scan, fill and sort by block
+	std::vector<glm::uint> pairCounts(m_atoms.size() + 1, 0);
+
+	pool.parallelFor(m_atoms.size(), [&](std::size_t i) {
+		ivec3 lower, upper;
+		blockRange(m_atoms[i], lower, upper);
+		const ivec3 extent = upper - lower + 1;
+		pairCounts[i + 1] = glm::uint(extent.x * extent.y * extent.z);
+	}, atomGrainSize);
+
+	for (std::size_t i = 0; i < m_atoms.size(); i++)
+		pairCounts[i + 1] += pairCounts[i];
+
+	std::vector<std::pair<std::uint64_t, glm::uint>> pairs(pairCounts.back());
+
+	pool.parallelFor(m_atoms.size(), [&](std::size_t i) {
+		ivec3 lower, upper;
+		blockRange(m_atoms[i], lower, upper);
+		glm::uint index = pairCounts[i];
+
+		for (int z = lower.z; z <= upper.z; z++)
+			for (int y = lower.y; y <= upper.y; y++)
+				for (int x = lower.x; x <= upper.x; x++)
+					pairs[index++] = { blockKey(ivec3(x, y, z)), glm::uint(i) };
+	}, atomGrainSize);
+
+	std::sort(pairs.begin(), pairs.end());
+
+	m_blockAtoms.resize(pairs.size());
+
+	for (std::size_t i = 0; i < pairs.size(); i++)
+	{
+		if (i == 0 || pairs[i].first != pairs[i - 1].first)
+		{
+			const std::uint64_t key = pairs[i].first;
+			constexpr std::int64_t bias = 1 << 20;
+			const ivec3 block(int(std::int64_t(key & 0x1fffff) - bias), int(std::int64_t((key >> 21) & 0x1fffff) - bias), int(std::int64_t((key >> 42) & 0x1fffff) - bias));
+
+			m_blockIndices[key] = glm::uint(m_blocks.size());
+			m_blocks.push_back(block);
+			m_blockOffsets.push_back(glm::uint(i));
+		}
+
+		m_blockAtoms[i] = pairs[i].second;
+	}
+
+	m_blockOffsets.push_back(glm::uint(pairs.size()));
+}
+
+float GaussianDensity::isovalue() const
+{
+	return std::exp(-m_sharpness);
+}
+
+float GaussianDensity::spacing() const
+{
+	return m_spacing;
+}
+
+vec3 GaussianDensity::origin() const
+{
+	return m_origin;
+}
+
+const std::vector<ivec3>& GaussianDensity::blocks() const
+{
+	return m_blocks;
+}
+
+float GaussianDensity::radius() const
+{
+	return m_radius;
+}
+
+float GaussianDensity::sharpness() const
+{
+	return m_sharpness;
+}
+
+float GaussianDensity::cutoffRadius() const
+{
+	return m_cutoffRadius;
+}
+
+void GaussianDensity::sampleBlock(const ivec3& block, float* samples) const
+{
+	std::fill(samples, samples + SampleCount, 0.0f);
+
+	const auto found = m_blockIndices.find(blockKey(block));
+
+	if (found == m_blockIndices.end())
+		return;
+
+	const glm::uint blockIndex = found->second;
+	const ivec3 firstPoint = block * BlockSize - 1;
+	const float falloff = m_sharpness / (m_radius * m_radius);
+
+	// The Gaussian is separable, so every atom needs only SampleSize exponentials per axis
+	float factors[3][SampleSize];
+
+	for (glm::uint i = m_blockOffsets[blockIndex]; i < m_blockOffsets[blockIndex + 1]; i++)
+	{
+		const vec3 atom = (m_atoms[m_blockAtoms[i]] - m_origin) / m_spacing;
+		const float cutoff = m_cutoffRadius / m_spacing;
+
+		ivec3 lower, upper;
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			lower[axis] = std::max(int(std::ceil(atom[axis] - cutoff)) - firstPoint[axis], 0);
+			upper[axis] = std::min(int(std::floor(atom[axis] + cutoff)) - firstPoint[axis], SampleSize - 1);
+
+			for (int j = lower[axis]; j <= upper[axis]; j++)
+			{
+				const float d = (float(firstPoint[axis] + j) - atom[axis]) * m_spacing;
+				factors[axis][j] = std::exp(-falloff * d * d);
+			}
+		}
+
+		for (int z = lower.z; z <= upper.z; z++)
+		{
+			for (int y = lower.y; y <= upper.y; y++)
+			{
+				const float yz = factors[1][y] * factors[2][z];
+				float* row = samples + (z * SampleSize + y) * SampleSize;
+
+				for (int x = lower.x; x <= upper.x; x++)
+					row[x] += factors[0][x] * yz;
+			}
+		}
+	}
+}
+
+std::span<const glm::uint> GaussianDensity::blockAtoms(const vec3& position) const
+{
+	const ivec3 point = ivec3(floor((position - m_origin) / m_spacing));
+	const ivec3 block(floorDivide(point.x, BlockSize), floorDivide(point.y, BlockSize), floorDivide(point.z, BlockSize));
+	const auto found = m_blockIndices.find(blockKey(block));
+
+	if (found == m_blockIndices.end())
+		return {};
+
+	const glm::uint blockIndex = found->second;
+	return std::span<const glm::uint>(m_blockAtoms.data() + m_blockOffsets[blockIndex], m_blockOffsets[blockIndex + 1] - m_blockOffsets[blockIndex]);
+}
+
+float GaussianDensity::value(const vec3& position) const
+{
+	const float falloff = m_sharpness / (m_radius * m_radius);
+	float sum = 0.0f;
+
+	for (glm::uint index : blockAtoms(position))
+	{
+		const vec3 d = position - m_atoms[index];
+
+		if (std::abs(d.x) <= m_cutoffRadius && std::abs(d.y) <= m_cutoffRadius && std::abs(d.z) <= m_cutoffRadius)
+			sum += std::exp(-falloff * dot(d, d));
+	}
+
+	return sum;
+}
+
+vec3 GaussianDensity::gradient(const vec3& position) const
+{
+	const float falloff = m_sharpness / (m_radius * m_radius);
+	vec3 sum(0.0f);
+
+	for (glm::uint index : blockAtoms(position))
+	{
+		const vec3 d = position - m_atoms[index];
+
+		if (std::abs(d.x) <= m_cutoffRadius && std::abs(d.y) <= m_cutoffRadius && std::abs(d.z) <= m_cutoffRadius)
+			sum += d * (-2.0f * falloff * std::exp(-falloff * dot(d, d)));
+	}
+
+	return sum;
+}
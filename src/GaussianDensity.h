@@ -0,0 +1,46 @@
+#pragma once
+
+#include "DensityField.h"
+
+#include <glm/glm.hpp>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace dynamol
+{
+	// The field evaluated by the surface pass: sum of exp(-sharpness * d^2 / radius^2), with the surface at exp(-sharpness).
+	// Atoms are binned into the blocks touched by their sphere of influence, which uses the same radius scale as SphereRenderer.
+	class GaussianDensity : public DensityField
+	{
+	public:
+		GaussianDensity(std::span<const glm::vec4> atoms, float radius, float sharpness, float spacing);
+
+		float isovalue() const override;
+		float spacing() const override;
+		glm::vec3 origin() const override;
+		const std::vector<glm::ivec3>& blocks() const override;
+		void sampleBlock(const glm::ivec3& block, float* samples) const override;
+		float value(const glm::vec3& position) const override;
+		glm::vec3 gradient(const glm::vec3& position) const override;
+
+		float radius() const;
+		float sharpness() const;
+		float cutoffRadius() const;
+
+	private:
+		std::span<const glm::uint> blockAtoms(const glm::vec3& position) const;
+
+		std::vector<glm::vec3> m_atoms;
+		float m_radius = 1.0f;
+		float m_sharpness = 1.0f;
+		float m_spacing = 1.0f;
+		float m_cutoffRadius = 1.0f;
+		glm::vec3 m_origin = glm::vec3(0.0f);
+
+		std::vector<glm::ivec3> m_blocks;
+		std::vector<glm::uint> m_blockOffsets;
+		std::vector<glm::uint> m_blockAtoms;
+		std::unordered_map<std::uint64_t, glm::uint> m_blockIndices;
+	};
+}
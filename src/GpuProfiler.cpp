@@ -0,0 +1,146 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <numeric>
+
+using namespace dynamol;
+using namespace gl;
+using namespace globjects;
+
+void GpuProfiler::beginFrame()
+{
+	m_frame++;
+	m_activePass = nullptr;
+
+	const std::size_t buffer = m_frame % FrameBuffers;
+	double frameMilliseconds = 0.0;
+	bool measured = false;
+
+	// The queries of this buffer were issued FrameBuffers frames ago and are normally available by now
+	for (auto& pass : m_passes)
+	{
+		if (!pass->pending[buffer])
+			continue;
+
+		const double milliseconds = double(pass->queries[buffer]->get64(GL_QUERY_RESULT)) / 1.0e6;
+		pass->pending[buffer] = false;
+		frameMilliseconds += milliseconds;
+		measured = true;
+
+		if (pass->history.size() < HistoryLength)
+			pass->history.push_back(milliseconds);
+		else
+			pass->history[pass->historyIndex] = milliseconds;
+
+		pass->historyIndex = (pass->historyIndex + 1) % HistoryLength;
+
+		if (m_log.is_open())
+			m_log << (m_frame - FrameBuffers) << "," << pass->name << "," << milliseconds << "\n";
+	}
+
+	if (measured)
+	{
+		m_frameMilliseconds = frameMilliseconds;
+		m_measuredFrames++;
+	}
+}
+
+void GpuProfiler::begin(const std::string& name)
+{
+	if (m_activePass != nullptr)
+		return;
+
+	auto it = std::find_if(m_passes.begin(), m_passes.end(), [&name](const auto& pass) { return pass->name == name; });
+
+	if (it == m_passes.end())
+	{
+		auto pass = std::make_unique<Pass>();
+		pass->name = name;
+
+		for (auto& query : pass->queries)
+			query = Query::create();
+
+		it = m_passes.insert(m_passes.end(), std::move(pass));
+	}
+
+	// A pass that is measured twice in a frame keeps the first measurement
+	const std::size_t buffer = m_frame % FrameBuffers;
+
+	if ((*it)->pending[buffer])
+		return;
+
+	m_activePass = it->get();
+	m_activePass->queries[buffer]->begin(GL_TIME_ELAPSED);
+}
+
+void GpuProfiler::end()
+{
+	if (m_activePass == nullptr)
+		return;
+
+	const std::size_t buffer = m_frame % FrameBuffers;
+	m_activePass->queries[buffer]->end(GL_TIME_ELAPSED);
+	m_activePass->pending[buffer] = true;
+	m_activePass = nullptr;
+}
+
+std::vector<GpuProfiler::PassStatistics> GpuProfiler::statistics() const
+{
+	std::vector<PassStatistics> result;
+	result.reserve(m_passes.size());
+
+	for (const auto& pass : m_passes)
+	{
+		PassStatistics& statistics = result.emplace_back();
+		statistics.name = pass->name;
+
+		if (pass->history.empty())
+			continue;
+
+		const std::size_t lastIndex = (pass->historyIndex + HistoryLength - 1) % HistoryLength;
+		statistics.last = pass->history[lastIndex];
+
+		std::vector<double> sorted = pass->history;
+		std::sort(sorted.begin(), sorted.end());
+
+		statistics.average = std::accumulate(sorted.begin(), sorted.end(), 0.0) / double(sorted.size());
+		statistics.median = sorted[sorted.size() / 2];
+		statistics.percentile95 = sorted[std::min(sorted.size() - 1, sorted.size() * 95 / 100)];
+		statistics.maximum = sorted.back();
+	}
+
+	return result;
+}
+
+double GpuProfiler::frameMilliseconds() const
+{
+	return m_frameMilliseconds;
+}
+
+std::uint64_t GpuProfiler::measuredFrames() const
+{
+	return m_measuredFrames;
+}
+
+bool GpuProfiler::startLog(const std::filesystem::path& path)
+{
+	stopLog();
+	m_log.open(path, std::ios::out | std::ios::trunc);
+
+	if (!m_log.is_open())
+		return false;
+
+	m_log << "frame,pass,milliseconds\n";
+	return true;
+}
+
+void GpuProfiler::stopLog()
+{
+	if (m_log.is_open())
+		m_log.close();
+}
+
+bool GpuProfiler::logging() const
+{
+	return m_log.is_open();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glbinding/gl/gl.h>
+#include <globjects/Query.h>
+
+namespace dynamol
+{
+	// GPU time of named render passes measured with GL_TIME_ELAPSED queries.
+	// Every pass owns one query per frame buffer, the results of a frame are collected when its queries are reused,
+	// so statistics lag behind by FrameBuffers frames. Elapsed time queries cannot overlap, passes must not be nested.
+	class GpuProfiler
+	{
+	public:
+		struct PassStatistics
+		{
+			std::string name;
+			double last = 0.0;
+			double average = 0.0;
+			double median = 0.0;
+			double percentile95 = 0.0;
+			double maximum = 0.0;
+		};
+
+		// Collects the results of the frame that used the query set of this frame
+		void beginFrame();
+
+		void begin(const std::string& name);
+		void end();
+
+		// Over the last HistoryLength measured frames, in milliseconds and in the order the passes were first seen
+		std::vector<PassStatistics> statistics() const;
+
+		// Sum of the passes of the most recently measured frame, the count increases with every measured frame
+		double frameMilliseconds() const;
+		std::uint64_t measuredFrames() const;
+
+		// Appends one "frame,pass,milliseconds" line per pass and measured frame
+		bool startLog(const std::filesystem::path& path);
+		void stopLog();
+		bool logging() const;
+
+	private:
+		static constexpr std::size_t FrameBuffers = 2;
+		static constexpr std::size_t HistoryLength = 128;
+
+		struct Pass
+		{
+			std::string name;
+			std::array<std::unique_ptr<globjects::Query>, FrameBuffers> queries;
+			std::array<bool, FrameBuffers> pending = {};
+			std::vector<double> history;
+			std::size_t historyIndex = 0;
+		};
+
+		std::vector<std::unique_ptr<Pass>> m_passes;
+		Pass* m_activePass = nullptr;
+		std::uint64_t m_frame = 0;
+		double m_frameMilliseconds = 0.0;
+		std::uint64_t m_measuredFrames = 0;
+		std::ofstream m_log;
+	};
+}
@@ -0,0 +1,70 @@
+#include "GpuTimer.h"
+
+using namespace dynamol;
+using namespace gl;
+using namespace globjects;
+
+void GpuTimer::begin()
+{
+	collect();
+
+	Slot& slot = m_slots[m_nextSlot];
+
+	// Skip the measurement if the oldest one is still in flight
+	m_running = !slot.pending;
+
+	if (!m_running)
+		return;
+
+	if (!slot.start)
+	{
+		slot.start = Query::create();
+		slot.stop = Query::create();
+	}
+
+	slot.start->counter(GL_TIMESTAMP);
+}
+
+void GpuTimer::end()
+{
+	if (!m_running)
+		return;
+
+	Slot& slot = m_slots[m_nextSlot];
+	slot.stop->counter(GL_TIMESTAMP);
+	slot.pending = true;
+
+	m_nextSlot = (m_nextSlot + 1) % QuerySlots;
+	m_running = false;
+}
+
+double GpuTimer::milliseconds() const
+{
+	return m_milliseconds;
+}
+
+double GpuTimer::lastMilliseconds() const
+{
+	return m_lastMilliseconds;
+}
+
+std::uint64_t GpuTimer::measurements() const
+{
+	return m_measurements;
+}
+
+void GpuTimer::collect()
+{
+	// Queries complete in order, stop at the first one that has not arrived yet
+	while (m_slots[m_pendingSlot].pending && m_slots[m_pendingSlot].stop->resultAvailable())
+	{
+		Slot& slot = m_slots[m_pendingSlot];
+		const double milliseconds = double(slot.stop->get64(GL_QUERY_RESULT) - slot.start->get64(GL_QUERY_RESULT)) / 1.0e6;
+
+		m_milliseconds = m_milliseconds > 0.0 ? m_milliseconds + Smoothing * (milliseconds - m_milliseconds) : milliseconds;
+		m_lastMilliseconds = milliseconds;
+		m_measurements++;
+		slot.pending = false;
+		m_pendingSlot = (m_pendingSlot + 1) % QuerySlots;
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <glbinding/gl/gl.h>
+#include <globjects/Query.h>
+
+namespace dynamol
+{
+	// GPU time between begin() and end() measured with timestamp queries.
+	// Results are collected without stalling a few frames later, so the reported time lags behind by that many frames.
+	class GpuTimer
+	{
+	public:
+		void begin();
+		void end();
+
+		// Most recent available measurement, smoothed over a few frames
+		double milliseconds() const;
+		// Most recent available measurement as it is, the count increases with every collected measurement
+		double lastMilliseconds() const;
+		std::uint64_t measurements() const;
+
+	private:
+		static constexpr std::size_t QuerySlots = 4;
+		static constexpr double Smoothing = 0.1;
+
+		struct Slot
+		{
+			std::unique_ptr<globjects::Query> start;
+			std::unique_ptr<globjects::Query> stop;
+			bool pending = false;
+		};
+
+		void collect();
+
+		std::array<Slot, QuerySlots> m_slots;
+		std::size_t m_nextSlot = 0;
+		std::size_t m_pendingSlot = 0;
+		bool m_running = false;
+		double m_milliseconds = 0.0;
+		double m_lastMilliseconds = 0.0;
+		std::uint64_t m_measurements = 0;
+	};
+}
@@ -69,14 +69,14 @@ ImageDepthScaleRenderer::ImageDepthScaleRenderer(Viewer* viewer) : Renderer(view
 			{ GL_GEOMETRY_SHADER,"./res/sphere/image-gs.glsl" },
 			{ GL_FRAGMENT_SHADER,"./res/sphere/surface-fs.glsl" },
 		},
-		{ "./res/sphere/globals.glsl" });
+		{ "./res/sphere/globals.glsl", "./res/sphere/gbuffer.glsl", "./res/sphere/temporal.glsl" });
 
 	createShaderProgram("aosample", {
 			{ GL_VERTEX_SHADER,"./res/sphere/image-vs.glsl" },
 			{ GL_GEOMETRY_SHADER,"./res/sphere/image-gs.glsl" },
 			{ GL_FRAGMENT_SHADER,"./res/sphere/aosample-fs.glsl" },
 		},
-		{ "./res/sphere/globals.glsl" });
+		{ "./res/sphere/globals.glsl", "./res/sphere/temporal.glsl" });
 
 	createShaderProgram("aoblur", {
 			{ GL_VERTEX_SHADER,"./res/sphere/image-vs.glsl" },
@@ -90,7 +90,7 @@ ImageDepthScaleRenderer::ImageDepthScaleRenderer(Viewer* viewer) : Renderer(view
 			{ GL_GEOMETRY_SHADER,"./res/sphere/image-gs.glsl" },
 			{ GL_FRAGMENT_SHADER,"./res/sphere/shade-fs.glsl" },
 		},
-		{ "./res/sphere/globals.glsl" });
+		{ "./res/sphere/globals.glsl", "./res/sphere/gbuffer.glsl" });
 
 	createShaderProgram("dofblur", {
 			{ GL_VERTEX_SHADER,"./res/sphere/image-vs.glsl" },
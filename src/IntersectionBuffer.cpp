@@ -0,0 +1,140 @@
+#include "IntersectionBuffer.h"
+
+#include <globjects/logging.h>
+
+#include <algorithm>
+#include <limits>
+
+using namespace dynamol;
+using namespace gl;
+using namespace globjects;
+
+namespace
+{
+	// Demand above this fraction of the capacity triggers growth, below the shrink fraction it counts as underuse
+	constexpr double growThreshold = 0.9;
+	constexpr double shrinkThreshold = 0.25;
+	// Headroom on top of the demand when reallocating
+	constexpr double headroom = 1.5;
+}
+
+IntersectionBuffer::IntersectionBuffer(GLuint capacity, GLuint entrySize) :
+	m_entrySize(entrySize)
+{
+	GLint64 maximumBlockSize = 0;
+	glGetInteger64v(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &maximumBlockSize);
+	m_maximumCapacity = GLuint(std::min<GLint64>(maximumBlockSize / m_entrySize, std::numeric_limits<GLuint>::max()));
+
+	m_readbackBuffer->setStorage(sizeof(GLuint) * ReadbackSlots, nullptr, GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+	m_readbackData = static_cast<const GLuint*>(m_readbackBuffer->mapRange(0, sizeof(GLuint) * ReadbackSlots, GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT));
+
+	allocate(capacity);
+}
+
+Buffer* IntersectionBuffer::entries() const
+{
+	return m_entries.get();
+}
+
+GLuint IntersectionBuffer::capacity() const
+{
+	return m_capacity;
+}
+
+std::size_t IntersectionBuffer::sizeInBytes() const
+{
+	return std::size_t(m_capacity) * m_entrySize;
+}
+
+GLuint IntersectionBuffer::demand() const
+{
+	return m_demand;
+}
+
+GLuint IntersectionBuffer::peakDemand() const
+{
+	return m_peakDemand;
+}
+
+std::size_t IntersectionBuffer::overflowCount() const
+{
+	return m_overflowCount;
+}
+
+void IntersectionBuffer::readback(const Buffer* source, GLintptr offset)
+{
+	// Skip the frame if the oldest read back is still in flight
+	if (m_readbackFences[m_nextSlot])
+		return;
+
+	source->copySubData(m_readbackBuffer.get(), offset, GLintptr(sizeof(GLuint) * m_nextSlot), sizeof(GLuint));
+	m_readbackFences[m_nextSlot] = Sync::fence(GL_SYNC_GPU_COMMANDS_COMPLETE);
+	m_nextSlot = (m_nextSlot + 1) % ReadbackSlots;
+}
+
+void IntersectionBuffer::update()
+{
+	GLuint requiredCapacity = 0;
+
+	// Read backs complete in order, stop at the first one that has not arrived yet
+	while (m_readbackFences[m_pendingSlot])
+	{
+		const GLenum status = m_readbackFences[m_pendingSlot]->clientWait(GL_NONE_BIT, 0);
+
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			break;
+
+		m_readbackFences[m_pendingSlot].reset();
+		m_demand = m_readbackData[m_pendingSlot];
+		m_pendingSlot = (m_pendingSlot + 1) % ReadbackSlots;
+
+		if (m_demand > m_capacity)
+			m_overflowCount++;
+
+		if (m_demand > GLuint(growThreshold * m_capacity))
+		{
+			requiredCapacity = std::max(requiredCapacity, m_demand);
+			m_underusedReadbacks = 0;
+			m_peakDemand = 0;
+			continue;
+		}
+
+		if (m_demand < GLuint(shrinkThreshold * m_capacity))
+		{
+			m_peakDemand = std::max(m_peakDemand, m_demand);
+			m_underusedReadbacks++;
+		}
+		else
+		{
+			m_underusedReadbacks = 0;
+			m_peakDemand = 0;
+		}
+	}
+
+	if (requiredCapacity > 0)
+	{
+		allocate(GLuint(std::min<double>(headroom * requiredCapacity, m_maximumCapacity)));
+	}
+	else if (m_underusedReadbacks >= ShrinkDelay && m_capacity > MinimumCapacity)
+	{
+		allocate(GLuint(headroom * m_peakDemand));
+	}
+}
+
+void IntersectionBuffer::allocate(GLuint capacity)
+{
+	capacity = std::clamp(capacity, MinimumCapacity, std::max(m_maximumCapacity, MinimumCapacity));
+
+	if (capacity == m_capacity)
+		return;
+
+	if (m_capacity > 0)
+		globjects::debug() << "Resizing intersection buffer from " << m_capacity << " to " << capacity << " entries (" << std::size_t(capacity) * m_entrySize / (1024 * 1024) << " MiB)";
+
+	// Immutable storage cannot be resized, the contents are rebuilt every frame anyway
+	m_entries = Buffer::create();
+	m_entries->setStorage(GLsizeiptr(capacity) * m_entrySize, nullptr, GL_NONE_BIT);
+	m_capacity = capacity;
+	m_underusedReadbacks = 0;
+	m_peakDemand = 0;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+
+#include <glbinding/gl/gl.h>
+#include <globjects/Buffer.h>
+#include <globjects/Sync.h>
+
+namespace dynamol
+{
+	// Storage for the intersection entries written by the spawn pass.
+	// The total entry count is read back asynchronously after every frame and the storage follows the measured demand:
+	// it grows as soon as the demand gets close to the capacity and shrinks only after a long period of underuse.
+	class IntersectionBuffer
+	{
+	public:
+		// Size of BufferEntry in spawn-fs.glsl with std430 layout
+		static constexpr gl::GLuint EntrySize = 48;
+		static constexpr gl::GLuint MinimumCapacity = 1 << 16;
+
+		// Other entry types can be stored as well, e.g. the tile lists of the compute path hold plain uint indices
+		explicit IntersectionBuffer(gl::GLuint capacity = 1 << 20, gl::GLuint entrySize = EntrySize);
+
+		globjects::Buffer* entries() const;
+
+		// Number of entries that fit
+		gl::GLuint capacity() const;
+		std::size_t sizeInBytes() const;
+
+		// Demand of the most recent frame whose total has arrived, can be larger than the capacity after an overflow
+		gl::GLuint demand() const;
+		gl::GLuint peakDemand() const;
+		std::size_t overflowCount() const;
+
+		// Queues the read back of the entry total, a single uint at offset in source, once it has been written
+		void readback(const globjects::Buffer* source, gl::GLintptr offset);
+		// Collects finished read backs and reallocates if needed, must not be called while the buffers are bound
+		void update();
+
+	private:
+		static constexpr std::size_t ReadbackSlots = 3;
+		// Read backs without any demand close to the capacity before the buffer shrinks
+		static constexpr std::size_t ShrinkDelay = 120;
+
+		void allocate(gl::GLuint capacity);
+
+		std::unique_ptr<globjects::Buffer> m_entries;
+		std::unique_ptr<globjects::Buffer> m_readbackBuffer = globjects::Buffer::create();
+		const gl::GLuint* m_readbackData = nullptr;
+		std::array<std::unique_ptr<globjects::Sync>, ReadbackSlots> m_readbackFences;
+		std::size_t m_nextSlot = 0;
+		std::size_t m_pendingSlot = 0;
+
+		gl::GLuint m_entrySize = EntrySize;
+		gl::GLuint m_capacity = 0;
+		gl::GLuint m_maximumCapacity = 0;
+		gl::GLuint m_demand = 0;
+		gl::GLuint m_peakDemand = 0;
+		std::size_t m_underusedReadbacks = 0;
+		std::size_t m_overflowCount = 0;
+	};
+}
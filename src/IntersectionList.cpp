@@ -0,0 +1,289 @@
+#include "IntersectionList.h"
+#include "RayPacket.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <numeric>
+
+using namespace dynamol;
+using namespace glm;
+
+namespace
+{
+	constexpr std::size_t footprintGrainSize = 1024;
+}
+
+void IntersectionList::build(std::span<const Layer> layers, const mat4& modelViewMatrix, const mat4& projectionMatrix, const ivec2& viewportSize, const float* depthLimit)
+{
+	auto& pool = ThreadPool::instance();
+
+	m_viewportSize = viewportSize;
+	m_tileCount = (viewportSize + ivec2(TileSize - 1)) / TileSize;
+	m_layers.assign(layers.begin(), layers.end());
+
+	const std::size_t pixelCount = std::size_t(viewportSize.x) * std::size_t(viewportSize.y);
+	const std::size_t tileCount = std::size_t(m_tileCount.x) * std::size_t(m_tileCount.y);
+
+	// Footprints of all spheres, culled against the near plane in the same way as the geometry shader
+	vec4 nearPlane = inverse(projectionMatrix) * vec4(0.0f, 0.0f, -1.0f, 1.0f);
+	nearPlane /= nearPlane.w;
+
+	std::size_t sphereCount = 0;
+
+	for (const auto& layer : m_layers)
+		sphereCount += layer.count;
+
+	m_footprints.resize(sphereCount);
+	std::vector<uint8_t> visible(sphereCount, 0);
+
+	std::size_t layerOffset = 0;
+
+	for (uint layerIndex = 0; layerIndex < m_layers.size(); layerIndex++)
+	{
+		const Layer& layer = m_layers[layerIndex];
+
+		pool.parallelFor(layer.count, [&](std::size_t i) {
+			const vec4& sphere = layer.spheres[i];
+			const uint id = floatBitsToUint(sphere.w);
+			const uint elementId = id & 0xffu;
+			const float radius = layer.radius * mix(1.0f, 2.0f, float(elementId) / 1000.0f);
+
+			const vec4 center = modelViewMatrix * vec4(vec3(sphere), 1.0f);
+			const float viewRadius = length(modelViewMatrix * vec4(radius, 0.0f, 0.0f, 0.0f));
+
+			if (center.z + viewRadius >= nearPlane.z)
+				return;
+
+			vec2 minimum(1.0f), maximum(-1.0f);
+
+			for (int corner = 0; corner < 8; corner++)
+			{
+				const vec3 offset((corner & 1) ? viewRadius : -viewRadius, (corner & 2) ? viewRadius : -viewRadius, (corner & 4) ? viewRadius : -viewRadius);
+				const vec4 clip = projectionMatrix * vec4(vec3(center) + offset, 1.0f);
+				const vec2 ndc = vec2(clip) / clip.w;
+				minimum = min(minimum, ndc);
+				maximum = max(maximum, ndc);
+			}
+
+			const ivec2 lower = max(ivec2(floor((minimum * 0.5f + 0.5f) * vec2(viewportSize))), ivec2(0));
+			const ivec2 upper = min(ivec2(ceil((maximum * 0.5f + 0.5f) * vec2(viewportSize))), viewportSize - 1);
+
+			if (lower.x > upper.x || lower.y > upper.y)
+				return;
+
+			m_footprints[layerOffset + i] = { ivec4(lower, upper), vec4(vec3(sphere), radius), id, layerIndex };
+			visible[layerOffset + i] = 1;
+		}, footprintGrainSize);
+
+		layerOffset += layer.count;
+	}
+
+	// Tile binning: count, scan, fill
+	std::vector<std::atomic<uint>> tileCounts(tileCount);
+
+	pool.parallelFor(sphereCount, [&](std::size_t i) {
+		if (!visible[i])
+			return;
+
+		const ivec4 tiles = m_footprints[i].rectangle / TileSize;
+
+		for (int y = tiles.y; y <= tiles.w; y++)
+			for (int x = tiles.x; x <= tiles.z; x++)
+				tileCounts[std::size_t(y) * m_tileCount.x + x].fetch_add(1, std::memory_order_relaxed);
+	}, footprintGrainSize);
+
+	m_tileOffsets.assign(tileCount + 1, 0);
+
+	for (std::size_t i = 0; i < tileCount; i++)
+		m_tileOffsets[i + 1] = m_tileOffsets[i] + tileCounts[i].exchange(0, std::memory_order_relaxed);
+
+	m_tileFootprints.resize(m_tileOffsets.back());
+
+	pool.parallelFor(sphereCount, [&](std::size_t i) {
+		if (!visible[i])
+			return;
+
+		const ivec4 tiles = m_footprints[i].rectangle / TileSize;
+
+		for (int y = tiles.y; y <= tiles.w; y++)
+		{
+			for (int x = tiles.x; x <= tiles.z; x++)
+			{
+				const std::size_t tile = std::size_t(y) * m_tileCount.x + x;
+				m_tileFootprints[m_tileOffsets[tile] + tileCounts[tile].fetch_add(1, std::memory_order_relaxed)] = uint(i);
+			}
+		}
+	}, footprintGrainSize);
+
+	// Keep the entry order independent of thread scheduling
+	pool.parallelFor(tileCount, [&](std::size_t tile) {
+		std::sort(m_tileFootprints.begin() + m_tileOffsets[tile], m_tileFootprints.begin() + m_tileOffsets[tile + 1]);
+	});
+
+	const mat4 inverseModelViewProjectionMatrix = inverse(projectionMatrix * modelViewMatrix);
+
+	const auto passesDepthTest = [depthLimit](std::size_t pixel, float near) {
+		return depthLimit == nullptr || near <= depthLimit[pixel];
+	};
+
+	// Per-pixel lists: count, scan, fill
+	std::vector<uint> counts(pixelCount, 0);
+
+	pool.parallelFor(tileCount, [&](std::size_t tile) {
+		traverseTile(tile, inverseModelViewProjectionMatrix, [&](std::size_t pixel, const Footprint&, float near, float) {
+			if (passesDepthTest(pixel, near))
+				counts[pixel]++;
+		});
+	});
+
+	m_offsets.assign(pixelCount + 1, 0);
+	std::vector<std::size_t> rowOffsets(std::size_t(viewportSize.y) + 1, 0);
+
+	pool.parallelFor(std::size_t(viewportSize.y), [&](std::size_t y) {
+		const auto row = counts.begin() + y * viewportSize.x;
+		rowOffsets[y + 1] = std::accumulate(row, row + viewportSize.x, std::size_t(0));
+	});
+
+	std::partial_sum(rowOffsets.begin(), rowOffsets.end(), rowOffsets.begin());
+
+	pool.parallelFor(std::size_t(viewportSize.y), [&](std::size_t y) {
+		uint offset = uint(rowOffsets[y]);
+
+		for (std::size_t i = y * viewportSize.x; i < (y + 1) * viewportSize.x; i++)
+		{
+			m_offsets[i] = offset;
+			offset += counts[i];
+		}
+	});
+
+	m_offsets[pixelCount] = uint(rowOffsets.back());
+	m_entries.resize(rowOffsets.back());
+	std::fill(counts.begin(), counts.end(), 0u);
+
+	pool.parallelFor(tileCount, [&](std::size_t tile) {
+		traverseTile(tile, inverseModelViewProjectionMatrix, [&](std::size_t pixel, const Footprint& footprint, float near, float far) {
+			if (!passesDepthTest(pixel, near))
+				return;
+
+			const Layer& layer = m_layers[footprint.layer];
+			m_entries[m_offsets[pixel] + counts[pixel]++] = { near, far, vec3(footprint.sphere), footprint.id, layer.outerRadius, layer.sharpness, layer.weight };
+		});
+	});
+}
+
+template <typename F>
+void IntersectionList::traverseTile(std::size_t tile, const mat4& inverseModelViewProjectionMatrix, F&& hit) const
+{
+	const ivec2 tileCoordinate = ivec2(int(tile % m_tileCount.x), int(tile / m_tileCount.x));
+	const ivec2 tileStart = tileCoordinate * TileSize;
+	const ivec2 tileEnd = min(tileStart + TileSize, m_viewportSize);
+
+	const uint* footprintsBegin = m_tileFootprints.data() + m_tileOffsets[tile];
+	const uint* footprintsEnd = m_tileFootprints.data() + m_tileOffsets[tile + 1];
+
+	if (footprintsBegin == footprintsEnd)
+		return;
+
+	constexpr int width = int(RayPacket::Width);
+
+	for (int y = tileStart.y; y < tileEnd.y; y++)
+	{
+		for (int x = tileStart.x; x < tileEnd.x; x += width)
+		{
+			// Rays through the pixel centers, starting on the near plane as in the shaders
+			RayPacket packet;
+			const int laneCount = std::min(width, tileEnd.x - x);
+
+			for (int lane = 0; lane < width; lane++)
+			{
+				const int px = x + std::min(lane, laneCount - 1);
+				const vec2 ndc = 2.0f * (vec2(float(px), float(y)) + 0.5f) / vec2(m_viewportSize) - 1.0f;
+
+				vec4 near = inverseModelViewProjectionMatrix * vec4(ndc, -1.0f, 1.0f);
+				near /= near.w;
+				vec4 far = inverseModelViewProjectionMatrix * vec4(ndc, 1.0f, 1.0f);
+				far /= far.w;
+
+				packet.setRay(lane, vec3(near), normalize(vec3(far) - vec3(near)));
+			}
+
+			const uint laneMask = (1u << laneCount) - 1u;
+
+			for (const uint* f = footprintsBegin; f != footprintsEnd; f++)
+			{
+				const Footprint& footprint = m_footprints[*f];
+				const ivec4& rectangle = footprint.rectangle;
+
+				if (y < rectangle.y || y > rectangle.w || x + laneCount - 1 < rectangle.x || x > rectangle.z)
+					continue;
+
+				const PacketIntersection intersection = intersect(packet, footprint.sphere);
+				uint mask = intersection.mask & laneMask;
+
+				while (mask != 0)
+				{
+					const int lane = std::countr_zero(mask);
+					mask &= mask - 1u;
+
+					hit(std::size_t(y) * m_viewportSize.x + x + lane, footprint, intersection.near[lane], intersection.far[lane]);
+				}
+			}
+		}
+	}
+}
+
+const ivec2& IntersectionList::viewportSize() const
+{
+	return m_viewportSize;
+}
+
+const std::vector<uint>& IntersectionList::offsets() const
+{
+	return m_offsets;
+}
+
+const std::vector<IntersectionList::Entry>& IntersectionList::entries() const
+{
+	return m_entries;
+}
+
+std::span<const IntersectionList::Entry> IntersectionList::entries(const ivec2& pixel) const
+{
+	const std::size_t index = std::size_t(pixel.y) * m_viewportSize.x + pixel.x;
+	return std::span<const Entry>(m_entries.data() + m_offsets[index], m_offsets[index + 1] - m_offsets[index]);
+}
+
+IntersectionList::Statistics IntersectionList::statistics() const
+{
+	Statistics statistics;
+
+	if (m_offsets.empty())
+		return statistics;
+
+	statistics.pixels = m_offsets.size() - 1;
+	statistics.entries = m_entries.size();
+
+	for (std::size_t i = 0; i < statistics.pixels; i++)
+	{
+		const std::size_t length = m_offsets[i + 1] - m_offsets[i];
+
+		if (length == 0)
+			continue;
+
+		const std::size_t bucket = std::size_t(std::bit_width(length) - 1);
+
+		if (bucket >= statistics.histogram.size())
+			statistics.histogram.resize(bucket + 1, 0);
+
+		statistics.histogram[bucket]++;
+		statistics.coveredPixels++;
+		statistics.maximumLength = std::max(statistics.maximumLength, length);
+	}
+
+	if (statistics.coveredPixels > 0)
+		statistics.averageLength = float(statistics.entries) / float(statistics.coveredPixels);
+
+	return statistics;
+}
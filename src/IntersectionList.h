@@ -0,0 +1,82 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace dynamol
+{
+	// CPU construction of the per-pixel intersection lists written by the spawn pass.
+	// Sphere footprints are binned into screen tiles and every pixel gets a compact array of entries
+	// (count, exclusive scan, fill) instead of a linked list, so the result size is known exactly.
+	class IntersectionList
+	{
+	public:
+		static constexpr int TileSize = 16;
+
+		// Same as BufferEntry in spawn-fs.glsl
+		struct Entry
+		{
+			float near;
+			float far;
+			glm::vec3 center;
+			glm::uint id;
+			float radius;
+			float sharpness;
+			float weight;
+		};
+
+		// One level of detail as drawn by the spawn pass, spheres store the packed ids in w like Protein::atoms()
+		struct Layer
+		{
+			const glm::vec4* spheres = nullptr;
+			std::size_t count = 0;
+			float radius = 1.0f; // radius used for intersection (radiusScale uniform)
+			float outerRadius = 1.0f; // radius written to the entries (outerRadius uniform)
+			float sharpness = 1.0f;
+			float weight = 1.0f;
+		};
+
+		struct Statistics
+		{
+			std::size_t pixels = 0;
+			std::size_t coveredPixels = 0;
+			std::size_t entries = 0;
+			std::size_t maximumLength = 0;
+			float averageLength = 0.0f; // over covered pixels
+			std::vector<std::size_t> histogram; // bucket i counts pixels with a list length in [2^i, 2^(i+1))
+		};
+
+		// Pixels use the gl_FragCoord convention, depthLimit optionally holds the w component of the sphere position texture
+		void build(std::span<const Layer> layers, const glm::mat4& modelViewMatrix, const glm::mat4& projectionMatrix, const glm::ivec2& viewportSize, const float* depthLimit = nullptr);
+
+		const glm::ivec2& viewportSize() const;
+		const std::vector<glm::uint>& offsets() const;
+		const std::vector<Entry>& entries() const;
+		std::span<const Entry> entries(const glm::ivec2& pixel) const;
+
+		Statistics statistics() const;
+
+	private:
+		struct Footprint
+		{
+			glm::ivec4 rectangle; // inclusive pixel bounds (x0, y0, x1, y1)
+			glm::vec4 sphere;
+			glm::uint id;
+			glm::uint layer;
+		};
+
+		template <typename F>
+		void traverseTile(std::size_t tile, const glm::mat4& inverseModelViewProjectionMatrix, F&& hit) const;
+
+		glm::ivec2 m_viewportSize = glm::ivec2(0);
+		glm::ivec2 m_tileCount = glm::ivec2(0);
+		std::vector<Layer> m_layers;
+		std::vector<Footprint> m_footprints;
+		std::vector<glm::uint> m_tileOffsets;
+		std::vector<glm::uint> m_tileFootprints;
+		std::vector<glm::uint> m_offsets;
+		std::vector<Entry> m_entries;
+	};
+}
@@ -0,0 +1,186 @@
+#include "Mesh.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+using namespace dynamol;
+using namespace glm;
+
+namespace
+{
+	// Output is buffered in chunks of this size instead of writing vertex by vertex
+	constexpr std::size_t chunkSize = 1 << 20;
+
+	class ChunkWriter
+	{
+	public:
+		explicit ChunkWriter(std::ofstream& stream) : m_stream(stream)
+		{
+			m_buffer.reserve(chunkSize + 256);
+		}
+
+		~ChunkWriter()
+		{
+			flush();
+		}
+
+		void write(const void* data, std::size_t size)
+		{
+			const char* bytes = static_cast<const char*>(data);
+			m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+
+			if (m_buffer.size() >= chunkSize)
+				flush();
+		}
+
+		void write(const char* text)
+		{
+			write(text, std::strlen(text));
+		}
+
+		void write(float value)
+		{
+			std::array<char, 32> text;
+			const auto result = std::to_chars(text.data(), text.data() + text.size(), value);
+			write(text.data(), std::size_t(result.ptr - text.data()));
+		}
+
+		void write(glm::uint value)
+		{
+			std::array<char, 16> text;
+			const auto result = std::to_chars(text.data(), text.data() + text.size(), value);
+			write(text.data(), std::size_t(result.ptr - text.data()));
+		}
+
+		void flush()
+		{
+			m_stream.write(m_buffer.data(), std::streamsize(m_buffer.size()));
+			m_buffer.clear();
+		}
+
+	private:
+		std::ofstream& m_stream;
+		std::vector<char> m_buffer;
+	};
+}
+
+bool Mesh::writePly(const std::string& filename) const
+{
+	static_assert(std::endian::native == std::endian::little, "PLY output assumes a little endian host");
+
+	std::ofstream stream(filename, std::ios::binary);
+
+	if (!stream)
+		return false;
+
+	{
+		ChunkWriter writer(stream);
+		const bool hasNormals = normals.size() == positions.size();
+
+		writer.write("ply\nformat binary_little_endian 1.0\n");
+		writer.write("element vertex ");
+		writer.write(glm::uint(positions.size()));
+		writer.write("\nproperty float x\nproperty float y\nproperty float z\n");
+
+		if (hasNormals)
+			writer.write("property float nx\nproperty float ny\nproperty float nz\n");
+
+		writer.write("element face ");
+		writer.write(glm::uint(triangles.size()));
+		writer.write("\nproperty list uchar int vertex_indices\nend_header\n");
+
+		for (std::size_t i = 0; i < positions.size(); i++)
+		{
+			writer.write(&positions[i], sizeof(vec3));
+
+			if (hasNormals)
+				writer.write(&normals[i], sizeof(vec3));
+		}
+
+		for (const auto& triangle : triangles)
+		{
+			const std::uint8_t count = 3;
+			writer.write(&count, sizeof(count));
+			writer.write(&triangle, sizeof(uvec3));
+		}
+	}
+
+	return bool(stream);
+}
+
+bool Mesh::writeObj(const std::string& filename) const
+{
+	std::ofstream stream(filename, std::ios::binary);
+
+	if (!stream)
+		return false;
+
+	{
+		ChunkWriter writer(stream);
+		const bool hasNormals = normals.size() == positions.size();
+
+		for (const auto& position : positions)
+		{
+			writer.write("v ");
+			writer.write(position.x);
+			writer.write(" ");
+			writer.write(position.y);
+			writer.write(" ");
+			writer.write(position.z);
+			writer.write("\n");
+		}
+
+		if (hasNormals)
+		{
+			for (const auto& normal : normals)
+			{
+				writer.write("vn ");
+				writer.write(normal.x);
+				writer.write(" ");
+				writer.write(normal.y);
+				writer.write(" ");
+				writer.write(normal.z);
+				writer.write("\n");
+			}
+		}
+
+		for (const auto& triangle : triangles)
+		{
+			writer.write("f");
+
+			for (int i = 0; i < 3; i++)
+			{
+				writer.write(" ");
+				writer.write(triangle[i] + 1);
+
+				if (hasNormals)
+				{
+					writer.write("//");
+					writer.write(triangle[i] + 1);
+				}
+			}
+
+			writer.write("\n");
+		}
+	}
+
+	return bool(stream);
+}
+
+bool Mesh::write(const std::string& filename) const
+{
+	std::string extension = std::filesystem::path(filename).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+
+	if (extension == ".obj")
+		return writeObj(filename);
+
+	return writePly(filename);
+}
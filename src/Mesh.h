@@ -0,0 +1,22 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+namespace dynamol
+{
+	struct Mesh
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> normals;
+		std::vector<glm::uvec3> triangles;
+
+		// Binary little endian PLY with per-vertex normals
+		bool writePly(const std::string& filename) const;
+		bool writeObj(const std::string& filename) const;
+
+		// Picks the format from the file extension, PLY unless it ends with .obj
+		bool write(const std::string& filename) const;
+	};
+}
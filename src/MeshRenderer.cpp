@@ -0,0 +1,168 @@
+#include "MeshRenderer.h"
+#include <globjects/base/File.h>
+#include <globjects/logging.h>
+#include <iostream>
+#include <array>
+#include <imgui.h>
+#include "Viewer.h"
+#include "Scene.h"
+#include "Protein.h"
+#include "SphereRenderer.h"
+#include "GaussianDensity.h"
+#include "DualContouring.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace dynamol;
+using namespace gl;
+using namespace glm;
+using namespace globjects;
+
+MeshRenderer::MeshRenderer(Viewer* viewer, const SphereRenderer* sphereRenderer) : Renderer(viewer), m_sphereRenderer(sphereRenderer)
+{
+	createShaderProgram("mesh", {
+		{ GL_VERTEX_SHADER,"./res/mesh/mesh-vs.glsl" },
+		{ GL_FRAGMENT_SHADER,"./res/mesh/mesh-fs.glsl" },
+		});
+}
+
+void MeshRenderer::buildMeshes(std::span<const vec4> atoms, float atomRadius, float spacing, float sharpness)
+{
+	const std::array<float, 4> tolerances = { 0.0f, 0.25f * spacing, 0.5f * spacing, spacing };
+
+	const double startTime = glfwGetTime();
+
+	GaussianDensity density(atoms, atomRadius, sharpness, spacing);
+	std::vector<Mesh> meshes = DualContouring(density).extract(tolerances);
+
+	globjects::debug() << "Extracted " << meshes.size() << " mesh levels in " << (glfwGetTime() - startTime) * 1000.0 << " ms";
+
+	m_levels.clear();
+	m_levels.resize(meshes.size());
+
+	for (std::size_t i = 0; i < meshes.size(); i++)
+	{
+		const Mesh& mesh = meshes[i];
+		MeshLevel& level = m_levels[i];
+
+		level.tolerance = tolerances[i];
+		level.triangleCount = mesh.triangles.size();
+		level.indexCount = GLsizei(mesh.triangles.size() * 3);
+
+		level.positions->setData(mesh.positions, GL_STATIC_DRAW);
+		level.normals->setData(mesh.normals, GL_STATIC_DRAW);
+		level.indices->setData(mesh.triangles, GL_STATIC_DRAW);
+
+		level.vao->bindElementBuffer(level.indices.get());
+
+		auto positionBinding = level.vao->binding(0);
+		positionBinding->setAttribute(0);
+		positionBinding->setBuffer(level.positions.get(), 0, sizeof(vec3));
+		positionBinding->setFormat(3, GL_FLOAT);
+		level.vao->enable(0);
+
+		auto normalBinding = level.vao->binding(1);
+		normalBinding->setAttribute(1);
+		normalBinding->setBuffer(level.normals.get(), 0, sizeof(vec3));
+		normalBinding->setFormat(3, GL_FLOAT);
+		level.vao->enable(1);
+
+		level.vao->unbind();
+	}
+}
+
+void MeshRenderer::display()
+{
+	static float spacing = 0.5f;
+	static float sharpness = 1.0f;
+	static float pixelError = 1.0f;
+	static int forcedLevel = -1;
+	static vec3 diffuseMaterial(0.6f, 0.6f, 0.6f);
+	static bool rebuild = true;
+
+	if (ImGui::BeginMenu("Mesh"))
+	{
+		ImGui::SliderFloat("Spacing", &spacing, 0.1f, 2.0f);
+		ImGui::SliderFloat("Sharpness", &sharpness, 0.5f, 16.0f);
+
+		if (ImGui::Button("Rebuild Meshes"))
+			rebuild = true;
+
+		ImGui::SliderFloat("Pixel Error", &pixelError, 0.25f, 8.0f);
+		ImGui::SliderInt("Forced Level", &forcedLevel, -1, int(m_levels.size()) - 1);
+		ImGui::ColorEdit3("Diffuse", (float*)&diffuseMaterial);
+
+		for (std::size_t i = 0; i < m_levels.size(); i++)
+			ImGui::Text("Level %zu: %zu triangles, tolerance %.3f", i, m_levels[i].triangleCount, m_levels[i].tolerance);
+
+		ImGui::EndMenu();
+	}
+
+	// Same atoms as the sphere renderer, the meshes are rebuilt when it moves on to another timestep
+	const auto& timesteps = viewer()->scene()->protein()->atoms();
+	const uint timestep = std::min(m_sphereRenderer->currentTimestep(), uint(timesteps.size()) - 1);
+
+	if (rebuild || timestep != m_timestep)
+	{
+		rebuild = false;
+		m_timestep = timestep;
+		buildMeshes(timesteps[timestep], m_sphereRenderer->atomRadius(), spacing, sharpness);
+	}
+
+	if (m_levels.empty())
+		return;
+
+	const mat4 modelViewMatrix = viewer()->modelViewTransform();
+	const mat4 projectionMatrix = viewer()->projectionTransform();
+	const ivec2 viewportSize = viewer()->viewportSize();
+
+	// Distance of the closest point of the bounding sphere decides how large the tolerance appears on screen
+	const vec3 minimumBounds = viewer()->scene()->protein()->minimumBounds();
+	const vec3 maximumBounds = viewer()->scene()->protein()->maximumBounds();
+	const vec4 center = modelViewMatrix * vec4(0.5f * (minimumBounds + maximumBounds), 1.0f);
+	const float boundingRadius = length(modelViewMatrix * vec4(0.5f * (maximumBounds - minimumBounds), 0.0f));
+	const float distance = std::max(-center.z - boundingRadius, 1e-3f);
+	const float pixelsPerUnit = 0.5f * float(viewportSize.y) * projectionMatrix[1][1] / distance;
+
+	std::size_t levelIndex = 0;
+
+	if (forcedLevel >= 0)
+	{
+		levelIndex = std::min(std::size_t(forcedLevel), m_levels.size() - 1);
+	}
+	else
+	{
+		for (std::size_t i = 0; i < m_levels.size(); i++)
+		{
+			if (m_levels[i].tolerance * pixelsPerUnit <= pixelError)
+				levelIndex = i;
+		}
+	}
+
+	const MeshLevel& level = m_levels[levelIndex];
+
+	auto currentState = State::currentState();
+
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LESS);
+	glEnable(GL_CULL_FACE);
+	glCullFace(GL_BACK);
+
+	auto program = shaderProgram("mesh");
+	program->setUniform("modelViewMatrix", modelViewMatrix);
+	program->setUniform("projectionMatrix", projectionMatrix);
+	program->setUniform("normalMatrix", transpose(inverse(mat3(modelViewMatrix))));
+	program->setUniform("diffuseMaterial", diffuseMaterial);
+
+	level.vao->bind();
+	program->use();
+	level.vao->drawElements(GL_TRIANGLES, level.indexCount, GL_UNSIGNED_INT, nullptr);
+	program->release();
+	level.vao->unbind();
+
+	glDisable(GL_CULL_FACE);
+
+	currentState->apply();
+}
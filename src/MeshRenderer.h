@@ -0,0 +1,55 @@
+#pragma once
+#include "Renderer.h"
+#include "Mesh.h"
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glbinding/gl/gl.h>
+#include <glbinding/gl/enum.h>
+#include <glbinding/gl/functions.h>
+
+#include <globjects/VertexArray.h>
+#include <globjects/VertexAttributeBinding.h>
+#include <globjects/Buffer.h>
+#include <globjects/Program.h>
+#include <globjects/Shader.h>
+#include <globjects/base/File.h>
+#include <globjects/State.h>
+
+namespace dynamol
+{
+	class Viewer;
+	class SphereRenderer;
+
+	// Rasterizes precomputed dual contouring meshes of the molecular surface, as a fallback for scenes that are too large for sphere marching.
+	// The level of detail is chosen so that its geometric tolerance projects to less than a given number of pixels.
+	class MeshRenderer : public Renderer
+	{
+	public:
+		// The meshes follow the timestep and atom radius of the sphere renderer
+		MeshRenderer(Viewer* viewer, const SphereRenderer* sphereRenderer);
+		virtual void display();
+
+		void buildMeshes(std::span<const glm::vec4> atoms, float atomRadius, float spacing, float sharpness);
+
+	private:
+		struct MeshLevel
+		{
+			float tolerance;
+			gl::GLsizei indexCount;
+			std::size_t triangleCount;
+			std::unique_ptr<globjects::VertexArray> vao = std::make_unique<globjects::VertexArray>();
+			std::unique_ptr<globjects::Buffer> positions = std::make_unique<globjects::Buffer>();
+			std::unique_ptr<globjects::Buffer> normals = std::make_unique<globjects::Buffer>();
+			std::unique_ptr<globjects::Buffer> indices = std::make_unique<globjects::Buffer>();
+		};
+
+		std::vector<MeshLevel> m_levels;
+		const SphereRenderer* m_sphereRenderer;
+		// Timestep the meshes were built for
+		glm::uint m_timestep = glm::uint(-1);
+	};
+
+}
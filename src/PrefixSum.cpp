@@ -0,0 +1,71 @@
+#include "PrefixSum.h"
+
+using namespace dynamol;
+using namespace gl;
+using namespace globjects;
+
+void PrefixSum::scan(Program* scanLocalProgram, Program* scanAddProgram, Buffer* input, Buffer* output, GLuint count)
+{
+	// Work group totals of every level, allocated once and kept as long as they are large enough
+	std::vector<GLuint> levelCounts;
+
+	for (GLuint levelCount = (count + BlockSize - 1) / BlockSize; levelCount > 1; levelCount = (levelCount + BlockSize - 1) / BlockSize)
+		levelCounts.push_back(levelCount);
+
+	levelCounts.push_back(1);
+
+	if (m_levels.size() < levelCounts.size())
+		m_levels.resize(levelCounts.size());
+
+	for (std::size_t i = 0; i < levelCounts.size(); i++)
+	{
+		if (m_levels[i].capacity < levelCounts[i])
+		{
+			m_levels[i].capacity = levelCounts[i];
+			m_levels[i].sums = Buffer::create();
+			m_levels[i].sums->setStorage(sizeof(GLuint) * levelCounts[i], nullptr, GL_NONE_BIT);
+		}
+	}
+
+	// Down sweep: scan blocks and collect their totals
+	scanLocalProgram->use();
+
+	Buffer* levelInput = input;
+	Buffer* levelOutput = output;
+	GLuint levelCount = count;
+
+	for (std::size_t i = 0; i < levelCounts.size(); i++)
+	{
+		levelInput->bindBase(GL_SHADER_STORAGE_BUFFER, 0);
+		levelOutput->bindBase(GL_SHADER_STORAGE_BUFFER, 1);
+		m_levels[i].sums->bindBase(GL_SHADER_STORAGE_BUFFER, 2);
+
+		scanLocalProgram->setUniform("count", levelCount);
+		scanLocalProgram->dispatchCompute(levelCounts[i], 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+		// The totals of this level are scanned in place on the next one
+		levelInput = levelOutput = m_levels[i].sums.get();
+		levelCount = levelCounts[i];
+	}
+
+	scanLocalProgram->release();
+
+	// Up sweep: every level except the last one (a single block) gets the scanned totals of its blocks added
+	scanAddProgram->use();
+
+	for (int i = int(levelCounts.size()) - 2; i >= 0; i--)
+	{
+		(i == 0 ? output : m_levels[i - 1].sums.get())->bindBase(GL_SHADER_STORAGE_BUFFER, 1);
+		m_levels[i].sums->bindBase(GL_SHADER_STORAGE_BUFFER, 2);
+
+		scanAddProgram->setUniform("count", i == 0 ? count : levelCounts[i - 1]);
+		scanAddProgram->dispatchCompute(levelCounts[i], 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+
+	scanAddProgram->release();
+
+	for (GLuint binding = 0; binding < 3; binding++)
+		Buffer::unbind(GL_SHADER_STORAGE_BUFFER, binding);
+}
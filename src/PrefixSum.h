@@ -0,0 +1,34 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <glbinding/gl/gl.h>
+#include <globjects/Buffer.h>
+#include <globjects/Program.h>
+
+namespace dynamol
+{
+	// Exclusive prefix sum of a uint buffer on the GPU. Every work group scans BlockSize values and writes its total,
+	// the totals are scanned recursively and added back, so any number of values takes a logarithmic number of dispatches.
+	// The programs are scan-local-cs.glsl and scan-add-cs.glsl.
+	class PrefixSum
+	{
+	public:
+		static constexpr gl::GLuint WorkGroupSize = 256;
+		static constexpr gl::GLuint ValuesPerInvocation = 4;
+		static constexpr gl::GLuint BlockSize = WorkGroupSize * ValuesPerInvocation;
+
+		// Output may be the same buffer as input
+		void scan(globjects::Program* scanLocalProgram, globjects::Program* scanAddProgram, globjects::Buffer* input, globjects::Buffer* output, gl::GLuint count);
+
+	private:
+		struct Level
+		{
+			gl::GLuint capacity = 0;
+			std::unique_ptr<globjects::Buffer> sums;
+		};
+
+		std::vector<Level> m_levels;
+	};
+}
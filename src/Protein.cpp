@@ -230,26 +230,26 @@ void Protein::load(const std::string& filename)
 	auto offset = 4.0;
 	const auto& atom = m_atoms.back();
 	// Generate testing sparse LOD (LOD-1)
-	m_genAtomsSparse.reserve(atom.size() / 10);
+	m_genAtomsSparse.reserve(atom.size() / SparseClusterSize);
 	// const auto center = 0.5f * m_minimumBounds + 0.5f * m_maximumBounds;
-	for (std::size_t i{0}; i + 10 < atom.size(); i += 10) {
+	for (std::size_t i{0}; i + SparseClusterSize < atom.size(); i += SparseClusterSize) {
 		const auto r = [offset](){ return ((ran() % 1000 * 0.001) - 0.5) * offset; };
-		const auto avg = glm::vec3{std::accumulate(atom.begin() + i, atom.begin() + std::min<unsigned long long>(i + 10, atom.end() - atom.begin()), glm::vec4{0.f})} / 10.f;
+		const auto avg = glm::vec3{std::accumulate(atom.begin() + i, atom.begin() + std::min<unsigned long long>(i + SparseClusterSize, atom.end() - atom.begin()), glm::vec4{0.f})} / float(SparseClusterSize);
 		m_genAtomsSparse.emplace_back(glm::vec4{avg + glm::vec3{r(), r(), r()}, atom[i].w}, glm::vec4{}, 5.f);
 	}
 
 	// Generate hierarchical points (LOD0):
 	m_hierarchyPoints.reserve(atom.size());
 	for (std::size_t i{0}; i < atom.size(); ++i)
-		m_hierarchyPoints.emplace_back(atom.at(i), m_genAtomsSparse.at(std::min(i / 10, m_genAtomsSparse.size() - 1)).pos, 1.7f);
+		m_hierarchyPoints.emplace_back(atom.at(i), m_genAtomsSparse.at(std::min(i / SparseClusterSize, m_genAtomsSparse.size() - 1)).pos, 1.7f);
 
 	// Generate testing dense LOD (LOD1):
 	offset = 4.0;
-	m_genAtomsDense.reserve(atom.size() * 10);
+	m_genAtomsDense.reserve(atom.size() * DenseChildCount);
 	// Note: offset radius needs to be less than parent radius, otherwise child redius becomes negative.	
 	for (const auto& parent : atom) {
 		// Generate some particles with random offsets to the parent:
-		for (uint i{0}; i < 10; ++i) {
+		for (uint i{0}; i < DenseChildCount; ++i) {
 			const auto r = [offset](){ return ((ran() % 1000 * 0.001) - 0.5) * offset; };
 			const glm::vec3 posOffset{r(), r(), r()};
 			auto p = parent + glm::vec4{posOffset, 0.f};
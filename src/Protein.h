@@ -58,6 +58,10 @@ namespace dynamol
 			glm::vec4 parent;
 			float radius;
 		};
+		// Atoms per point of the sparse level of detail and points per atom of the dense one, so that every level
+		// consists of clusters of consecutive vertices that belong to the same sparse point
+		static constexpr std::size_t SparseClusterSize = 10;
+		static constexpr std::size_t DenseChildCount = 10;
 		std::vector<HierchicalPoints> m_genAtomsSparse, m_genAtomsDense;
 		std::vector<HierchicalPoints> m_hierarchyPoints;
 
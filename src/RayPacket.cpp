@@ -0,0 +1,247 @@
+#include "RayPacket.h"
+#include "RayPacketAVX2.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(DYNAMOL_AVX2) && defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+using namespace dynamol;
+using namespace glm;
+
+namespace
+{
+	constexpr std::uint32_t noHit = ~0u;
+	constexpr std::uint32_t fullMask = (1u << RayPacket::Width) - 1u;
+
+	// Same operation order as the shader and the vector path, so results match bit for bit
+	inline bool intersectLane(const RayPacket& packet, std::size_t lane, const vec4& sphere, float& near, float& far)
+	{
+		const float ocx = packet.originX[lane] - sphere.x;
+		const float ocy = packet.originY[lane] - sphere.y;
+		const float ocz = packet.originZ[lane] - sphere.z;
+
+		const float loc = packet.directionX[lane] * ocx + packet.directionY[lane] * ocy + packet.directionZ[lane] * ocz;
+		const float ococ = ocx * ocx + ocy * ocy + ocz * ocz;
+		const float discriminant = (loc * loc - ococ) + sphere.w * sphere.w;
+
+		if (discriminant <= 0.0f)
+			return false;
+
+		const float root = std::sqrt(discriminant);
+		near = -loc - root;
+		far = -loc + root;
+		return true;
+	}
+
+	// Only RayPacketAVX2.cpp is compiled with AVX2, its kernels are used if the CPU and the operating system support it
+	bool supportsAVX2()
+	{
+#if !defined(DYNAMOL_AVX2)
+		return false;
+#elif defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+
+		if (info[0] < 7)
+			return false;
+
+		// AVX and OSXSAVE, and the operating system saves the YMM registers
+		__cpuid(info, 1);
+
+		if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 0x6) != 0x6)
+			return false;
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+
+	const bool avx2Supported = supportsAVX2();
+}
+
+bool dynamol::vectorizedPackets()
+{
+	return avx2Supported;
+}
+
+Sphere dynamol::calcSphereIntersection(float r, const vec3& origin, const vec3& center, const vec3& line)
+{
+	vec3 oc = origin - center;
+	vec3 l = normalize(line);
+	float loc = dot(l, oc);
+	float under_square_root = loc * loc - dot(oc, oc) + r * r;
+
+	if (under_square_root > 0)
+	{
+		float da = -loc + std::sqrt(under_square_root);
+		float ds = -loc - std::sqrt(under_square_root);
+		vec3 near = origin + min(da, ds) * l;
+		vec3 far = origin + max(da, ds) * l;
+
+		return { true, near, far };
+	}
+
+	return { false, vec3(0.0f), vec3(0.0f) };
+}
+
+void RayPacket::setRay(std::size_t lane, const vec3& origin, const vec3& direction)
+{
+	originX[lane] = origin.x;
+	originY[lane] = origin.y;
+	originZ[lane] = origin.z;
+	directionX[lane] = direction.x;
+	directionY[lane] = direction.y;
+	directionZ[lane] = direction.z;
+}
+
+vec3 RayPacket::origin(std::size_t lane) const
+{
+	return vec3(originX[lane], originY[lane], originZ[lane]);
+}
+
+vec3 RayPacket::direction(std::size_t lane) const
+{
+	return vec3(directionX[lane], directionY[lane], directionZ[lane]);
+}
+
+float RayPacket::originSpread() const
+{
+	float spread = 0.0f;
+
+	for (std::size_t i = 1; i < Width; i++)
+		spread = std::max(spread, length(origin(i) - origin(0)));
+
+	return spread;
+}
+
+Sphere PacketIntersection::sphere(const RayPacket& packet, std::size_t lane) const
+{
+	if (!hit(lane))
+		return {};
+
+	const vec3 origin = packet.origin(lane);
+	const vec3 direction = packet.direction(lane);
+	return { true, origin + near[lane] * direction, origin + far[lane] * direction };
+}
+
+PacketIntersection dynamol::intersectReference(const RayPacket& packet, const vec4& sphere)
+{
+	PacketIntersection result;
+
+	for (std::size_t i = 0; i < RayPacket::Width; i++)
+	{
+		result.near[i] = 0.0f;
+		result.far[i] = 0.0f;
+
+		if (intersectLane(packet, i, sphere, result.near[i], result.far[i]))
+			result.mask |= 1u << i;
+	}
+
+	return result;
+}
+
+PacketIntersection dynamol::intersect(const RayPacket& packet, const vec4& sphere)
+{
+#if defined(DYNAMOL_AVX2)
+	if (avx2Supported)
+	{
+		PacketIntersection result;
+		avx2::intersect(packet, sphere, result);
+		return result;
+	}
+#endif
+
+	return intersectReference(packet, sphere);
+}
+
+void dynamol::sortSpheres(std::vector<vec4>& spheres, const vec3& origin)
+{
+	std::sort(spheres.begin(), spheres.end(), [&origin](const vec4& a, const vec4& b) {
+		return length(vec3(a) - origin) - a.w < length(vec3(b) - origin) - b.w;
+	});
+}
+
+PacketHit dynamol::intersectClosestReference(const RayPacket& packet, const vec4* spheres, std::size_t count)
+{
+	PacketHit result;
+
+	for (std::size_t i = 0; i < RayPacket::Width; i++)
+	{
+		result.distance[i] = std::numeric_limits<float>::max();
+		result.index[i] = noHit;
+	}
+
+	for (std::size_t j = 0; j < count; j++)
+	{
+		for (std::size_t i = 0; i < RayPacket::Width; i++)
+		{
+			float near, far;
+
+			if (intersectLane(packet, i, spheres[j], near, far) && near >= 0.0f && near < result.distance[i])
+			{
+				result.distance[i] = near;
+				result.index[i] = std::uint32_t(j);
+				result.mask |= 1u << i;
+			}
+		}
+	}
+
+	return result;
+}
+
+PacketHit dynamol::intersectClosest(const RayPacket& packet, const vec4* spheres, std::size_t count)
+{
+	PacketHit result;
+
+	for (std::size_t i = 0; i < RayPacket::Width; i++)
+	{
+		result.distance[i] = std::numeric_limits<float>::max();
+		result.index[i] = noHit;
+	}
+
+	const vec3 origin = packet.origin(0);
+	const float spread = packet.originSpread();
+
+#if defined(DYNAMOL_AVX2)
+	if (avx2Supported)
+	{
+		avx2::intersectClosest(packet, spheres, count, spread, result);
+		return result;
+	}
+#endif
+
+	float farthest = std::numeric_limits<float>::max();
+
+	for (std::size_t j = 0; j < count; j++)
+	{
+		const vec4& sphere = spheres[j];
+
+		// Spheres are sorted by their smallest possible distance, once every lane has a closer hit we are done
+		if (result.mask == fullMask && length(vec3(sphere) - origin) - sphere.w - spread > farthest)
+			break;
+
+		for (std::size_t i = 0; i < RayPacket::Width; i++)
+		{
+			float near, far;
+
+			if (intersectLane(packet, i, sphere, near, far) && near >= 0.0f && near < result.distance[i])
+			{
+				result.distance[i] = near;
+				result.index[i] = std::uint32_t(j);
+				result.mask |= 1u << i;
+			}
+		}
+
+		if (result.mask == fullMask)
+			farthest = *std::max_element(result.distance, result.distance + RayPacket::Width);
+	}
+
+	return result;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dynamol
+{
+	// CPU counterpart of the Sphere struct used in spawn-fs.glsl and surface-fs.glsl
+	struct Sphere
+	{
+		bool hit = false;
+		glm::vec3 near = glm::vec3(0.0f);
+		glm::vec3 far = glm::vec3(0.0f);
+	};
+
+	// Scalar reference, identical to calcSphereIntersection() in the shaders
+	Sphere calcSphereIntersection(float r, const glm::vec3& origin, const glm::vec3& center, const glm::vec3& line);
+
+	// Eight coherent rays stored as structure of arrays so that they map onto one AVX2 register per component
+	struct RayPacket
+	{
+		static constexpr std::size_t Width = 8;
+
+		alignas(32) float originX[Width] = {};
+		alignas(32) float originY[Width] = {};
+		alignas(32) float originZ[Width] = {};
+		alignas(32) float directionX[Width] = {};
+		alignas(32) float directionY[Width] = {};
+		alignas(32) float directionZ[Width] = {};
+
+		// Directions are expected to be normalized, like the line parameter in the shaders
+		void setRay(std::size_t lane, const glm::vec3& origin, const glm::vec3& direction);
+		glm::vec3 origin(std::size_t lane) const;
+		glm::vec3 direction(std::size_t lane) const;
+
+		// Largest distance of any lane origin from the origin of lane 0, used to bound hit distances for sorted sphere lists
+		float originSpread() const;
+	};
+
+	// Ray parameters of the near and far intersection for all lanes, lanes that missed have their bit cleared in mask
+	struct PacketIntersection
+	{
+		alignas(32) float near[RayPacket::Width];
+		alignas(32) float far[RayPacket::Width];
+		std::uint32_t mask = 0;
+
+		bool hit(std::size_t lane) const { return (mask >> lane) & 1u; }
+		Sphere sphere(const RayPacket& packet, std::size_t lane) const;
+	};
+
+	// Closest hit per lane, index is ~0u for lanes without a hit in front of the ray origin
+	struct PacketHit
+	{
+		alignas(32) float distance[RayPacket::Width];
+		alignas(32) std::uint32_t index[RayPacket::Width];
+		std::uint32_t mask = 0;
+	};
+
+	// Whether intersect() and intersectClosest() use the AVX2 kernels on this CPU
+	bool vectorizedPackets();
+
+	// Spheres are given as center and radius (xyz/w)
+	PacketIntersection intersect(const RayPacket& packet, const glm::vec4& sphere);
+	PacketIntersection intersectReference(const RayPacket& packet, const glm::vec4& sphere);
+
+	// Sorts spheres front to back with respect to origin, so that intersectClosest() can stop early
+	void sortSpheres(std::vector<glm::vec4>& spheres, const glm::vec3& origin);
+
+	// Closest intersection of every lane with a list of spheres sorted by sortSpheres() using the origin of lane 0
+	PacketHit intersectClosest(const RayPacket& packet, const glm::vec4* spheres, std::size_t count);
+	PacketHit intersectClosestReference(const RayPacket& packet, const glm::vec4* spheres, std::size_t count);
+}
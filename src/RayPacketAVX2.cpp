@@ -0,0 +1,105 @@
+#include "RayPacketAVX2.h"
+
+#if defined(__AVX2__)
+
+#include <cfloat>
+#include <immintrin.h>
+
+using namespace dynamol;
+using namespace glm;
+
+void avx2::intersect(const RayPacket& packet, const vec4& sphere, PacketIntersection& result)
+{
+	const __m256 zero = _mm256_setzero_ps();
+
+	const __m256 ocx = _mm256_sub_ps(_mm256_load_ps(packet.originX), _mm256_set1_ps(sphere.x));
+	const __m256 ocy = _mm256_sub_ps(_mm256_load_ps(packet.originY), _mm256_set1_ps(sphere.y));
+	const __m256 ocz = _mm256_sub_ps(_mm256_load_ps(packet.originZ), _mm256_set1_ps(sphere.z));
+
+	const __m256 dx = _mm256_load_ps(packet.directionX);
+	const __m256 dy = _mm256_load_ps(packet.directionY);
+	const __m256 dz = _mm256_load_ps(packet.directionZ);
+
+	const __m256 loc = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, ocx), _mm256_mul_ps(dy, ocy)), _mm256_mul_ps(dz, ocz));
+	const __m256 ococ = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocx, ocx), _mm256_mul_ps(ocy, ocy)), _mm256_mul_ps(ocz, ocz));
+	const __m256 discriminant = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(loc, loc), ococ), _mm256_set1_ps(sphere.w * sphere.w));
+
+	const __m256 hit = _mm256_cmp_ps(discriminant, zero, _CMP_GT_OQ);
+	const __m256 root = _mm256_sqrt_ps(_mm256_max_ps(discriminant, zero));
+	const __m256 negativeLoc = _mm256_sub_ps(zero, loc);
+
+	_mm256_store_ps(result.near, _mm256_and_ps(hit, _mm256_sub_ps(negativeLoc, root)));
+	_mm256_store_ps(result.far, _mm256_and_ps(hit, _mm256_add_ps(negativeLoc, root)));
+	result.mask = std::uint32_t(_mm256_movemask_ps(hit));
+}
+
+void avx2::intersectClosest(const RayPacket& packet, const vec4* spheres, std::size_t count, float spread, PacketHit& result)
+{
+	constexpr std::uint32_t fullMask = (1u << RayPacket::Width) - 1u;
+
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 ox = _mm256_load_ps(packet.originX);
+	const __m256 oy = _mm256_load_ps(packet.originY);
+	const __m256 oz = _mm256_load_ps(packet.originZ);
+	const __m256 dx = _mm256_load_ps(packet.directionX);
+	const __m256 dy = _mm256_load_ps(packet.directionY);
+	const __m256 dz = _mm256_load_ps(packet.directionZ);
+
+	__m256 closest = _mm256_load_ps(result.distance);
+	__m256i index = _mm256_load_si256(reinterpret_cast<const __m256i*>(result.index));
+	float farthest = FLT_MAX;
+
+	for (std::size_t j = 0; j < count; j++)
+	{
+		const vec4& sphere = spheres[j];
+
+		// Spheres are sorted by their smallest possible distance, once every lane has a closer hit we are done
+		if (result.mask == fullMask)
+		{
+			const float cx = sphere.x - packet.originX[0];
+			const float cy = sphere.y - packet.originY[0];
+			const float cz = sphere.z - packet.originZ[0];
+			const float distance = _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(cx * cx + cy * cy + cz * cz)));
+
+			if (distance - sphere.w - spread > farthest)
+				break;
+		}
+
+		const __m256 ocx = _mm256_sub_ps(ox, _mm256_set1_ps(sphere.x));
+		const __m256 ocy = _mm256_sub_ps(oy, _mm256_set1_ps(sphere.y));
+		const __m256 ocz = _mm256_sub_ps(oz, _mm256_set1_ps(sphere.z));
+
+		const __m256 loc = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, ocx), _mm256_mul_ps(dy, ocy)), _mm256_mul_ps(dz, ocz));
+		const __m256 ococ = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocx, ocx), _mm256_mul_ps(ocy, ocy)), _mm256_mul_ps(ocz, ocz));
+		const __m256 discriminant = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(loc, loc), ococ), _mm256_set1_ps(sphere.w * sphere.w));
+
+		const __m256 near = _mm256_sub_ps(_mm256_sub_ps(zero, loc), _mm256_sqrt_ps(_mm256_max_ps(discriminant, zero)));
+
+		__m256 closer = _mm256_cmp_ps(discriminant, zero, _CMP_GT_OQ);
+		closer = _mm256_and_ps(closer, _mm256_cmp_ps(near, zero, _CMP_GE_OQ));
+		closer = _mm256_and_ps(closer, _mm256_cmp_ps(near, closest, _CMP_LT_OQ));
+
+		const int closerMask = _mm256_movemask_ps(closer);
+
+		if (closerMask == 0)
+			continue;
+
+		closest = _mm256_blendv_ps(closest, near, closer);
+		index = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(index), _mm256_castsi256_ps(_mm256_set1_epi32(int(j))), closer));
+		result.mask |= std::uint32_t(closerMask);
+
+		if (result.mask == fullMask)
+		{
+			// Horizontal maximum of the closest distances
+			__m128 maximum = _mm_max_ps(_mm256_castps256_ps128(closest), _mm256_extractf128_ps(closest, 1));
+			maximum = _mm_max_ps(maximum, _mm_movehl_ps(maximum, maximum));
+			maximum = _mm_max_ss(maximum, _mm_shuffle_ps(maximum, maximum, 1));
+			farthest = _mm_cvtss_f32(maximum);
+		}
+	}
+
+	_mm256_store_ps(result.distance, closest);
+	_mm256_store_si256(reinterpret_cast<__m256i*>(result.index), index);
+}
+
+#endif
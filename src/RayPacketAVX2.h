@@ -0,0 +1,17 @@
+#pragma once
+
+#include "RayPacket.h"
+
+namespace dynamol
+{
+	// AVX2 kernels behind intersect() and intersectClosest(). RayPacketAVX2.cpp is the only file compiled with AVX2
+	// enabled and the kernels are only called once the CPU is known to support it. They use intrinsics and plain field
+	// access only, so that no inline function compiled with AVX2 ends up shared with the rest of the program.
+	namespace avx2
+	{
+		void intersect(const RayPacket& packet, const glm::vec4& sphere, PacketIntersection& result);
+
+		// result has to be initialized with no hits, spread is RayPacket::originSpread()
+		void intersectClosest(const RayPacket& packet, const glm::vec4* spheres, std::size_t count, float spread, PacketHit& result);
+	}
+}
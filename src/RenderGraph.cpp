@@ -0,0 +1,492 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+
+#include <glbinding/gl/enum.h>
+#include <glbinding/gl/functions.h>
+#include <globjects/logging.h>
+
+using namespace dynamol;
+using namespace gl;
+using namespace glm;
+using namespace globjects;
+
+namespace
+{
+	bool includes(MemoryBarrierMask mask, MemoryBarrierMask bits)
+	{
+		return (static_cast<GLbitfield>(mask) & static_cast<GLbitfield>(bits)) == static_cast<GLbitfield>(bits);
+	}
+}
+
+RenderGraph::Builder::Builder(RenderGraph& graph, std::size_t pass) : m_graph(graph), m_pass(pass)
+{
+}
+
+void RenderGraph::Builder::read(Resource resource, Access access)
+{
+	Use& use = m_graph.use(m_pass, resource, access);
+
+	if (!use.read)
+	{
+		use.read = true;
+		use.readVersion = resource.version;
+	}
+}
+
+RenderGraph::Resource RenderGraph::Builder::write(Resource resource, Access access)
+{
+	Use& use = m_graph.use(m_pass, resource, access);
+	Node& node = m_graph.m_nodes[resource.index];
+
+	// Further writes in the same pass, also with other kinds of access, do not create another version
+	const auto& uses = m_graph.m_passes[m_pass].uses;
+	auto written = std::find_if(uses.begin(), uses.end(), [&resource](const Use& other) { return other.resource == resource.index && other.write; });
+
+	if (written != uses.end())
+	{
+		const std::uint32_t version = written->writeVersion;
+		use.write = true;
+		use.writeVersion = version;
+		return { resource.index, version };
+	}
+
+	if (resource.version != node.version)
+		globjects::warning() << "Render graph pass " << m_graph.m_passes[m_pass].name << " writes an outdated version of " << node.name;
+
+	use.write = true;
+	use.writeVersion = ++node.version;
+	node.outputs.push_back(false);
+
+	return { resource.index, use.writeVersion };
+}
+
+RenderGraph::Resource RenderGraph::Builder::readWrite(Resource resource, Access access)
+{
+	read(resource, access);
+	return write(resource, access);
+}
+
+void RenderGraph::Builder::sample(Resource texture, GLuint unit)
+{
+	read(texture, Access::Sampled);
+
+	Use& use = m_graph.use(m_pass, texture, Access::Sampled);
+	use.binding = Binding::TextureUnit;
+	use.unit = unit;
+}
+
+RenderGraph::Resource RenderGraph::Builder::image(Resource texture, GLuint unit, GLenum access, GLenum format)
+{
+	Resource result = texture;
+
+	if (access != GL_WRITE_ONLY)
+		read(texture, Access::Image);
+
+	if (access != GL_READ_ONLY)
+		result = write(texture, Access::Image);
+
+	Use& use = m_graph.use(m_pass, texture, Access::Image);
+	use.binding = Binding::ImageUnit;
+	use.unit = unit;
+	use.imageAccess = access;
+	use.format = format;
+
+	return result;
+}
+
+RenderGraph::Resource RenderGraph::Builder::storage(Resource buffer, GLuint binding, GLenum access)
+{
+	Resource result = buffer;
+
+	if (access != GL_WRITE_ONLY)
+		read(buffer, Access::Storage);
+
+	if (access != GL_READ_ONLY)
+		result = write(buffer, Access::Storage);
+
+	Use& use = m_graph.use(m_pass, buffer, Access::Storage);
+	use.binding = Binding::StorageBuffer;
+	use.unit = binding;
+
+	return result;
+}
+
+RenderGraph::Resource RenderGraph::Builder::colorAttachment(Resource texture, GLuint index)
+{
+	const Resource result = write(texture, Access::Attachment);
+
+	Use& use = m_graph.use(m_pass, texture, Access::Attachment);
+	use.binding = Binding::ColorAttachment;
+	use.unit = index;
+
+	return result;
+}
+
+RenderGraph::Resource RenderGraph::Builder::depthAttachment(Resource texture, GLenum access)
+{
+	Resource result = texture;
+
+	if (access != GL_WRITE_ONLY)
+		read(texture, Access::Attachment);
+
+	if (access != GL_READ_ONLY)
+		result = write(texture, Access::Attachment);
+
+	Use& use = m_graph.use(m_pass, texture, Access::Attachment);
+	use.binding = Binding::DepthAttachment;
+
+	return result;
+}
+
+void RenderGraph::Builder::sideEffect()
+{
+	m_graph.m_passes[m_pass].sideEffect = true;
+}
+
+RenderGraph::Resource RenderGraph::createTexture(const std::string& name, GLenum internalFormat, const ivec2& size)
+{
+	Node& node = m_nodes.emplace_back();
+	node.name = name;
+	node.transient = true;
+	node.internalFormat = internalFormat;
+	node.size = size;
+	node.outputs.push_back(false);
+
+	return { m_nodes.size() - 1, 0 };
+}
+
+RenderGraph::Resource RenderGraph::importTexture(const std::string& name, Texture* texture)
+{
+	Node& node = m_nodes.emplace_back();
+	node.name = name;
+	node.texture = texture;
+	node.outputs.push_back(false);
+
+	return { m_nodes.size() - 1, 0 };
+}
+
+RenderGraph::Resource RenderGraph::importBuffer(const std::string& name, Buffer* buffer)
+{
+	Node& node = m_nodes.emplace_back();
+	node.name = name;
+	node.buffer = buffer;
+	node.outputs.push_back(false);
+
+	return { m_nodes.size() - 1, 0 };
+}
+
+void RenderGraph::output(Resource resource)
+{
+	m_nodes[resource.index].outputs[resource.version] = true;
+}
+
+void RenderGraph::addPass(const std::string& name, const std::function<void(Builder&)>& setup, std::function<void()> execute)
+{
+	Pass& pass = m_passes.emplace_back();
+	pass.name = name;
+	pass.execute = std::move(execute);
+
+	Builder builder(*this, m_passes.size() - 1);
+	setup(builder);
+}
+
+RenderGraph::Use& RenderGraph::use(std::size_t pass, Resource resource, Access access)
+{
+	auto& uses = m_passes[pass].uses;
+	auto it = std::find_if(uses.begin(), uses.end(), [&](const Use& use) { return use.resource == resource.index && use.access == access; });
+
+	if (it != uses.end())
+		return *it;
+
+	Use& use = uses.emplace_back();
+	use.resource = resource.index;
+	use.access = access;
+	return use;
+}
+
+void RenderGraph::cull()
+{
+	std::vector<std::vector<bool>> needed(m_nodes.size());
+
+	for (std::size_t i = 0; i < m_nodes.size(); i++)
+	{
+		needed[i] = m_nodes[i].outputs;
+
+		// Imported resources outlive the frame
+		if (!m_nodes[i].transient)
+			needed[i].back() = true;
+	}
+
+	// Readers always come after the writers of their versions, so a single backwards sweep finds every live pass
+	for (std::size_t p = m_passes.size(); p-- > 0;)
+	{
+		Pass& pass = m_passes[p];
+		pass.alive = pass.sideEffect || std::any_of(pass.uses.begin(), pass.uses.end(), [&needed](const Use& use) {
+			return use.write && needed[use.resource][use.writeVersion];
+		});
+
+		if (!pass.alive)
+			continue;
+
+		for (const Use& use : pass.uses)
+			if (use.read)
+				needed[use.resource][use.readVersion] = true;
+	}
+}
+
+MemoryBarrierMask RenderGraph::barrierBit(const Node& node, Access access) const
+{
+	switch (access)
+	{
+	case Access::Sampled: return GL_TEXTURE_FETCH_BARRIER_BIT;
+	case Access::Image: return GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+	case Access::Storage: return GL_SHADER_STORAGE_BARRIER_BIT;
+	case Access::Attachment: return GL_FRAMEBUFFER_BARRIER_BIT;
+	case Access::Transfer: return node.buffer ? GL_BUFFER_UPDATE_BARRIER_BIT : GL_TEXTURE_UPDATE_BARRIER_BIT;
+	case Access::Indirect: return GL_COMMAND_BARRIER_BIT;
+	case Access::Vertex: return GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT;
+	case Access::Uniform: return GL_UNIFORM_BARRIER_BIT;
+	}
+
+	return GL_ALL_BARRIER_BITS;
+}
+
+RenderGraph::SyncState& RenderGraph::syncState(const Node& node)
+{
+	if (node.transient)
+		return m_transientSync[std::size_t(&node - m_nodes.data())];
+
+	return m_importedSync[node.buffer ? static_cast<const void*>(node.buffer) : static_cast<const void*>(node.texture)];
+}
+
+void RenderGraph::bind(Pass& pass)
+{
+	std::vector<std::pair<GLenum, Texture*>> attachments;
+
+	for (const Use& use : pass.uses)
+	{
+		const Node& node = m_nodes[use.resource];
+
+		switch (use.binding)
+		{
+		case Binding::TextureUnit:
+			node.texture->bindActive(use.unit);
+			break;
+		case Binding::ImageUnit:
+			node.texture->bindImageTexture(use.unit, 0, false, 0, use.imageAccess, use.format);
+			break;
+		case Binding::StorageBuffer:
+			node.buffer->bindBase(GL_SHADER_STORAGE_BUFFER, use.unit);
+			break;
+		case Binding::ColorAttachment:
+			attachments.emplace_back(GLenum(static_cast<unsigned int>(GL_COLOR_ATTACHMENT0) + use.unit), node.texture);
+			break;
+		case Binding::DepthAttachment:
+			attachments.emplace_back(GL_DEPTH_ATTACHMENT, node.texture);
+			break;
+		case Binding::None:
+			break;
+		}
+	}
+
+	if (attachments.empty())
+		return;
+
+	std::sort(attachments.begin(), attachments.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+	std::vector<GLenum> attachmentPoints;
+	// Fragment output location i goes to color attachment i, locations without attachment are discarded
+	std::vector<GLenum> drawBuffers;
+
+	for (const auto& [attachment, texture] : attachments)
+	{
+		attachmentPoints.push_back(attachment);
+
+		if (attachment == GL_DEPTH_ATTACHMENT)
+			continue;
+
+		const std::size_t location = static_cast<unsigned int>(attachment) - static_cast<unsigned int>(GL_COLOR_ATTACHMENT0);
+		drawBuffers.resize(std::max(drawBuffers.size(), location + 1), GL_NONE);
+		drawBuffers[location] = attachment;
+	}
+
+	// A pass that changes its attachments between frames, e.g. with a different mode, gets a new framebuffer
+	CachedFramebuffer& cached = m_framebuffers[pass.name];
+
+	if (!cached.framebuffer || cached.attachments != attachmentPoints)
+	{
+		cached.framebuffer = Framebuffer::create();
+		cached.framebuffer->setDrawBuffers(drawBuffers.empty() ? std::vector<GLenum>{ GL_NONE } : drawBuffers);
+		cached.attachments = attachmentPoints;
+	}
+
+	for (const auto& [attachment, texture] : attachments)
+		cached.framebuffer->attachTexture(attachment, texture);
+
+	cached.framebuffer->bind();
+}
+
+void RenderGraph::unbind(const Pass& pass)
+{
+	bool framebuffer = false;
+
+	for (const Use& use : pass.uses)
+	{
+		const Node& node = m_nodes[use.resource];
+
+		switch (use.binding)
+		{
+		case Binding::TextureUnit:
+			node.texture->unbindActive(use.unit);
+			break;
+		case Binding::ImageUnit:
+			node.texture->unbindImageTexture(use.unit);
+			break;
+		case Binding::StorageBuffer:
+			node.buffer->unbind(GL_SHADER_STORAGE_BUFFER, use.unit);
+			break;
+		case Binding::ColorAttachment:
+		case Binding::DepthAttachment:
+			framebuffer = true;
+			break;
+		case Binding::None:
+			break;
+		}
+	}
+
+	if (framebuffer)
+		Framebuffer::unbind();
+}
+
+void RenderGraph::execute(RenderTargetPool& pool, GpuProfiler* profiler)
+{
+	cull();
+
+	// Lifetimes of the transient textures over the live passes
+	constexpr std::size_t NoPass = std::size_t(-1);
+	std::vector<std::size_t> firstUse(m_nodes.size(), NoPass);
+	std::vector<std::size_t> lastUse(m_nodes.size(), NoPass);
+
+	for (std::size_t p = 0; p < m_passes.size(); p++)
+	{
+		if (!m_passes[p].alive)
+			continue;
+
+		for (const Use& use : m_passes[p].uses)
+		{
+			if (firstUse[use.resource] == NoPass)
+				firstUse[use.resource] = p;
+
+			lastUse[use.resource] = p;
+		}
+	}
+
+	m_transientSync.assign(m_nodes.size(), SyncState());
+	m_statistics = Statistics();
+
+	std::vector<std::uint32_t> currentVersion(m_nodes.size(), 0);
+
+	for (std::size_t p = 0; p < m_passes.size(); p++)
+	{
+		Pass& pass = m_passes[p];
+		PassInfo& info = m_statistics.passes.emplace_back();
+		info.name = pass.name;
+		info.culled = !pass.alive;
+
+		if (!pass.alive)
+		{
+			m_statistics.culledPasses++;
+			continue;
+		}
+
+		for (const Use& use : pass.uses)
+		{
+			Node& node = m_nodes[use.resource];
+
+			if (node.transient && firstUse[use.resource] == p)
+				node.texture = pool.acquire(node.internalFormat, node.size);
+
+			if (use.read && use.readVersion < currentVersion[use.resource])
+				globjects::warning() << "Render graph pass " << pass.name << " reads " << node.name << " after a later version was written";
+
+			if (use.read && node.transient && use.readVersion == 0)
+				globjects::warning() << "Render graph pass " << pass.name << " reads " << node.name << " before it was written";
+
+			const SyncState& sync = syncState(node);
+			const MemoryBarrierMask bit = barrierBit(node, use.access);
+
+			if (sync.pending && !includes(sync.synced, bit))
+				info.barriers |= bit;
+		}
+
+		if (static_cast<GLbitfield>(info.barriers) != 0)
+		{
+			glMemoryBarrier(info.barriers);
+			m_statistics.barriers++;
+
+			// The barrier covers every earlier incoherent write, not only those of this pass's resources
+			for (auto& state : m_transientSync)
+				if (state.pending)
+					state.synced |= info.barriers;
+
+			for (auto& [object, state] : m_importedSync)
+				if (state.pending)
+					state.synced |= info.barriers;
+		}
+
+		bind(pass);
+
+		if (profiler)
+			profiler->begin(pass.name);
+
+		pass.execute();
+
+		if (profiler)
+			profiler->end();
+
+		unbind(pass);
+
+		for (const Use& use : pass.uses)
+		{
+			if (!use.write)
+				continue;
+
+			currentVersion[use.resource] = std::max(currentVersion[use.resource], use.writeVersion);
+
+			// Attachment and transfer writes are ordered with later commands by the API itself
+			if (use.access == Access::Image || use.access == Access::Storage)
+				syncState(m_nodes[use.resource]) = SyncState{ true };
+		}
+
+		for (const Use& use : pass.uses)
+		{
+			Node& node = m_nodes[use.resource];
+
+			if (node.transient && lastUse[use.resource] == p && node.texture)
+			{
+				pool.release(node.texture);
+				node.texture = nullptr;
+			}
+		}
+	}
+
+	m_passes.clear();
+	m_nodes.clear();
+	m_transientSync.clear();
+}
+
+Texture* RenderGraph::texture(Resource resource) const
+{
+	return m_nodes[resource.index].texture;
+}
+
+Buffer* RenderGraph::buffer(Resource resource) const
+{
+	return m_nodes[resource.index].buffer;
+}
+
+const RenderGraph::Statistics& RenderGraph::statistics() const
+{
+	return m_statistics;
+}
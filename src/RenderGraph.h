@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glbinding/gl/gl.h>
+#include <globjects/Buffer.h>
+#include <globjects/Framebuffer.h>
+#include <globjects/Texture.h>
+
+#include "RenderTargetPool.h"
+#include "GpuProfiler.h"
+
+namespace dynamol
+{
+	// Passes of a frame with the textures and buffers they read and write, recorded with addPass() and run by execute().
+	// From the declarations the graph
+	//  - culls passes whose results are neither read by a live pass nor outputs, unless they have side effects,
+	//  - acquires transient textures from the pool before their first live use and releases them after their last one,
+	//  - attaches the declared attachments to a framebuffer per pass and binds it, and binds textures, images and buffers,
+	//  - issues glMemoryBarrier before a pass only for the kinds of access that follow incoherent image or storage writes.
+	// Every write creates a new version of a resource and reads refer to the version that was current when the pass
+	// was added, so a pass that writes a version nobody reads is culled even if it is recorded.
+	class RenderGraph
+	{
+	public:
+		struct Resource
+		{
+			std::size_t index = std::size_t(-1);
+			std::uint32_t version = 0;
+
+			bool valid() const { return index != std::size_t(-1); }
+		};
+
+		// Determines the barrier that an access needs after an incoherent write
+		enum class Access
+		{
+			Sampled,    // texture fetches
+			Image,      // image loads and stores
+			Storage,    // shader storage buffers
+			Attachment, // framebuffer attachments, including depth tests
+			Transfer,   // clears, copies, blits and read backs through the API
+			Indirect,   // indirect draw and dispatch parameters
+			Vertex,     // vertex attributes and indices
+			Uniform     // uniform buffers
+		};
+
+		struct PassInfo
+		{
+			std::string name;
+			bool culled = false;
+			gl::MemoryBarrierMask barriers = gl::GL_NONE_BIT;
+		};
+
+		struct Statistics
+		{
+			std::vector<PassInfo> passes;
+			std::size_t culledPasses = 0;
+			std::size_t barriers = 0;
+		};
+
+		class Builder
+		{
+		public:
+			void read(Resource resource, Access access);
+			Resource write(Resource resource, Access access);
+			// Reads the current version and writes the next one, e.g. a depth test with depth writes
+			Resource readWrite(Resource resource, Access access);
+
+			// Bound for the duration of the pass, access is GL_READ_ONLY, GL_WRITE_ONLY or GL_READ_WRITE
+			void sample(Resource texture, gl::GLuint unit);
+			Resource image(Resource texture, gl::GLuint unit, gl::GLenum access, gl::GLenum format);
+			Resource storage(Resource buffer, gl::GLuint binding, gl::GLenum access);
+			Resource colorAttachment(Resource texture, gl::GLuint index);
+			Resource depthAttachment(Resource texture, gl::GLenum access);
+
+			// The pass is never culled, e.g. it reads back to the CPU or draws into the default framebuffer
+			void sideEffect();
+
+		private:
+			friend class RenderGraph;
+			Builder(RenderGraph& graph, std::size_t pass);
+
+			RenderGraph& m_graph;
+			std::size_t m_pass;
+		};
+
+		// Transient textures are taken from the pool during execute(), imported objects are owned by the caller
+		Resource createTexture(const std::string& name, gl::GLenum internalFormat, const glm::ivec2& size);
+		Resource importTexture(const std::string& name, globjects::Texture* texture);
+		Resource importBuffer(const std::string& name, globjects::Buffer* buffer);
+
+		// Keeps the passes that produce this version alive, imported resources keep their last version by default
+		void output(Resource resource);
+
+		void addPass(const std::string& name, const std::function<void(Builder&)>& setup, std::function<void()> execute);
+
+		// Runs the live passes in the order they were added and clears the graph for the next frame
+		void execute(RenderTargetPool& pool, GpuProfiler* profiler = nullptr);
+
+		// Only valid while the passes that use them are executed
+		globjects::Texture* texture(Resource resource) const;
+		globjects::Buffer* buffer(Resource resource) const;
+
+		// Of the last executed frame
+		const Statistics& statistics() const;
+
+	private:
+		enum class Binding
+		{
+			None,
+			TextureUnit,
+			ImageUnit,
+			StorageBuffer,
+			ColorAttachment,
+			DepthAttachment
+		};
+
+		struct Use
+		{
+			std::size_t resource = 0;
+			std::uint32_t readVersion = 0;
+			std::uint32_t writeVersion = 0;
+			bool read = false;
+			bool write = false;
+			Access access = Access::Sampled;
+			Binding binding = Binding::None;
+			gl::GLuint unit = 0;
+			gl::GLenum imageAccess = gl::GLenum(0);
+			gl::GLenum format = gl::GLenum(0);
+		};
+
+		struct Pass
+		{
+			std::string name;
+			std::function<void()> execute;
+			std::vector<Use> uses;
+			bool sideEffect = false;
+			bool alive = false;
+		};
+
+		struct Node
+		{
+			std::string name;
+			bool transient = false;
+			gl::GLenum internalFormat = gl::GLenum(0);
+			glm::ivec2 size = glm::ivec2(0);
+			globjects::Texture* texture = nullptr;
+			globjects::Buffer* buffer = nullptr;
+			std::uint32_t version = 0;
+			std::vector<bool> outputs;
+		};
+
+		// Incoherent writes that have not been made visible to every kind of access yet, kept across frames for imports
+		struct SyncState
+		{
+			bool pending = false;
+			gl::MemoryBarrierMask synced = gl::GL_NONE_BIT;
+		};
+
+		struct CachedFramebuffer
+		{
+			std::unique_ptr<globjects::Framebuffer> framebuffer;
+			std::vector<gl::GLenum> attachments;
+		};
+
+		Use& use(std::size_t pass, Resource resource, Access access);
+		void cull();
+		gl::MemoryBarrierMask barrierBit(const Node& node, Access access) const;
+		SyncState& syncState(const Node& node);
+		void bind(Pass& pass);
+		void unbind(const Pass& pass);
+
+		std::vector<Pass> m_passes;
+		std::vector<Node> m_nodes;
+		std::unordered_map<const void*, SyncState> m_importedSync;
+		std::vector<SyncState> m_transientSync;
+		std::unordered_map<std::string, CachedFramebuffer> m_framebuffers;
+		Statistics m_statistics;
+	};
+}
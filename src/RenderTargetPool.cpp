@@ -0,0 +1,134 @@
+#include "RenderTargetPool.h"
+
+#include <algorithm>
+
+#include <globjects/logging.h>
+
+using namespace dynamol;
+using namespace gl;
+using namespace glm;
+using namespace globjects;
+
+namespace
+{
+	struct PixelFormat
+	{
+		GLenum format;
+		GLenum type;
+		std::size_t bytes;
+	};
+
+	PixelFormat pixelFormat(GLenum internalFormat)
+	{
+		switch (internalFormat)
+		{
+		case GL_RGBA32F: return { GL_RGBA, GL_FLOAT, 16 };
+		case GL_RGBA32UI: return { GL_RGBA_INTEGER, GL_UNSIGNED_INT, 16 };
+		case GL_RGBA16F: return { GL_RGBA, GL_HALF_FLOAT, 8 };
+		case GL_RG32F: return { GL_RG, GL_FLOAT, 8 };
+		case GL_RG32UI: return { GL_RG_INTEGER, GL_UNSIGNED_INT, 8 };
+		case GL_RGBA8: return { GL_RGBA, GL_UNSIGNED_BYTE, 4 };
+		case GL_RGB10_A2: return { GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV, 4 };
+		case GL_RG16F: return { GL_RG, GL_HALF_FLOAT, 4 };
+		case GL_RG16: return { GL_RG, GL_UNSIGNED_SHORT, 4 };
+		case GL_R32F: return { GL_RED, GL_FLOAT, 4 };
+		case GL_R32UI: return { GL_RED_INTEGER, GL_UNSIGNED_INT, 4 };
+		case GL_R16F: return { GL_RED, GL_HALF_FLOAT, 2 };
+		case GL_R8: return { GL_RED, GL_UNSIGNED_BYTE, 1 };
+		// Unsized depth is stored with 24 bits padded to 32 by current drivers
+		case GL_DEPTH_COMPONENT:
+		case GL_DEPTH_COMPONENT24:
+		case GL_DEPTH_COMPONENT32F: return { GL_DEPTH_COMPONENT, GL_FLOAT, 4 };
+		case GL_DEPTH24_STENCIL8: return { GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, 4 };
+		default:
+			globjects::warning() << "Render target format " << internalFormat << " is not known to the pool, assuming 16 bytes per pixel";
+			return { GL_RGBA, GL_FLOAT, 16 };
+		}
+	}
+}
+
+void RenderTargetPool::beginFrame()
+{
+	m_last = m_current;
+	m_frame++;
+
+	m_targets.erase(std::remove_if(m_targets.begin(), m_targets.end(), [this](const Target& target) {
+		return !target.acquired && m_frame - target.lastFrame > UnusedFrames;
+	}), m_targets.end());
+
+	// Targets that are still acquired, e.g. histories kept from the previous frame, count towards this frame as well
+	m_current = Statistics();
+	m_current.peakBytes = m_usedBytes;
+
+	for (const auto& target : m_targets)
+		m_current.residentBytes += target.bytes;
+
+	m_current.textures = m_targets.size();
+}
+
+Texture* RenderTargetPool::acquire(GLenum internalFormat, const ivec2& size)
+{
+	auto it = std::find_if(m_targets.begin(), m_targets.end(), [&](const Target& target) {
+		return !target.acquired && target.internalFormat == internalFormat && target.size == size;
+	});
+
+	if (it == m_targets.end())
+	{
+		const PixelFormat format = pixelFormat(internalFormat);
+
+		Target target;
+		target.texture = Texture::create(GL_TEXTURE_2D);
+		target.texture->setParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		target.texture->setParameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		target.texture->setParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		target.texture->setParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		target.texture->image2D(0, internalFormat, size, 0, format.format, format.type, nullptr);
+		target.internalFormat = internalFormat;
+		target.size = size;
+		target.bytes = format.bytes * std::size_t(size.x) * std::size_t(size.y);
+
+		m_current.residentBytes += target.bytes;
+		m_current.textures++;
+
+		it = m_targets.insert(m_targets.end(), std::move(target));
+	}
+
+	it->acquired = true;
+	it->lastFrame = m_frame;
+
+	m_usedBytes += it->bytes;
+	m_current.peakBytes = std::max(m_current.peakBytes, m_usedBytes);
+	m_current.requestedBytes += it->bytes;
+	m_current.acquisitions++;
+
+	return it->texture.get();
+}
+
+void RenderTargetPool::release(Texture* texture)
+{
+	if (texture == nullptr)
+		return;
+
+	auto it = std::find_if(m_targets.begin(), m_targets.end(), [texture](const Target& target) {
+		return target.texture.get() == texture;
+	});
+
+	if (it == m_targets.end() || !it->acquired)
+	{
+		globjects::warning() << "Released render target " << texture->id() << " was not acquired from the pool";
+		return;
+	}
+
+	it->acquired = false;
+	m_usedBytes -= it->bytes;
+}
+
+const RenderTargetPool::Statistics& RenderTargetPool::statistics() const
+{
+	return m_last;
+}
+
+std::size_t RenderTargetPool::bytesPerPixel(GLenum internalFormat)
+{
+	return pixelFormat(internalFormat).bytes;
+}
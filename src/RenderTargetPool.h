@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glbinding/gl/gl.h>
+#include <globjects/Texture.h>
+
+namespace dynamol
+{
+	// Transient 2D render targets that are acquired for the passes that use them and released after their last use.
+	// A released texture is handed out again to a later acquisition with the same format and size, so targets whose
+	// lifetimes within a frame do not overlap share their memory. Contents are undefined after acquisition.
+	class RenderTargetPool
+	{
+	public:
+		struct Statistics
+		{
+			// All textures owned by the pool, whether in use or not
+			std::size_t residentBytes = 0;
+			std::size_t textures = 0;
+			// Largest amount in use at the same time during the frame
+			std::size_t peakBytes = 0;
+			// Sum of all acquisitions during the frame, i.e. what the targets would occupy without aliasing
+			std::size_t requestedBytes = 0;
+			std::size_t acquisitions = 0;
+		};
+
+		// Deletes textures that have not been acquired for UnusedFrames frames, e.g. after a resize
+		void beginFrame();
+
+		globjects::Texture* acquire(gl::GLenum internalFormat, const glm::ivec2& size);
+		// Releasing nullptr is ignored
+		void release(globjects::Texture* texture);
+
+		// Of the last completed frame
+		const Statistics& statistics() const;
+
+		static std::size_t bytesPerPixel(gl::GLenum internalFormat);
+
+	private:
+		static constexpr std::uint64_t UnusedFrames = 8;
+
+		struct Target
+		{
+			std::unique_ptr<globjects::Texture> texture;
+			gl::GLenum internalFormat = gl::GLenum(0);
+			glm::ivec2 size = glm::ivec2(0);
+			std::size_t bytes = 0;
+			bool acquired = false;
+			std::uint64_t lastFrame = 0;
+		};
+
+		std::vector<Target> m_targets;
+		std::uint64_t m_frame = 0;
+		std::size_t m_usedBytes = 0;
+		Statistics m_current;
+		Statistics m_last;
+	};
+}
@@ -1,8 +1,11 @@
 #include "Renderer.h"
+#include "ShaderCache.h"
+#include "ShaderCompiler.h"
 #include <globjects/base/File.h>
 #include <globjects/State.h>
 #include <iostream>
 #include <filesystem>
+#include <algorithm>
 
 
 using namespace dynamol;
@@ -41,6 +44,8 @@ void Renderer::reloadShaders()
 			globjects::debug() << "Reloading shader file " << f->filePath() << " ...";
 			f->reload();
 		}
+
+		linkShaderProgram(p.first, p.second);
 	}
 }
 
@@ -69,6 +74,10 @@ bool Renderer::createShaderProgram(const std::string& name, std::initializer_lis
 
 		auto file = Shader::sourceFromFile(i.second);
 		auto source = Shader::applyGlobalReplacements(file.get());
+
+		for (const auto& [included, replacement] : m_includeRedirects)
+			source->replace("\"" + included + "\"", "\"" + replacement + "\"");
+
 		auto shader = Shader::create(i.first, source.get());
 
 		program.m_program->attach(shader.get());
@@ -78,7 +87,8 @@ bool Renderer::createShaderProgram(const std::string& name, std::initializer_lis
 		program.m_shaders.insert(std::move(shader));
 	}
 
-	m_shaderPrograms[name] = std::move(program);
+	auto& shaderProgram = m_shaderPrograms[name] = std::move(program);
+	linkShaderProgram(name, shaderProgram);
 
 	return false;
 }
@@ -87,3 +97,103 @@ globjects::Program* Renderer::shaderProgram(const std::string& name)
 {
 	return m_shaderPrograms[name].m_program.get();
 }
+
+void Renderer::linkShaderProgram(const std::string& name, ShaderProgram& program)
+{
+	ShaderCache& cache = ShaderCache::instance();
+
+	std::vector<std::pair<GLenum, std::string>> sources;
+
+	for (const auto& shader : program.m_shaders)
+		sources.emplace_back(shader->type(), ShaderCache::expandIncludes(shader->source()->string()));
+
+	// The set of shaders is ordered by address, the key must not depend on it
+	std::sort(sources.begin(), sources.end());
+
+	const std::uint64_t key = cache.key(sources);
+	ShaderCache::Binary binary;
+
+	if (cache.find(key, binary))
+	{
+		program.m_binary = ProgramBinary::create(binary.format, binary.data);
+		program.m_program->setBinary(program.m_binary.get());
+		program.m_program->link();
+
+		if (program.m_program->isLinked())
+			return;
+
+		// Binaries may become invalid with driver updates even if the driver string stays the same
+		globjects::debug() << "Cached binary of shader program " << name << " was rejected, compiling ...";
+		cache.remove(key);
+	}
+
+	program.m_program->setBinary(nullptr);
+	program.m_binary = nullptr;
+
+	program.m_program->setParameter(GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	program.m_program->link();
+
+	if (!program.m_program->isLinked())
+		return;
+
+	const auto linkedBinary = program.m_program->getBinary();
+
+	if (!linkedBinary || linkedBinary->length() <= 0)
+		return;
+
+	const auto* data = static_cast<const unsigned char*>(linkedBinary->data());
+	cache.store(key, { linkedBinary->format(), std::vector<unsigned char>(data, data + linkedBinary->length()) });
+}
+
+bool Renderer::shaderProgramIncludes(const std::string& name, const std::string& namedString)
+{
+	const auto& shaders = m_shaderPrograms[name].m_shaders;
+
+	return std::any_of(shaders.begin(), shaders.end(), [&namedString](const auto& shader) {
+		return ShaderCache::includes(shader->source()->string(), namedString);
+	});
+}
+
+void Renderer::redirectInclude(const std::string& name, const std::string& replacement)
+{
+	m_includeRedirects.emplace_back(name, replacement);
+}
+
+bool Renderer::precompileShaderPrograms(const std::string& namedString, const std::string& string, bool urgent)
+{
+	ShaderCompiler& compiler = ShaderCompiler::instance();
+
+	if (!compiler.running())
+		return true;
+
+	ShaderCache& cache = ShaderCache::instance();
+	const ShaderCache::Replacements replacements = { { namedString, string } };
+	bool ready = true;
+
+	for (auto& [name, program] : m_shaderPrograms)
+	{
+		const bool dependent = std::any_of(program.m_shaders.begin(), program.m_shaders.end(), [&namedString](const auto& shader) {
+			return ShaderCache::includes(shader->source()->string(), namedString);
+		});
+
+		if (!dependent)
+			continue;
+
+		ShaderCompiler::Job job;
+		job.name = name;
+
+		for (const auto& shader : program.m_shaders)
+			job.sources.emplace_back(shader->type(), ShaderCache::expandIncludes(shader->source()->string(), replacements));
+
+		std::sort(job.sources.begin(), job.sources.end());
+		job.key = cache.key(job.sources);
+
+		if (cache.contains(job.key) || compiler.failed(job.key))
+			continue;
+
+		compiler.enqueue(std::move(job), urgent);
+		ready = false;
+	}
+
+	return ready;
+}
@@ -5,6 +5,8 @@
 #include <memory>
 #include <unordered_map>
 #include <set>
+#include <string>
+#include <vector>
 
 #include <glm/glm.hpp>
 #include <glbinding/gl/gl.h>
@@ -16,6 +18,7 @@
 #include <globjects/Buffer.h>
 #include <globjects/Program.h>
 #include <globjects/Shader.h>
+#include <globjects/ProgramBinary.h>
 #include <globjects/Framebuffer.h>
 #include <globjects/Renderbuffer.h>
 #include <globjects/Texture.h>
@@ -37,6 +40,8 @@ namespace dynamol
 			std::set< std::unique_ptr< globjects::NamedString> > m_strings;
 			std::set< std::unique_ptr< globjects::Shader > > m_shaders;
 			std::unique_ptr< globjects::Program > m_program = std::make_unique<globjects::Program>();
+			// Binary from the shader cache the program was linked from, if any
+			std::unique_ptr< globjects::ProgramBinary > m_binary;
 		};
 
 	public:
@@ -51,10 +56,27 @@ namespace dynamol
 		bool createShaderProgram(const std::string& name, std::initializer_list< std::pair<gl::GLenum, std::string> > shaders, std::initializer_list < std::string> shaderIncludes = {});
 		globjects::Program* shaderProgram(const std::string& name);
 
+		// Queues the programs that include the named string for compilation with the given string on the shader compiler thread.
+		// Returns true when switching the named string to it needs no compilation, i.e. all of them are in the shader cache
+		// (or failed in the background, so the synchronous compilation reports the errors), or if there is no compiler thread.
+		bool precompileShaderPrograms(const std::string& namedString, const std::string& string, bool urgent = false);
+
+		// Whether a shader of the program includes the named string, directly or through other includes
+		bool shaderProgramIncludes(const std::string& name, const std::string& namedString);
+
+	protected:
+		// Shader files shared between renderers include the named string replacement instead of name in the programs
+		// created afterwards, e.g. the defines of the renderer that uses them
+		void redirectInclude(const std::string& name, const std::string& replacement);
+
 	private:
+		// Links the program from the shader cache or compiles it and stores the result in the cache
+		void linkShaderProgram(const std::string& name, ShaderProgram& program);
+
 		Viewer* m_viewer;
 		bool m_enabled = true;
 		std::unordered_map<std::string, ShaderProgram > m_shaderPrograms;
+		std::vector<std::pair<std::string, std::string>> m_includeRedirects;
 
 	};
 
@@ -0,0 +1,273 @@
+#include "ShaderCache.h"
+
+#include <array>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include <glbinding/gl/functions.h>
+#include <globjects/NamedString.h>
+#include <globjects/logging.h>
+
+using namespace dynamol;
+using namespace gl;
+using namespace globjects;
+
+namespace
+{
+	constexpr std::uint32_t FileMagic = 0x43534d44; // "DMSC"
+
+	// FNV-1a, unlike std::hash the value is the same in every run
+	std::uint64_t hash(const std::string& text, std::uint64_t value = 0xcbf29ce484222325ull)
+	{
+		for (unsigned char c : text)
+		{
+			value ^= c;
+			value *= 0x100000001b3ull;
+		}
+
+		return value;
+	}
+
+	// Name of the named string of an #include "/name" line, empty for other lines. Only a directive that is the first
+	// token of the line counts, includes in // comments or /* */ blocks stay as they are. inComment carries an open
+	// block comment over to the next line.
+	std::string includeName(const std::string& line, bool& inComment)
+	{
+		std::string name;
+		bool firstToken = true;
+		std::size_t i = 0;
+
+		while (i < line.size())
+		{
+			if (inComment)
+			{
+				const auto end = line.find("*/", i);
+
+				if (end == std::string::npos)
+					break;
+
+				inComment = false;
+				i = end + 2;
+			}
+			else if (line.compare(i, 2, "//") == 0)
+			{
+				break;
+			}
+			else if (line.compare(i, 2, "/*") == 0)
+			{
+				inComment = true;
+				i += 2;
+			}
+			else if (std::isspace(static_cast<unsigned char>(line[i])))
+			{
+				i++;
+			}
+			else if (firstToken && line.compare(i, 8, "#include") == 0)
+			{
+				const auto begin = line.find('"', i + 8);
+				const auto end = begin == std::string::npos ? std::string::npos : line.find('"', begin + 1);
+
+				if (end == std::string::npos)
+					break;
+
+				name = line.substr(begin + 1, end - begin - 1);
+				firstToken = false;
+				i = end + 1;
+			}
+			else
+			{
+				firstToken = false;
+				i++;
+			}
+		}
+
+		return name;
+	}
+
+	std::string glString(GLenum name)
+	{
+		const GLubyte* string = glGetString(name);
+		return string ? reinterpret_cast<const char*>(string) : "";
+	}
+}
+
+ShaderCache& ShaderCache::instance()
+{
+	static ShaderCache cache;
+	return cache;
+}
+
+ShaderCache::ShaderCache(std::filesystem::path directory) : m_directory(std::move(directory))
+{
+}
+
+std::uint64_t ShaderCache::key(const std::vector<std::pair<GLenum, std::string>>& sources)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_driver.empty())
+		m_driver = glString(GL_VENDOR) + "\n" + glString(GL_RENDERER) + "\n" + glString(GL_VERSION);
+
+	std::uint64_t value = hash(m_driver);
+
+	for (const auto& [type, source] : sources)
+	{
+		value = hash(std::to_string(static_cast<unsigned int>(type)), value);
+		value = hash(source, value);
+	}
+
+	return value;
+}
+
+bool ShaderCache::find(std::uint64_t key, Binary& binary)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto it = m_binaries.find(key);
+
+	if (it != m_binaries.end())
+	{
+		binary = it->second;
+		return true;
+	}
+
+	std::ifstream file(path(key), std::ios::binary);
+
+	if (!file)
+		return false;
+
+	std::uint32_t magic = 0;
+	std::uint32_t format = 0;
+	std::uint64_t size = 0;
+	file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	file.read(reinterpret_cast<char*>(&format), sizeof(format));
+	file.read(reinterpret_cast<char*>(&size), sizeof(size));
+
+	if (!file || magic != FileMagic)
+		return false;
+
+	Binary loaded;
+	loaded.format = GLenum(format);
+	loaded.data.resize(std::size_t(size));
+	file.read(reinterpret_cast<char*>(loaded.data.data()), std::streamsize(size));
+
+	if (!file)
+		return false;
+
+	binary = loaded;
+	m_binaries[key] = std::move(loaded);
+	return true;
+}
+
+bool ShaderCache::contains(std::uint64_t key)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::error_code error;
+	return m_binaries.count(key) > 0 || std::filesystem::exists(path(key), error);
+}
+
+void ShaderCache::store(std::uint64_t key, Binary binary)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::error_code error;
+	std::filesystem::create_directories(m_directory, error);
+
+	std::ofstream file(path(key), std::ios::binary | std::ios::trunc);
+
+	if (file)
+	{
+		const std::uint32_t format = static_cast<std::uint32_t>(binary.format);
+		const std::uint64_t size = binary.data.size();
+		file.write(reinterpret_cast<const char*>(&FileMagic), sizeof(FileMagic));
+		file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+		file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+		file.write(reinterpret_cast<const char*>(binary.data.data()), std::streamsize(size));
+	}
+
+	if (!file)
+		globjects::warning() << "Could not write shader cache file " << path(key).string();
+
+	m_binaries[key] = std::move(binary);
+}
+
+void ShaderCache::remove(std::uint64_t key)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_binaries.erase(key);
+
+	std::error_code error;
+	std::filesystem::remove(path(key), error);
+}
+
+std::string ShaderCache::expandIncludes(const std::string& source, const Replacements& replacements)
+{
+	std::istringstream input(source);
+	std::ostringstream output;
+	std::string line;
+	bool inComment = false;
+
+	while (std::getline(input, line))
+	{
+		// Also keeps track of block comments on the lines that are dropped
+		const std::string name = includeName(line, inComment);
+
+		if (line.find("GL_ARB_shading_language_include") != std::string::npos)
+			continue;
+
+		if (name.empty())
+		{
+			output << line << "\n";
+			continue;
+		}
+
+		auto replacement = replacements.find(name);
+
+		if (replacement != replacements.end())
+		{
+			output << expandIncludes(replacement->second, replacements) << "\n";
+			continue;
+		}
+
+		const NamedString* namedString = NamedString::obtain(name);
+		output << (namedString ? expandIncludes(namedString->string(), replacements) : line) << "\n";
+	}
+
+	return output.str();
+}
+
+bool ShaderCache::includes(const std::string& source, const std::string& name)
+{
+	std::istringstream input(source);
+	std::string line;
+	bool inComment = false;
+
+	while (std::getline(input, line))
+	{
+		const std::string included = includeName(line, inComment);
+
+		if (included.empty())
+			continue;
+
+		if (included == name)
+			return true;
+
+		const NamedString* namedString = NamedString::obtain(included);
+
+		if (namedString && includes(namedString->string(), name))
+			return true;
+	}
+
+	return false;
+}
+
+std::filesystem::path ShaderCache::path(std::uint64_t key) const
+{
+	std::array<char, 17> name{};
+	std::snprintf(name.data(), name.size(), "%016llx", static_cast<unsigned long long>(key));
+	return m_directory / (std::string(name.data()) + ".bin");
+}
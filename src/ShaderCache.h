@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <glbinding/gl/gl.h>
+
+namespace dynamol
+{
+	// Linked program binaries (glGetProgramBinary) in memory and on disk, shared with the shader compiler thread.
+	// Programs are identified by a hash of their shader sources with all includes expanded, which covers the
+	// define permutation through the /defines string, and of the driver, whose binaries are not portable.
+	class ShaderCache
+	{
+	public:
+		struct Binary
+		{
+			gl::GLenum format = gl::GLenum(0);
+			std::vector<unsigned char> data;
+		};
+
+		static ShaderCache& instance();
+
+		explicit ShaderCache(std::filesystem::path directory = "./cache/shaders");
+
+		using Replacements = std::unordered_map<std::string, std::string>;
+
+		// Requires a current context for the driver string, sources are pairs of shader type and expanded source text
+		std::uint64_t key(const std::vector<std::pair<gl::GLenum, std::string>>& sources);
+
+		// Looks in memory first and then on disk
+		bool find(std::uint64_t key, Binary& binary);
+		bool contains(std::uint64_t key);
+		void store(std::uint64_t key, Binary binary);
+
+		// For binaries the driver rejected
+		void remove(std::uint64_t key);
+
+		// Replaces every #include "/name" by the current string of that named string, or by its replacement if there is one.
+		// The include extension is removed, so the result compiles without it.
+		static std::string expandIncludes(const std::string& source, const Replacements& replacements = {});
+
+		// Whether the source includes the named string, directly or through other includes
+		static bool includes(const std::string& source, const std::string& name);
+
+	private:
+		std::filesystem::path path(std::uint64_t key) const;
+
+		std::filesystem::path m_directory;
+		std::string m_driver;
+		std::unordered_map<std::uint64_t, Binary> m_binaries;
+		std::mutex m_mutex;
+	};
+}
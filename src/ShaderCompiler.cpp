@@ -0,0 +1,211 @@
+#include "ShaderCompiler.h"
+#include "ShaderCache.h"
+
+#include <algorithm>
+
+#include <glbinding/glbinding.h>
+#include <glbinding/gl/functions.h>
+#include <glbinding/gl/enum.h>
+#include <globjects/logging.h>
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+using namespace dynamol;
+using namespace gl;
+
+ShaderCompiler& ShaderCompiler::instance()
+{
+	static ShaderCompiler compiler;
+	return compiler;
+}
+
+ShaderCompiler::~ShaderCompiler()
+{
+	stop();
+}
+
+bool ShaderCompiler::start(GLFWwindow* sharedWindow)
+{
+	if (running())
+		return true;
+
+	// Same context hints as the main window, which are still set
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	m_window = glfwCreateWindow(1, 1, "dynamol shader compiler", nullptr, sharedWindow);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+
+	if (m_window == nullptr)
+	{
+		globjects::warning() << "Could not create the shader compiler context, shaders are compiled on demand";
+		return false;
+	}
+
+	m_stop = false;
+	m_thread = std::thread(&ShaderCompiler::work, this);
+	return true;
+}
+
+void ShaderCompiler::stop()
+{
+	if (!running())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+		m_jobs.clear();
+		m_pending.clear();
+	}
+
+	m_wake.notify_all();
+	m_thread.join();
+
+	glfwDestroyWindow(m_window);
+	m_window = nullptr;
+}
+
+bool ShaderCompiler::running() const
+{
+	return m_thread.joinable();
+}
+
+void ShaderCompiler::enqueue(Job job, bool urgent)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (m_pending.count(job.key) > 0 || m_failed.count(job.key) > 0)
+		{
+			// Move an already queued job to the front
+			auto queued = std::find_if(m_jobs.begin(), m_jobs.end(), [&job](const Job& other) { return other.key == job.key; });
+
+			if (urgent && queued != m_jobs.end())
+			{
+				Job moved = std::move(*queued);
+				m_jobs.erase(queued);
+				m_jobs.push_front(std::move(moved));
+			}
+
+			return;
+		}
+
+		m_pending.insert(job.key);
+
+		if (urgent)
+			m_jobs.push_front(std::move(job));
+		else
+			m_jobs.push_back(std::move(job));
+	}
+
+	m_wake.notify_one();
+}
+
+bool ShaderCompiler::pending(std::uint64_t key)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_pending.count(key) > 0;
+}
+
+bool ShaderCompiler::failed(std::uint64_t key)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_failed.count(key) > 0;
+}
+
+void ShaderCompiler::work()
+{
+	glfwMakeContextCurrent(m_window);
+
+	// glbinding keeps its function pointers per context and thread
+	glbinding::initialize([](const char* name) {
+		return glfwGetProcAddress(name);
+	}, false);
+
+	while (true)
+	{
+		Job job;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+
+			if (m_stop)
+				break;
+
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+		}
+
+		// Another program or an earlier run may have produced the same binary in the meantime
+		const bool compiled = ShaderCache::instance().contains(job.key) || compile(job);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_pending.erase(job.key);
+
+			if (!compiled)
+				m_failed.insert(job.key);
+		}
+	}
+
+	glbinding::releaseCurrentContext();
+	glfwMakeContextCurrent(nullptr);
+}
+
+bool ShaderCompiler::compile(const Job& job)
+{
+	const GLuint program = glCreateProgram();
+	std::vector<GLuint> shaders;
+	bool compiled = true;
+
+	for (const auto& [type, source] : job.sources)
+	{
+		const GLuint shader = glCreateShader(type);
+		const char* sourceString = source.c_str();
+		glShaderSource(shader, 1, &sourceString, nullptr);
+		glCompileShader(shader);
+
+		GLint status = 0;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+		compiled = compiled && status != 0;
+
+		glAttachShader(program, shader);
+		shaders.push_back(shader);
+	}
+
+	GLint linked = 0;
+
+	if (compiled)
+	{
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GLint(GL_TRUE));
+		glLinkProgram(program);
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	}
+
+	if (linked != 0)
+	{
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+
+		ShaderCache::Binary binary;
+		binary.data.resize(std::size_t(std::max(length, 0)));
+		glGetProgramBinary(program, length, nullptr, &binary.format, binary.data.data());
+
+		if (!binary.data.empty())
+			ShaderCache::instance().store(job.key, std::move(binary));
+	}
+
+	for (GLuint shader : shaders)
+	{
+		glDetachShader(program, shader);
+		glDeleteShader(shader);
+	}
+
+	glDeleteProgram(program);
+
+	if (linked == 0)
+		globjects::debug() << "Background compilation of shader program " << job.name << " failed";
+
+	return linked != 0;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <glbinding/gl/gl.h>
+
+struct GLFWwindow;
+
+namespace dynamol
+{
+	// Worker thread with a hidden context that shares objects with the main window. It compiles programs ahead
+	// of time and puts their binaries into the ShaderCache, so that switching to them later only loads a binary.
+	class ShaderCompiler
+	{
+	public:
+		struct Job
+		{
+			std::uint64_t key = 0;
+			std::string name;
+			std::vector<std::pair<gl::GLenum, std::string>> sources; // with all includes expanded
+		};
+
+		static ShaderCompiler& instance();
+
+		~ShaderCompiler();
+
+		// Creates the hidden context and starts the thread, must be called on the main thread with its context current
+		bool start(GLFWwindow* sharedWindow);
+		void stop();
+		bool running() const;
+
+		// Urgent jobs are compiled before the ones queued ahead of time, jobs that are already queued are ignored
+		void enqueue(Job job, bool urgent = false);
+
+		// Whether the program is queued or being compiled
+		bool pending(std::uint64_t key);
+
+		// Whether compiling or linking the program failed, the error is then reported by the synchronous compilation
+		bool failed(std::uint64_t key);
+
+	private:
+		void work();
+		bool compile(const Job& job);
+
+		GLFWwindow* m_window = nullptr;
+		std::thread m_thread;
+		std::mutex m_mutex;
+		std::condition_variable m_wake;
+		std::deque<Job> m_jobs;
+		std::unordered_set<std::uint64_t> m_pending;
+		std::unordered_set<std::uint64_t> m_failed;
+		bool m_stop = false;
+	};
+}
@@ -1,6 +1,7 @@
 #include "SphereRenderer.h"
 #include <globjects/base/File.h>
 #include <globjects/State.h>
+#include <globjects/logging.h>
 #include <iostream>
 #include <filesystem>
 #include <imgui.h>
@@ -9,6 +10,7 @@
 #include "Protein.h"
 #include <sstream>
 #include <array>
+#include <cstdint>
 #include <tuple>
 #include <utility>
 #include <functional>
@@ -25,6 +27,11 @@
 #include <stb_image.h>
 
 #include "zip.h"
+#include "GaussianDensity.h"
+#include "SurfaceMesher.h"
+#include "DensityVolume.h"
+#include "ThreadPool.h"
+#include <tinyfiledialogs.h>
 
 using namespace dynamol;
 using namespace gl;
@@ -129,10 +136,6 @@ SphereRenderer::SphereRenderer(Viewer* viewer) : Renderer(viewer), gridSize{2},
 	m_residueColors->setStorage(viewer->scene()->protein()->activeResidueColorsPacked(), gl::GL_NONE_BIT);
 	m_chainColors->setStorage(viewer->scene()->protein()->activeChainColorsPacked(), gl::GL_NONE_BIT);
 
-	// Note: 1024 * 1024 * 128 seems like a very arbitrary number
-	for (auto& ptr : m_intersectionBuffer) ptr->setStorage(sizeof(vec3) * 1024 * 1024 * 128, nullptr, gl::GL_NONE_BIT);
-	for (auto& ptr : m_intersectionCount) ptr->setStorage(sizeof(uint), gl::GL_NONE_BIT);
-
 	m_verticesQuad->setStorage(std::array<vec3, 1>({ vec3(0.0f, 0.0f, 0.0f) }), gl::GL_NONE_BIT);
 	auto vertexBindingQuad = m_vaoQuad->binding(0);
 	vertexBindingQuad->setBuffer(m_verticesQuad.get(), 0, sizeof(vec3));
@@ -142,6 +145,8 @@ SphereRenderer::SphereRenderer(Viewer* viewer) : Renderer(viewer), gridSize{2},
 
 	m_shaderSourceDefines = StaticStringSource::create("");
 	m_shaderDefines = NamedString::create("/defines", m_shaderSourceDefines.get());
+	// sphere-vs.glsl and shade-fs.glsl are shared with ImageDepthScaleRenderer, which owns /defines.glsl
+	redirectInclude("/defines.glsl", "/defines");
 
 	createShaderProgram("sphere", {
 			{ GL_VERTEX_SHADER,"./res/sphere/sphere-vs.glsl" },
@@ -171,19 +176,68 @@ SphereRenderer::SphereRenderer(Viewer* viewer) : Renderer(viewer), gridSize{2},
 		},
 		{ "./res/sphere/globals.glsl" });
 
+	createShaderProgram("scan-local", {
+		{ GL_COMPUTE_SHADER,"./res/sphere/scan-local-cs.glsl" }
+		});
+
+	createShaderProgram("scan-add", {
+		{ GL_COMPUTE_SHADER,"./res/sphere/scan-add-cs.glsl" }
+		});
+
+	createShaderProgram("tile-footprint", {
+		{ GL_COMPUTE_SHADER,"./res/sphere/tile-footprint-cs.glsl" }
+		});
+
+	createShaderProgram("hiz", {
+		{ GL_COMPUTE_SHADER,"./res/sphere/hiz-cs.glsl" }
+		});
+
+	createShaderProgram("occlusion-cull", {
+		{ GL_COMPUTE_SHADER,"./res/sphere/occlusion-cull-cs.glsl" }
+		});
+
+	createShaderProgram("cluster-lod", {
+		{ GL_COMPUTE_SHADER,"./res/sphere/cluster-lod-cs.glsl" }
+		});
+
+	createShaderProgram("tile-fill", {
+		{ GL_COMPUTE_SHADER,"./res/sphere/tile-fill-cs.glsl" }
+		});
+
+	createShaderProgram("tile-list", {
+		{ GL_COMPUTE_SHADER,"./res/sphere/tile-list-cs.glsl" }
+		});
+
 	createShaderProgram("surface", {
 			{ GL_VERTEX_SHADER,"./res/sphere/image-vs.glsl" },
 			{ GL_GEOMETRY_SHADER,"./res/sphere/image-gs.glsl" },
 			{ GL_FRAGMENT_SHADER,"./res/sphere/surface-fs.glsl" },
 		},
-		{ "./res/sphere/globals.glsl" });
+		{ "./res/sphere/globals.glsl", "./res/sphere/gbuffer.glsl", "./res/sphere/temporal.glsl" });
+
+	createShaderProgram("surface-tile", {
+		{ GL_COMPUTE_SHADER,"./res/sphere/surface-tile-cs.glsl" }
+		});
+
+	createShaderProgram("surface-depth", {
+			{ GL_VERTEX_SHADER,"./res/sphere/image-vs.glsl" },
+			{ GL_GEOMETRY_SHADER,"./res/sphere/image-gs.glsl" },
+			{ GL_FRAGMENT_SHADER,"./res/sphere/surface-depth-fs.glsl" },
+		});
 
 	createShaderProgram("aosample", {
 			{ GL_VERTEX_SHADER,"./res/sphere/image-vs.glsl" },
 			{ GL_GEOMETRY_SHADER,"./res/sphere/image-gs.glsl" },
 			{ GL_FRAGMENT_SHADER,"./res/sphere/aosample-fs.glsl" },
 		},
-		{ "./res/sphere/globals.glsl" });
+		{ "./res/sphere/globals.glsl", "./res/sphere/temporal.glsl" });
+
+	createShaderProgram("aotemporal", {
+			{ GL_VERTEX_SHADER,"./res/sphere/image-vs.glsl" },
+			{ GL_GEOMETRY_SHADER,"./res/sphere/image-gs.glsl" },
+			{ GL_FRAGMENT_SHADER,"./res/sphere/aotemporal-fs.glsl" },
+		},
+		{ "./res/sphere/globals.glsl", "./res/sphere/temporal.glsl" });
 
 	createShaderProgram("aoblur", {
 			{ GL_VERTEX_SHADER,"./res/sphere/image-vs.glsl" },
@@ -192,12 +246,19 @@ SphereRenderer::SphereRenderer(Viewer* viewer) : Renderer(viewer), gridSize{2},
 		},
 		{ "./res/sphere/globals.glsl" });
 
+	createShaderProgram("aoupsample", {
+			{ GL_VERTEX_SHADER,"./res/sphere/image-vs.glsl" },
+			{ GL_GEOMETRY_SHADER,"./res/sphere/image-gs.glsl" },
+			{ GL_FRAGMENT_SHADER,"./res/sphere/aoupsample-fs.glsl" },
+		},
+		{ "./res/sphere/globals.glsl" });
+
 	createShaderProgram("shade", {
 			{ GL_VERTEX_SHADER,"./res/sphere/image-vs.glsl" },
 			{ GL_GEOMETRY_SHADER,"./res/sphere/image-gs.glsl" },
 			{ GL_FRAGMENT_SHADER,"./res/sphere/shade-fs.glsl" },
 		},
-		{ "./res/sphere/globals.glsl" });
+		{ "./res/sphere/globals.glsl", "./res/sphere/gbuffer.glsl" });
 
 	createShaderProgram("dofblur", {
 			{ GL_VERTEX_SHADER,"./res/sphere/image-vs.glsl" },
@@ -261,140 +322,22 @@ SphereRenderer::SphereRenderer(Viewer* viewer) : Renderer(viewer), gridSize{2},
 
 	m_framebufferSize = viewer->viewportSize();
 
-	m_depthTexture = Texture::create(GL_TEXTURE_2D);
-	m_depthTexture->setParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	m_depthTexture->setParameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	m_depthTexture->setParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	m_depthTexture->setParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	m_depthTexture->image2D(0, GL_DEPTH_COMPONENT, m_framebufferSize, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_BYTE, nullptr);
-
-	m_LOD0depthTexture = Texture::create(GL_TEXTURE_2D);
-	m_LOD0depthTexture->setParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	m_LOD0depthTexture->setParameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	m_LOD0depthTexture->setParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	m_LOD0depthTexture->setParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	m_LOD0depthTexture->image2D(0, GL_DEPTH_COMPONENT, m_framebufferSize, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_BYTE, nullptr);
-
-	m_LOD1depthTexture = Texture::create(GL_TEXTURE_2D);
-	m_LOD1depthTexture->setParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	m_LOD1depthTexture->setParameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	m_LOD1depthTexture->setParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	m_LOD1depthTexture->setParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	m_LOD1depthTexture->image2D(0, GL_DEPTH_COMPONENT, m_framebufferSize, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_BYTE, nullptr);
-
-	m_depthStencilTexture = Texture::create(GL_TEXTURE_2D);
-	m_depthStencilTexture->setParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	m_depthStencilTexture->setParameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	m_depthStencilTexture->setParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	m_depthStencilTexture->setParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	m_depthStencilTexture->image2D(0, GL_DEPTH24_STENCIL8, m_framebufferSize, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, nullptr);
-
-	// Position textures:
-	m_spherePositionTexture = Texture::create(GL_TEXTURE_2D);
-	m_spherePositionTextureNear = Texture::create(GL_TEXTURE_2D);
-	m_sphereLOD0PositionTexture = Texture::create(GL_TEXTURE_2D);
-	m_sphereLOD0PositionTextureNear = Texture::create(GL_TEXTURE_2D);
-	m_sphereLOD1PositionTexture = Texture::create(GL_TEXTURE_2D);
-	m_sphereLOD1PositionTextureNear = Texture::create(GL_TEXTURE_2D);
-
-	for (auto tex : {
-		m_spherePositionTexture.get(),
-		m_spherePositionTextureNear.get(),
-		m_sphereLOD0PositionTexture.get(),
-		m_sphereLOD0PositionTextureNear.get(),
-		m_sphereLOD1PositionTexture.get(),
-		m_sphereLOD1PositionTextureNear.get()
-	}) {
-		tex->setParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		tex->setParameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		tex->setParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		tex->setParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		tex->image2D(0, GL_RGBA32F, m_framebufferSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-	}
+	const GLsizeiptr pixelListSize = sizeof(uint) * (GLsizeiptr(m_framebufferSize.x) * m_framebufferSize.y + 1);
+	m_pixelCounts = Buffer::create();
+	m_pixelCounts->setStorage(pixelListSize, nullptr, gl::GL_NONE_BIT);
+	m_pixelOffsets = Buffer::create();
+	m_pixelOffsets->setStorage(pixelListSize, nullptr, gl::GL_NONE_BIT);
 
-	m_sphereNormalTexture = Texture::create(GL_TEXTURE_2D);
-	m_sphereNormalTexture->setParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	m_sphereNormalTexture->setParameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	m_sphereNormalTexture->setParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	m_sphereNormalTexture->setParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	m_sphereNormalTexture->image2D(0, GL_RGBA32F, m_framebufferSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-
-	// Normals textures:
-	m_sphereLOD0NormalTexture = Texture::create(GL_TEXTURE_2D);
-	m_sphereLOD1NormalTexture = Texture::create(GL_TEXTURE_2D);
-	m_sphereLOD0NormalTextureNear = Texture::create(GL_TEXTURE_2D);
-	m_sphereLOD1NormalTextureNear = Texture::create(GL_TEXTURE_2D);
-	for (auto tex : {
-		m_sphereLOD0NormalTexture.get(),
-		m_sphereLOD1NormalTexture.get(),
-		m_sphereLOD0NormalTextureNear.get(),
-		m_sphereLOD1NormalTextureNear.get()
-	}) {
-		tex->setParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		tex->setParameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		tex->setParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		tex->setParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		tex->image2D(0, GL_RGBA32F, m_framebufferSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-	}
+	const ivec2 tileCount = (m_framebufferSize + ivec2(ListTileSize - 1)) / ListTileSize;
+	const GLsizeiptr tileListSize = sizeof(uint) * (GLsizeiptr(tileCount.x) * tileCount.y + 1);
+	m_tileCounts = Buffer::create();
+	m_tileCounts->setStorage(tileListSize, nullptr, gl::GL_NONE_BIT);
+	m_tileOffsets = Buffer::create();
+	m_tileOffsets->setStorage(tileListSize, nullptr, gl::GL_NONE_BIT);
 
-	m_surfacePositionTexture = Texture::create(GL_TEXTURE_2D);
-	m_surfacePositionTexture->setParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	m_surfacePositionTexture->setParameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	m_surfacePositionTexture->setParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	m_surfacePositionTexture->setParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	m_surfacePositionTexture->image2D(0, GL_RGBA32F, m_framebufferSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-
-	m_surfaceNormalTexture = Texture::create(GL_TEXTURE_2D);
-	m_surfaceNormalTexture->setParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	m_surfaceNormalTexture->setParameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	m_surfaceNormalTexture->setParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	m_surfaceNormalTexture->setParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	m_surfaceNormalTexture->image2D(0, GL_RGBA32F, m_framebufferSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-
-	m_sphereDiffuseTexture = Texture::create(GL_TEXTURE_2D);
-	m_sphereDiffuseTexture->setParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	m_sphereDiffuseTexture->setParameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	m_sphereDiffuseTexture->setParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	m_sphereDiffuseTexture->setParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	m_sphereDiffuseTexture->image2D(0, GL_RGBA32F, m_framebufferSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-
-	m_surfaceDiffuseTexture = Texture::create(GL_TEXTURE_2D);
-	m_surfaceDiffuseTexture->setParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	m_surfaceDiffuseTexture->setParameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	m_surfaceDiffuseTexture->setParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	m_surfaceDiffuseTexture->setParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	m_surfaceDiffuseTexture->image2D(0, GL_RGBA32F, m_framebufferSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-
-	m_ambientTexture = Texture::create(GL_TEXTURE_2D);
-	m_ambientTexture->setParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	m_ambientTexture->setParameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	m_ambientTexture->setParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	m_ambientTexture->setParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	m_ambientTexture->image2D(0, GL_RGBA32F, m_framebufferSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-
-	m_blurTexture = Texture::create(GL_TEXTURE_2D);
-	m_blurTexture->setParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	m_blurTexture->setParameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	m_blurTexture->setParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	m_blurTexture->setParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	m_blurTexture->image2D(0, GL_RGBA32F, m_framebufferSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-
-	m_colorTexture = Texture::create(GL_TEXTURE_2D);
-	m_colorTexture->setParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	m_colorTexture->setParameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	m_colorTexture->setParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	m_colorTexture->setParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	m_colorTexture->image2D(0, GL_RGBA32F, m_framebufferSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-
-	for (auto& tex : m_offsetTexture) {
-		tex = Texture::create(GL_TEXTURE_3D);
-		tex->setParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		tex->setParameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		tex->setParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		tex->setParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		tex->setParameter(GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-		tex->image3D(0, GL_R32UI, glm::ivec3{m_framebufferSize, m_offsetBucketSize}, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, nullptr);
-	}
+	m_cullCommands->setStorage(DrawCommandSize * 2, nullptr, gl::GL_DYNAMIC_STORAGE_BIT);
+	m_cullReadback->setStorage(DrawCommandSize * 2, nullptr, gl::GL_MAP_READ_BIT | gl::GL_MAP_PERSISTENT_BIT | gl::GL_MAP_COHERENT_BIT);
+	m_cullReadbackData = static_cast<const GLuint*>(m_cullReadback->mapRange(0, DrawCommandSize * 2, gl::GL_MAP_READ_BIT | gl::GL_MAP_PERSISTENT_BIT | gl::GL_MAP_COHERENT_BIT));
 
 	m_shadowColorTexture = Texture::create(GL_TEXTURE_2D);
 	m_shadowColorTexture->setParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -453,56 +396,10 @@ SphereRenderer::SphereRenderer(Viewer* viewer) : Renderer(viewer), gridSize{2},
 			m_bumpTextures.push_back(std::move(texture));
 	}
 
-	m_sphereFramebuffer = Framebuffer::create();
-	m_sphereFramebuffer->attachTexture(GL_COLOR_ATTACHMENT0, m_spherePositionTexture.get());
-	m_sphereFramebuffer->attachTexture(GL_COLOR_ATTACHMENT1, m_sphereNormalTexture.get());
-	m_sphereFramebuffer->attachTexture(GL_COLOR_ATTACHMENT2, m_spherePositionTextureNear.get());
-	m_sphereFramebuffer->attachTexture(GL_DEPTH_ATTACHMENT, m_depthTexture.get());
-	m_sphereFramebuffer->setDrawBuffers({ GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 });
-
-	for (auto [fb, sphereTex, normalTex, depthTex] : zip(
-		std::to_array({m_sphereLOD0Framebuffer.get(), m_sphereLOD1Framebuffer.get(), m_sphereLOD0FramebufferNear.get(), m_sphereLOD1FramebufferNear.get()}),
-		std::to_array({m_sphereLOD0PositionTexture.get(), m_sphereLOD1PositionTexture.get(), m_sphereLOD0PositionTextureNear.get(), m_sphereLOD1PositionTextureNear.get()}),
-		std::to_array({m_sphereLOD0NormalTexture.get(), m_sphereLOD1NormalTexture.get(), m_sphereLOD0NormalTextureNear.get(), m_sphereLOD1NormalTextureNear.get()}),
-		std::to_array({m_LOD0depthTexture.get(), m_LOD1depthTexture.get(), m_LOD0depthTexture.get(), m_LOD1depthTexture.get()})
-		)) {
-		fb->attachTexture(GL_COLOR_ATTACHMENT0, sphereTex);
-		fb->attachTexture(GL_COLOR_ATTACHMENT1, normalTex);
-		fb->attachTexture(GL_DEPTH_ATTACHMENT, depthTex);
-		fb->setDrawBuffers({ GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 });
-	}
+	// The final image is attached for every frame, when it has been acquired from the pool
+	m_displayFramebuffer = Framebuffer::create();
+	m_displayFramebuffer->setDrawBuffers({ GL_COLOR_ATTACHMENT0 });
 
-	m_surfaceFramebuffer = Framebuffer::create();
-	m_surfaceFramebuffer->attachTexture(GL_COLOR_ATTACHMENT0, m_surfacePositionTexture.get());
-	m_surfaceFramebuffer->attachTexture(GL_COLOR_ATTACHMENT1, m_surfaceNormalTexture.get());
-	m_surfaceFramebuffer->attachTexture(GL_COLOR_ATTACHMENT2, m_surfaceDiffuseTexture.get());
-	m_surfaceFramebuffer->attachTexture(GL_COLOR_ATTACHMENT3, m_sphereDiffuseTexture.get());
-	m_surfaceFramebuffer->attachTexture(GL_DEPTH_ATTACHMENT, m_depthTexture.get());
-	m_surfaceFramebuffer->setDrawBuffers({ GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3 });
-
-	m_shadeFramebuffer = Framebuffer::create();
-	m_shadeFramebuffer->attachTexture(GL_COLOR_ATTACHMENT0, m_colorTexture.get());
-	m_shadeFramebuffer->setDrawBuffers({ GL_COLOR_ATTACHMENT0 });
-	m_shadeFramebuffer->attachTexture(GL_DEPTH_ATTACHMENT, m_depthTexture.get());
-
-	m_aoBlurFramebuffer = Framebuffer::create();
-	m_aoBlurFramebuffer->attachTexture(GL_COLOR_ATTACHMENT0, m_blurTexture.get());
-	m_aoBlurFramebuffer->setDrawBuffers({ GL_COLOR_ATTACHMENT0 });
-
-	m_aoFramebuffer = Framebuffer::create();
-	m_aoFramebuffer->attachTexture(GL_COLOR_ATTACHMENT0, m_ambientTexture.get());
-	m_aoFramebuffer->setDrawBuffers({ GL_COLOR_ATTACHMENT0 });
-
-	m_dofBlurFramebuffer = Framebuffer::create();
-	m_dofBlurFramebuffer->attachTexture(GL_COLOR_ATTACHMENT0, m_sphereNormalTexture.get());
-	m_dofBlurFramebuffer->attachTexture(GL_COLOR_ATTACHMENT1, m_surfaceNormalTexture.get());
-	m_dofBlurFramebuffer->setDrawBuffers({ GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 });
-
-	m_dofFramebuffer = Framebuffer::create();
-	m_dofFramebuffer->attachTexture(GL_COLOR_ATTACHMENT0, m_sphereDiffuseTexture.get());
-	m_dofFramebuffer->attachTexture(GL_COLOR_ATTACHMENT1, m_surfaceDiffuseTexture.get());
-	m_dofFramebuffer->setDrawBuffers({ GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 });
-	
 	m_shadowFramebuffer = Framebuffer::create();
 	m_shadowFramebuffer->attachTexture(GL_COLOR_ATTACHMENT0, m_shadowColorTexture.get());
 	m_shadowFramebuffer->attachTexture(GL_DEPTH_ATTACHMENT, m_shadowDepthTexture.get());
@@ -537,6 +434,12 @@ SphereRenderer::SphereRenderer(Viewer* viewer) : Renderer(viewer), gridSize{2},
 	vertexBinding->setBuffer(m_hiarchyVertices.get(), 2 * sizeof(glm::vec4), sizeof(Protein::HierchicalPoints));
 	vertexBinding->setFormat(1, GL_FLOAT);
 	m_vao->enable(2);
+	// Next timestep for INTERPOLATION, without a trajectory the position itself
+	vertexBinding = m_vao->binding(3);
+	vertexBinding->setAttribute(3);
+	vertexBinding->setBuffer(m_hiarchyVertices.get(), 0, sizeof(Protein::HierchicalPoints));
+	vertexBinding->setFormat(4, GL_FLOAT);
+	m_vao->enable(3);
 
 	m_denseAtomVertices = Buffer::create();
 	m_denseAtomVertices->setStorage(viewer->scene()->protein()->m_genAtomsDense, gl::GL_NONE_BIT);
@@ -557,6 +460,11 @@ SphereRenderer::SphereRenderer(Viewer* viewer) : Renderer(viewer), gridSize{2},
 	vertexBinding->setBuffer(m_denseAtomVertices.get(), 2 * sizeof(glm::vec4), sizeof(Protein::HierchicalPoints));
 	vertexBinding->setFormat(1, GL_FLOAT);
 	m_denseVAO->enable(2);
+	vertexBinding = m_denseVAO->binding(3);
+	vertexBinding->setAttribute(3);
+	vertexBinding->setBuffer(m_denseAtomVertices.get(), 0, sizeof(Protein::HierchicalPoints));
+	vertexBinding->setFormat(4, GL_FLOAT);
+	m_denseVAO->enable(3);
 
 	// Sparse points:
 	m_sparseAtomVertices = Buffer::create();
@@ -579,6 +487,33 @@ SphereRenderer::SphereRenderer(Viewer* viewer) : Renderer(viewer), gridSize{2},
 	vertexBinding->setBuffer(m_sparseAtomVertices.get(), 2 * sizeof(glm::vec4), sizeof(Protein::HierchicalPoints));
 	vertexBinding->setFormat(1, GL_FLOAT);
 	m_sparseVAO->enable(2);
+	vertexBinding = m_sparseVAO->binding(3);
+	vertexBinding->setAttribute(3);
+	vertexBinding->setBuffer(m_sparseAtomVertices.get(), 0, sizeof(Protein::HierchicalPoints));
+	vertexBinding->setFormat(4, GL_FLOAT);
+	m_sparseVAO->enable(3);
+
+	// Clusters of the per-cluster level of detail, one per sparse point with the atoms and dense points that belong to it
+	const std::size_t atomCount = viewer->scene()->protein()->m_hierarchyPoints.size();
+	m_clusterCount = GLuint((atomCount + Protein::SparseClusterSize - 1) / Protein::SparseClusterSize);
+	const GLuint clusterStorage = std::max(m_clusterCount, 1u);
+
+	m_clusterCommands->setStorage(GLsizeiptr(ArraysCommandSize) * 3 * clusterStorage, nullptr, gl::GL_NONE_BIT);
+	m_clusterWeights->setStorage(GLsizeiptr(sizeof(vec4)) * clusterStorage, nullptr, gl::GL_NONE_BIT);
+	m_clusterLevels->setStorage(sizeof(GLuint) * 3, nullptr, gl::GL_NONE_BIT);
+	m_clusterReadback->setStorage(sizeof(GLuint) * 3, nullptr, gl::GL_MAP_READ_BIT | gl::GL_MAP_PERSISTENT_BIT | gl::GL_MAP_COHERENT_BIT);
+	m_clusterReadbackData = static_cast<const GLuint*>(m_clusterReadback->mapRange(0, sizeof(GLuint) * 3, gl::GL_MAP_READ_BIT | gl::GL_MAP_PERSISTENT_BIT | gl::GL_MAP_COHERENT_BIT));
+
+	// Level weights for CLUSTER_LOD, one per instance, the draws of a cluster use it as their base instance
+	for (auto* vao : { m_sparseVAO.get(), m_vao.get(), m_denseVAO.get() })
+	{
+		vertexBinding = vao->binding(4);
+		vertexBinding->setAttribute(4);
+		vertexBinding->setBuffer(m_clusterWeights.get(), 0, sizeof(vec4));
+		vertexBinding->setFormat(4, GL_FLOAT);
+		vertexBinding->setDivisor(1);
+		vao->enable(4);
+	}
 
 	// Triangle (xyz, rgb, uv):
 	const auto verts = std::to_array<GLfloat>({
@@ -640,6 +575,16 @@ SphereRenderer::SphereRenderer(Viewer* viewer) : Renderer(viewer), gridSize{2},
 	m_initialGridPoints = Buffer::create();
 }
 
+glm::uint SphereRenderer::currentTimestep() const
+{
+	return m_currentTimestep;
+}
+
+float SphereRenderer::atomRadius() const
+{
+	return m_atomRadius;
+}
+
 void SphereRenderer::display()
 {
 	if (viewer()->scene()->protein()->atoms().size() == 0)
@@ -648,26 +593,41 @@ void SphereRenderer::display()
 	// SaveOpenGL state
 	auto currentState = State::currentState();
 
+	m_profiler.beginFrame();
+	m_renderTargets.beginFrame();
+
 	static float resolutionScale = 1.0f;
+	static bool dynamicResolution = false;
+	static DynamicResolution::Settings dynamicResolutionSettings;
+
+	// The automatic resolution follows the GPU time of whole measured frames, including the other renderers and the
+	// user interface. The targets keep the size of the largest scale and the frame is rendered into their lower left
+	// part, so changing the scale reallocates nothing.
+	const GpuTimer& frameTimer = viewer()->frameTimer();
+
+	if (dynamicResolution)
+		resolutionScale = m_dynamicResolution.update(frameTimer.lastMilliseconds(), frameTimer.measurements(), dynamicResolutionSettings);
 
-	const ivec2 viewportSize = ivec2(vec2(viewer()->viewportSize()) * resolutionScale);
+	const ivec2 windowSize = viewer()->viewportSize();
+	const float allocationScale = dynamicResolution ? std::max(dynamicResolutionSettings.minimumScale, dynamicResolutionSettings.maximumScale) : resolutionScale;
+	const ivec2 framebufferSize = max(ivec2(vec2(windowSize) * allocationScale), ivec2(1));
+	const ivec2 viewportSize = clamp(ivec2(vec2(windowSize) * resolutionScale), ivec2(1), framebufferSize);
 
-	// Resize all FBOs if the viewport size has changed
-	if (viewportSize != m_framebufferSize)
+	// Resize the per-pixel buffers if the target size has changed, the pool deletes render targets of the old size once they stay unused
+	if (framebufferSize != m_framebufferSize)
 	{
-		m_framebufferSize = viewportSize;
-		for (auto& tex : m_offsetTexture)
-			tex->image2D(0, GL_R32UI, m_framebufferSize, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, nullptr);
-		m_depthTexture->image2D(0, GL_DEPTH_COMPONENT, m_framebufferSize, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_BYTE, nullptr);
-		m_spherePositionTexture->image2D(0, GL_RGBA32F, m_framebufferSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-		m_sphereNormalTexture->image2D(0, GL_RGBA32F, m_framebufferSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-		m_surfacePositionTexture->image2D(0, GL_RGBA32F, m_framebufferSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-		m_surfaceNormalTexture->image2D(0, GL_RGBA32F, m_framebufferSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-		m_surfaceDiffuseTexture->image2D(0, GL_RGBA32F, m_framebufferSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-		m_sphereDiffuseTexture->image2D(0, GL_RGBA32F, m_framebufferSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-		m_ambientTexture->image2D(0, GL_RGBA32F, m_framebufferSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-		m_blurTexture->image2D(0, GL_RGBA32F, m_framebufferSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-		m_colorTexture->image2D(0, GL_RGBA32F, m_framebufferSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		m_framebufferSize = framebufferSize;
+		const GLsizeiptr pixelListSize = sizeof(uint) * (GLsizeiptr(m_framebufferSize.x) * m_framebufferSize.y + 1);
+		m_pixelCounts = Buffer::create();
+		m_pixelCounts->setStorage(pixelListSize, nullptr, gl::GL_NONE_BIT);
+		m_pixelOffsets = Buffer::create();
+		m_pixelOffsets->setStorage(pixelListSize, nullptr, gl::GL_NONE_BIT);
+		const ivec2 tileCount = (m_framebufferSize + ivec2(ListTileSize - 1)) / ListTileSize;
+		const GLsizeiptr tileListSize = sizeof(uint) * (GLsizeiptr(tileCount.x) * tileCount.y + 1);
+		m_tileCounts = Buffer::create();
+		m_tileCounts->setStorage(tileListSize, nullptr, gl::GL_NONE_BIT);
+		m_tileOffsets = Buffer::create();
+		m_tileOffsets->setStorage(tileListSize, nullptr, gl::GL_NONE_BIT);
 	}
 
 	// our shader programs
@@ -675,9 +635,21 @@ void SphereRenderer::display()
 	auto programSphere = shaderProgram("sphere");
 	auto programSpawn = shaderProgram("spawn");
 	auto programSpawnIteration = shaderProgram("spawn-iteration");
+	auto programScanLocal = shaderProgram("scan-local");
+	auto programScanAdd = shaderProgram("scan-add");
+	auto programTileFootprint = shaderProgram("tile-footprint");
+	auto programHiZ = shaderProgram("hiz");
+	auto programOcclusionCull = shaderProgram("occlusion-cull");
+	auto programClusterLOD = shaderProgram("cluster-lod");
+	auto programTileFill = shaderProgram("tile-fill");
+	auto programTileList = shaderProgram("tile-list");
 	auto programSurface = shaderProgram("surface");
+	auto programSurfaceTile = shaderProgram("surface-tile");
+	auto programSurfaceDepth = shaderProgram("surface-depth");
 	auto programAOSample = shaderProgram("aosample");
 	auto programAOBlur = shaderProgram("aoblur");
+	auto programAOTemporal = shaderProgram("aotemporal");
+	auto programAOUpsample = shaderProgram("aoupsample");
 	auto programShade = shaderProgram("shade");
 	auto programDOFBlur = shaderProgram("dofblur");
 	auto programDOFBlend = shaderProgram("dofblend");
@@ -754,6 +726,7 @@ void SphereRenderer::display()
 	static float distanceScale = 1.0;
 
 	static bool ambientOcclusion = false;
+	static int ambientResolution = 0;
 	static bool environmentMapping = false;
 	static bool environmentLighting = false;
 	static bool normalMapping = false;
@@ -762,6 +735,8 @@ void SphereRenderer::display()
 
 	static int coloring = 0;
 	static bool animate = false;
+	static bool streamTrajectory = false;
+	static bool interpolateTimesteps = true;
 	static float animationAmplitude = 1.0f;
 	static float animationFrequency = 1.0f;
 	static bool lens = false;
@@ -785,11 +760,48 @@ void SphereRenderer::display()
 
 	static float rLOD0{1.7f}, rLOD1{1.f};
 	static float sharpnessOffset{1.f};
+	static bool measureIntersectionLists{false};
+	static int listConstruction{0};
+	static bool occlusionCulling{false};
+	static bool clusterLODSelection{false};
+	static float coarsePixels{4.f}, finePixels{64.f};
+	static int surfaceEvaluation{0};
+	static int surfaceInterleaving{0};
+	static bool slidingWindow{false};
+	static bool lipschitzStepping{false};
+	static bool iterationHeatmap{false};
+	static bool measureIterations{false};
+	static float meshSpacing{0.5f};
+	static bool exportMesh{false};
+	static bool volumeHalfPrecision{true};
+	static bool exportVolume{false};
+	static bool meshVolume{false};
+	static bool showProfiler{false};
+	static bool compactGBuffer{false};
+	static bool compareGBuffer{false};
+	static bool temporalReprojection{false};
+	static int temporalPeriodIndex{2};
 
 	// user interface for manipulating rendering parameters
 	if (ImGui::BeginMenu("Renderer"))
 	{
-		ImGui::SliderFloat("Resolution Scale", &resolutionScale, 0.25f, 8.0f);
+		if (ImGui::Checkbox("Automatic Resolution", &dynamicResolution) && dynamicResolution)
+			m_dynamicResolution.reset(resolutionScale);
+		if (dynamicResolution) {
+			auto& settings = dynamicResolutionSettings;
+			ImGui::SliderFloat("Target Frame Time (ms)", &settings.targetMilliseconds, 4.0f, 100.0f);
+			ImGui::SliderFloat("Minimum Scale", &settings.minimumScale, 0.25f, 1.0f);
+			ImGui::SliderFloat("Maximum Scale", &settings.maximumScale, 0.25f, 2.0f);
+			ImGui::Text("Scale: %.2f (%d x %d), GPU: %.2f ms, passes: %.2f ms", resolutionScale, viewportSize.x, viewportSize.y, frameTimer.lastMilliseconds(), m_profiler.frameMilliseconds());
+		}
+		else
+			ImGui::SliderFloat("Resolution Scale", &resolutionScale, 0.25f, 8.0f);
+		{
+			const auto& targets = m_renderTargets.statistics();
+			ImGui::Text("Render targets: %zu MiB resident (%zu textures)", targets.residentBytes / (1024 * 1024), targets.textures);
+			ImGui::Text("Peak: %zu MiB, without aliasing: %zu MiB", targets.peakBytes / (1024 * 1024), targets.requestedBytes / (1024 * 1024));
+		}
+		ImGui::Checkbox("GPU Profiler", &showProfiler);
 
 		if (ImGui::CollapsingHeader("Lighting"))
 		{
@@ -798,6 +810,7 @@ void SphereRenderer::display()
 			ImGui::ColorEdit3("Specular", (float*)&specularMaterial);
 			ImGui::SliderFloat("Shininess", &shininess, 1.0f, 256.0f);
 			ImGui::Checkbox("Ambient Occlusion Enabled", &ambientOcclusion);
+			ImGui::Combo("Occlusion Resolution", &ambientResolution, "Full\0Half\0Quarter\0");
 			ImGui::Checkbox("Material Mapping Enabled", &materialMapping);
 			ImGui::Checkbox("Normal Mapping Enabled", &normalMapping);
 			ImGui::Checkbox("Environment Mapping Enabled", &environmentMapping);
@@ -811,6 +824,54 @@ void SphereRenderer::display()
 			ImGui::SliderFloat("Dist. Scale", &distanceScale, 0.0f, 16.0f);
 			ImGui::Combo("Coloring", &coloring, "None\0Element\0Residue\0Chain\0");
 			ImGui::Checkbox("Magic Lens", &lens);
+			ImGui::Combo("Evaluation", &surfaceEvaluation, "Per pixel\0Tiled (compute)\0");
+			ImGui::Combo("Interleaving", &surfaceInterleaving, "Off\0Checkerboard\0" "2x2 blocks\0");
+			ImGui::Text("Per pixel: %.3f ms, tiled: %.3f ms", m_surfaceTimer.milliseconds(), m_tiledSurfaceTimer.milliseconds());
+			ImGui::Checkbox("Sliding Window Marching", &slidingWindow);
+			ImGui::Checkbox("Lipschitz Stepping", &lipschitzStepping);
+			ImGui::Checkbox("Iteration Heatmap", &iterationHeatmap);
+
+			if (ImGui::Button("Measure Iterations"))
+				measureIterations = true;
+
+			if (m_surfaceStatistics.pixels > 0) {
+				const auto& stats = m_surfaceStatistics;
+				const double pixels = double(stats.pixels);
+				ImGui::Text("Pixels: %zu, maximum steps: %zu", stats.pixels, stats.maximumMarchSteps);
+				ImGui::Text("Per pixel: %.1f comparisons, %.1f steps, %.1f atoms", stats.sortComparisons / pixels, stats.marchSteps / pixels, stats.atomEvaluations / pixels);
+			}
+
+			ImGui::Checkbox("Temporal Reprojection", &temporalReprojection);
+			ImGui::Combo("Refresh Period", &temporalPeriodIndex, "1 frame\0" "2 frames\0" "4 frames\0" "8 frames\0" "16 frames\0");
+
+			ImGui::Checkbox("Compact G-buffer", &compactGBuffer);
+			{
+				const std::size_t compactBytes = RenderTargetPool::bytesPerPixel(GL_RG16) + 2 * RenderTargetPool::bytesPerPixel(GL_RGBA8);
+				const std::size_t fullBytes = 4 * RenderTargetPool::bytesPerPixel(GL_RGBA32F);
+				ImGui::Text("Surface targets: %zu bytes per pixel (full precision: %zu)", compactGBuffer ? compactBytes : fullBytes, fullBytes);
+			}
+
+			if (ImGui::Button("Compare G-buffer Formats"))
+				compareGBuffer = true;
+
+			if (m_gbufferComparison.pixels > 0) {
+				const auto& comparison = m_gbufferComparison;
+				ImGui::Text("Normal error: %.4f mean, %.4f max degrees", comparison.meanNormalError, comparison.maximumNormalError);
+				ImGui::Text("Position error: %.6f mean, %.6f max", comparison.meanPositionError, comparison.maximumPositionError);
+			}
+
+			ImGui::SliderFloat("Mesh Spacing", &meshSpacing, 0.1f, 2.0f);
+
+			if (ImGui::Button("Export Mesh..."))
+				exportMesh = true;
+
+			ImGui::Checkbox("Half Precision Volume", &volumeHalfPrecision);
+
+			if (ImGui::Button("Export Volume..."))
+				exportVolume = true;
+
+			if (ImGui::Button("Mesh Volume..."))
+				meshVolume = true;
 		}
 
 
@@ -921,89 +982,196 @@ void SphereRenderer::display()
 			ImGui::Checkbox("Prodecural Animation", &animate);
 			ImGui::SliderFloat("Frequency", &animationFrequency, 1.0f, 256.0f);
 			ImGui::SliderFloat("Amplitude", &animationAmplitude, 1.0f, 32.0f);
+			ImGui::Checkbox("Stream Trajectory", &streamTrajectory);
+			ImGui::Checkbox("Interpolate Timesteps", &interpolateTimesteps);
+
+			if (m_atomStream)
+				ImGui::Text("Streamed: %zu frames, %zu stalls (%zu KiB per frame)", m_atomStream->committedFrames(), m_atomStream->stalls(), m_atomStream->frameSize() / 1024);
 		}
 
 		ImGui::EndMenu();
 	}
 
 	if (ImGui::BeginMenu("Interpolation")) {
-		ImGui::SliderFloat("Interpolation", &interpolation, 0.f, 1.f);
+		ImGui::Checkbox("Per-cluster LOD", &clusterLODSelection);
+		if (clusterLODSelection) {
+			ImGui::SliderFloat("Coarse below (px)", &coarsePixels, 0.5f, 64.f);
+			ImGui::SliderFloat("Fine above (px)", &finePixels, 1.f, 512.f);
+			finePixels = std::max(finePixels, coarsePixels + 0.5f);
+			const auto& levels = m_clusterLevelCounts;
+			ImGui::Text("Clusters: %u sparse, %u atoms, %u dense of %u", levels[0], levels[1], levels[2], m_clusterCount);
+		}
+		else
+			ImGui::SliderFloat("Interpolation", &interpolation, 0.f, 1.f);
 		ImGui::SliderFloat("Clustering", &clustering, 0.f, 1.f);
 		ImGui::SliderFloat("LOD0 radius", &rLOD0, 0.f, 10.f);
 		ImGui::SliderFloat("LOD1 radius", &rLOD1, 0.f, 10.f);
 		ImGui::SliderFloat("Interpolation sharpness", &sharpnessOffset, 0.1f, 32.0f);
 		ImGui::SliderInt("Start LOD", &startLODParam, 1, 4);
 		ImGui::Checkbox("Visualize overlaps", &bVisualizeOverlaps);
-		if (ImGui::SliderInt("Offset bucket size", reinterpret_cast<int*>(&m_offsetBucketSize), 1, 64)) {
-			// Resize buffers:
-			for (auto& tex : m_offsetTexture) {
-				tex = Texture::create(GL_TEXTURE_3D);
-				tex->setParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-				tex->setParameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-				tex->setParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-				tex->setParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-				tex->setParameter(GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-				tex->image3D(0, GL_R32UI, glm::ivec3{m_framebufferSize, m_offsetBucketSize}, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+		{
+			const auto& buffer = m_intersectionBuffer;
+			ImGui::Text("Intersection buffer: %u entries (%zu MiB)", buffer.capacity(), buffer.sizeInBytes() / (1024 * 1024));
+			ImGui::Text("Last demand: %u, overflows: %zu", buffer.demand(), buffer.overflowCount());
+		}
+		ImGui::Combo("List construction", &listConstruction, "Rasterization\0Compute (tiled)\0");
+		ImGui::Text("Rasterization: %.3f ms, compute: %.3f ms", m_rasterListTimer.milliseconds(), m_computeListTimer.milliseconds());
+		ImGui::Checkbox("Occlusion culling (rasterization)", &occlusionCulling);
+		if (occlusionCulling && m_cullTestedSpheres > 0)
+			ImGui::Text("Spawned spheres: %u of %u (%.1f%%)", m_cullSpawnedSpheres, m_cullTestedSpheres, 100.0 * m_cullSpawnedSpheres / m_cullTestedSpheres);
+		if (ImGui::Button("Measure list lengths (CPU)"))
+			measureIntersectionLists = true;
+		if (m_intersectionListStatistics.pixels > 0) {
+			const auto& stats = m_intersectionListStatistics;
+			ImGui::Text("Entries: %zu, covered pixels: %zu", stats.entries, stats.coveredPixels);
+			ImGui::Text("Average length: %.1f, maximum length: %zu", stats.averageLength, stats.maximumLength);
+			for (auto [bucket, count] : enumerate(stats.histogram))
+				ImGui::Text("  [%zu, %zu): %zu", std::size_t(1) << bucket, std::size_t(2) << bucket, count);
+
+			const std::array<const char*, 3> variantNames = { "Sorted", "Sliding window", "Lipschitz" };
+			for (auto [variant, reference] : enumerate(m_referenceStatistics)) {
+				const double pixels = double(std::max<std::size_t>(reference.pixels, 1));
+				ImGui::Text("%s: %.1f comparisons, %.1f steps, %.1f atoms per pixel", variantNames[variant],
+					reference.sortComparisons / pixels, reference.marchSteps / pixels, reference.atomEvaluations / pixels);
+				if (variant > 0)
+					ImGui::Text("  differing pixels: %zu", m_referenceMismatches[variant]);
 			}
 		}
 		ImGui::EndMenu();
 	}
 
+	if (showProfiler)
+	{
+		ImGui::Begin("GPU Profiler", &showProfiler, ImGuiWindowFlags_AlwaysAutoResize);
+		ImGui::Text("%-24s %8s %8s %8s %8s", "Pass", "Last", "Avg", "Median", "95%");
+
+		double totalAverage = 0.0;
+
+		for (const auto& pass : m_profiler.statistics()) {
+			ImGui::Text("%-24s %8.3f %8.3f %8.3f %8.3f", pass.name.c_str(), pass.last, pass.average, pass.median, pass.percentile95);
+			totalAverage += pass.average;
+		}
+
+		ImGui::Text("%-24s %8s %8.3f", "Total", "", totalAverage);
+
+		const auto& graphStatistics = m_renderGraph.statistics();
+		ImGui::Text("Render graph: %zu passes, %zu culled, %zu barriers", graphStatistics.passes.size(), graphStatistics.culledPasses, graphStatistics.barriers);
+
+		for (const auto& pass : graphStatistics.passes)
+			if (pass.culled)
+				ImGui::Text("  culled: %s", pass.name.c_str());
+
+		if (!m_profiler.logging()) {
+			if (ImGui::Button("Start CSV Log...")) {
+				const char* filterExtensions[] = { "*.csv" };
+				const char* saveFileName = tinyfd_saveFileDialog("GPU Profiler Log", "./passes.csv", 1, filterExtensions, "CSV Files (*.csv)");
+
+				if (saveFileName && !m_profiler.startLog(saveFileName))
+					globjects::critical() << "Could not write profiler log to " << saveFileName;
+			}
+		}
+		else if (ImGui::Button("Stop CSV Log")) {
+			m_profiler.stopLog();
+		}
+
+		ImGui::End();
+	}
+
 	// Scaling for sphere of influence radius based on estimated density
 	const float contributingAtoms = 32.0f;
 	const float radiusScale = sqrtf(log(contributingAtoms * exp(sharpness)) / sharpness);
 
 	// Properties for animation
 	const uint timestepCount = (uint)viewer()->scene()->protein()->atoms().size();
-	const float animationTime = animate ? float(glfwGetTime()) : -1.0f;
 	const float currentTime = static_cast<float>(glfwGetTime()) * animationFrequency;
 	const uint currentTimestep = uint(currentTime) % timestepCount;
 	const uint nextTimestep = (currentTimestep + 1) % timestepCount;
 	const float animationDelta = currentTime - floor(currentTime);
 	const int vertexCount = int(viewer()->scene()->protein()->atoms()[currentTimestep].size());
 
-	// Defines for enabling/disabling shader feature based on parameter setting
-	std::string defines = "";
-
-	if (animate)
-		defines += "#define ANIMATION\n";
-
-	if (lens)
-		defines += "#define LENSING\n";
+	// Trajectories are streamed into the LOD0 vertices, which needs the same atoms in every timestep as in the hierarchy
+	const auto& hierarchyPoints = viewer()->scene()->protein()->m_hierarchyPoints;
+	const bool streamingPossible = timestepCount > 1 && std::size_t(vertexCount) == hierarchyPoints.size();
+	const bool requestedInterpolation = streamTrajectory && streamingPossible && interpolateTimesteps;
+	// Levels of detail selected per cluster on the GPU instead of one pair of levels for all atoms
+	const bool requestedClusterLOD = clusterLODSelection && m_clusterCount > 0;
 
-	if (coloring > 0)
-		defines += "#define COLORING\n";
-
-	if (ambientOcclusion)
-		defines += "#define AMBIENT\n";
-
-	if (environmentMapping)
-		defines += "#define ENVIRONMENT\n";
-
-	if (environmentMapping && environmentLighting)
-		defines += "#define ENVIRONMENTLIGHTING\n";
+	// Defines for enabling/disabling shader feature based on parameter setting
+	const auto shaderOptions = std::to_array<std::pair<const char*, bool>>({
+		{ "ANIMATION", animate },
+		{ "INTERPOLATION", requestedInterpolation },
+		{ "CLUSTER_LOD", requestedClusterLOD },
+		{ "LENSING", lens },
+		{ "COLORING", coloring > 0 },
+		{ "AMBIENT", ambientOcclusion },
+		{ "ENVIRONMENT", environmentMapping },
+		{ "ENVIRONMENTLIGHTING", environmentMapping && environmentLighting },
+		{ "NORMAL", normalMapping },
+		{ "MATERIAL", materialMapping },
+		{ "DEPTHOFFIELD", depthOfField },
+		{ "VISUALIZE_OVERLAPS", bVisualizeOverlaps },
+		{ "SLIDING_WINDOW", slidingWindow },
+		{ "ITERATION_STATISTICS", measureIterations },
+		{ "LIPSCHITZ_STEPPING", lipschitzStepping },
+		{ "ITERATION_HEATMAP", iterationHeatmap },
+	});
 
-	if (normalMapping)
-		defines += "#define NORMAL\n";
+	// Defines of the current options with the one at index toggled (none for an index past the end)
+	const auto shaderDefines = [&shaderOptions](std::size_t toggled) {
+		std::string defines = "";
 
-	if (materialMapping)
-		defines += "#define MATERIAL\n";
+		for (std::size_t i = 0; i < shaderOptions.size(); i++)
+			if (shaderOptions[i].second != (i == toggled))
+				defines += std::string("#define ") + shaderOptions[i].first + "\n";
 
-	if (depthOfField)
-		defines += "#define DEPTHOFFIELD\n";
+		return defines;
+	};
 
-	if (bVisualizeOverlaps)
-		defines += "#define VISUALIZE_OVERLAPS\n";
-	
-	defines += std::format("#define BUCKET_SIZE {}\n", m_offsetBucketSize);
+	const std::string defines = shaderDefines(shaderOptions.size());
 
-	// Reload shaders if settings have changed
-	if (defines != m_shaderSourceDefines->string())
+	// Reload shaders if settings have changed. Programs that are not cached yet are compiled in the background first,
+	// the current ones are used until then.
+	if (defines != m_shaderSourceDefines->string() && precompileShaderPrograms("/defines", defines, true))
 	{
 		m_shaderSourceDefines->setString(defines);
 		reloadShaders();
 	}
 
+	// Options are changed one at a time, so the sets of defines that differ in a single option are compiled ahead
+	if (m_precompiledDefines != m_shaderSourceDefines->string())
+	{
+		m_precompiledDefines = m_shaderSourceDefines->string();
+
+		for (std::size_t i = 0; i < shaderOptions.size(); i++)
+			precompileShaderPrograms("/defines", shaderDefines(i));
+	}
+
+	// The options of the interface only take effect with the programs of their defines, until these are compiled the
+	// bindings and passes on the host follow the defines of the programs in use. An option also needs the programs
+	// that test it to include the defines, the shared sphere shaders only do through redirectInclude().
+	const std::string& activeDefines = m_shaderSourceDefines->string();
+	const auto activeOption = [&activeDefines](const char* name) {
+		return activeDefines.find(std::string("#define ") + name + "\n") != std::string::npos;
+	};
+
+	const bool sphereDefines = shaderProgramIncludes("sphere", "/defines");
+	const bool surfaceDefines = shaderProgramIncludes("surface", "/defines");
+	const bool shadeDefines = shaderProgramIncludes("shade", "/defines");
+
+	const bool animated = sphereDefines && activeOption("ANIMATION");
+	const float animationTime = animated ? float(glfwGetTime()) : -1.0f;
+	// The raster passes only blend with nextPosition if sphere-vs.glsl was compiled with INTERPOLATION, otherwise the
+	// current timestep is bound and the compute passes do not interpolate either, so that both see the same spheres
+	const bool interpolateTrajectory = streamingPossible && sphereDefines && activeOption("INTERPOLATION");
+	const bool streaming = streamingPossible && (streamTrajectory || interpolateTrajectory);
+	const bool perClusterLOD = m_clusterCount > 0 && sphereDefines && activeOption("CLUSTER_LOD");
+	const bool visualizeOverlaps = surfaceDefines && activeOption("VISUALIZE_OVERLAPS");
+	const bool ambientShading = surfaceDefines && shadeDefines && activeOption("AMBIENT");
+	const bool environmentShading = surfaceDefines && shadeDefines && activeOption("ENVIRONMENT");
+	const bool lipschitzSurface = surfaceDefines && activeOption("LIPSCHITZ_STEPPING");
+	const bool heatmapSurface = surfaceDefines && activeOption("ITERATION_HEATMAP");
+	const bool measuringIterations = measureIterations && surfaceDefines && activeOption("ITERATION_STATISTICS");
+
 	// // Vertex binding setup
 	// auto vertexBinding = m_vao->binding(0);
 	// vertexBinding->setAttribute(0);
@@ -1046,6 +1214,9 @@ void SphereRenderer::display()
 		},
 	});
 
+	m_currentTimestep = currentTimestep;
+	m_atomRadius = LODs[1].radius;
+
 	constexpr float PAIR_EPSILON = 0.002f;
 
 	// const auto cmp = [](float a, float b, float eps){
@@ -1085,6 +1256,77 @@ void SphereRenderer::display()
 	// 	m_vao->enable(1);
 	// }
 
+	// Trajectory streaming: the atom positions of a timestep replace those of the LOD0 vertices, parents and radii are
+	// kept from the hierarchy. A new frame is only written when the timestep changes. With interpolation the ring holds
+	// the current and the next timestep, which are blended on the GPU, so only one timestep is written per step.
+	if (streaming)
+	{
+		if (!m_atomStream)
+			m_atomStream = std::make_unique<StreamingBuffer>(sizeof(Protein::HierchicalPoints) * hierarchyPoints.size());
+
+		const auto streamTimestep = [&](uint timestep) {
+			const auto frame = m_atomStream->acquire();
+
+			if (frame.empty())
+				return false;
+
+			const auto& atoms = viewer()->scene()->protein()->atoms()[timestep];
+			auto* points = reinterpret_cast<Protein::HierchicalPoints*>(frame.data());
+
+			ThreadPool::instance().parallelFor(hierarchyPoints.size(), [&](std::size_t i) {
+				points[i] = { atoms[i], hierarchyPoints[i].parent, hierarchyPoints[i].radius };
+			}, 4096);
+
+			m_atomStream->commit();
+			return true;
+		};
+
+		const uint headTimestep = interpolateTrajectory ? nextTimestep : currentTimestep;
+
+		if (headTimestep != m_streamedTimestep)
+		{
+			// Unless playback advanced by one step, the current timestep has to be written before the next one
+			const bool advanced = m_streamedTimestep != uint(-1) && (m_streamedTimestep + 1) % timestepCount == headTimestep;
+			bool streamed = true;
+
+			if (interpolateTrajectory && !advanced)
+				streamed = streamTimestep(currentTimestep);
+
+			if (streamed && streamTimestep(headTimestep))
+				m_streamedTimestep = headTimestep;
+			else
+				m_streamedTimestep = uint(-1);
+		}
+	}
+	else
+	{
+		m_streamedTimestep = uint(-1);
+	}
+
+	const bool streamedVertices = streaming && m_streamedTimestep != uint(-1);
+	Buffer* const lod0Vertices = streamedVertices ? m_atomStream->buffer() : m_hiarchyVertices.get();
+	const GLintptr lod0Offset = streamedVertices ? m_atomStream->offset(interpolateTrajectory ? 1 : 0) : 0;
+	const GLintptr lod0NextOffset = streamedVertices ? m_atomStream->offset() : 0;
+
+	for (GLuint attribute = 0; attribute < 3; attribute++)
+		m_vao->binding(attribute)->setBuffer(lod0Vertices, lod0Offset + GLintptr(attribute * sizeof(vec4)), sizeof(Protein::HierchicalPoints));
+
+	m_vao->binding(3)->setBuffer(lod0Vertices, lod0NextOffset, sizeof(Protein::HierchicalPoints));
+
+	// Vertices of a level of detail as storage buffer for the compute passes
+	const auto bindLODVertices = [&](const LOD* lod) {
+		const bool streamedLOD = lod == &LODs[1] && streamedVertices;
+
+		if (streamedLOD) {
+			lod0Vertices->bindRange(GL_SHADER_STORAGE_BUFFER, 0, lod0Offset, GLsizeiptr(m_atomStream->frameSize()));
+			lod0Vertices->bindRange(GL_SHADER_STORAGE_BUFFER, 10, lod0NextOffset, GLsizeiptr(m_atomStream->frameSize()));
+		}
+		else
+			(lod == &LODs[0] ? m_sparseAtomVertices.get() : (lod == &LODs[2] ? m_denseAtomVertices.get() : m_hiarchyVertices.get()))->bindBase(GL_SHADER_STORAGE_BUFFER, 0);
+
+		programTileFootprint->setUniform("animationDelta", streamedLOD && interpolateTrajectory ? animationDelta : 0.0f);
+	};
+
 	constexpr float ATOM_SIZE = 1.7f;
 	const std::pair bounds{viewer()->scene()->protein()->minimumBounds(), viewer()->scene()->protein()->maximumBounds()};
 	/*
@@ -1167,25 +1409,255 @@ void SphereRenderer::display()
 	*/
 
 	//////////////////////////////////////////////////////////////////////////
-	// Sphere rendering pass
+	// Render graph resources
 	//////////////////////////////////////////////////////////////////////////
-	/** Renders sphere's inner radius onto a position lookup texture
-	 */ 
-	// m_sphereFramebuffer->bind();
-	glClearDepth(1.0f);
-	glClearColor(0.0, 0.0, 0.0, 65535.0f);
+	/** The passes are recorded with the resources they read and write and executed together at the end of the frame.
+	 *  Render targets only live from their first to their last use, passes without used results are skipped.
+	 */
+	using Access = RenderGraph::Access;
+	using Builder = RenderGraph::Builder;
+	RenderGraph& graph = m_renderGraph;
 
-	glEnable(GL_DEPTH_TEST);
-	glDepthFunc(GL_LESS);
-		
-	programSphere->use();
+	// Passes render into the lower left viewportSize part of the targets, read backs of a whole target keep only that part
+	const auto cropToViewport = [&](auto& image) {
+		for (int y = 1; y < viewportSize.y; y++)
+			std::copy_n(image.begin() + std::size_t(y) * m_framebufferSize.x, viewportSize.x, image.begin() + std::size_t(y) * viewportSize.x);
+
+		image.resize(std::size_t(viewportSize.x) * viewportSize.y);
+	};
+
+	// Resizing happens here, before anything is imported into the graph, based on the totals of previous frames
+	m_intersectionBuffer.update();
+	m_tileSpheres.update();
+
+	GLuint footprintCount = 0;
+
+	for (auto lod : getPairwiseLODs(interpolation))
+		if (lod != nullptr)
+			footprintCount += GLuint(lod->vCount);
+
+	if (footprintCount > m_footprintCapacity)
+	{
+		m_footprints = Buffer::create();
+		m_footprints->setStorage(GLsizeiptr(FootprintSize) * footprintCount, nullptr, gl::GL_NONE_BIT);
+		m_footprintCapacity = footprintCount;
+	}
+
+	if (footprintCount > m_cullCapacity)
+	{
+		m_cullIndices = Buffer::create();
+		m_cullIndices->setStorage(GLsizeiptr(sizeof(GLuint)) * footprintCount, nullptr, gl::GL_NONE_BIT);
+		m_cullCapacity = footprintCount;
+	}
+
+	// Counts of the indirect draws of an earlier frame, collected once they have arrived
+	if (m_cullReadbackFence)
+	{
+		const GLenum status = m_cullReadbackFence->clientWait(GL_NONE_BIT, 0);
+
+		if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+		{
+			m_cullReadbackFence.reset();
+			m_cullSpawnedSpheres = m_cullReadbackData[0] + m_cullReadbackData[DrawCommandSize / sizeof(GLuint)];
+			m_cullTestedSpheres = m_cullPendingSpheres;
+		}
+	}
+
+	if (m_clusterReadbackFence)
+	{
+		const GLenum status = m_clusterReadbackFence->clientWait(GL_NONE_BIT, 0);
+
+		if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+		{
+			m_clusterReadbackFence.reset();
+			std::copy_n(m_clusterReadbackData, m_clusterLevelCounts.size(), m_clusterLevelCounts.begin());
+		}
+	}
+
+	m_depthPyramid.resize(m_framebufferSize);
+
+	// The compact G-buffer stores octahedral normals and 8 bit colors, positions are reconstructed from the depth.
+	// The comparison needs both variants and the overlap visualization writes the color target instead.
+	const bool compactSurface = compactGBuffer && !compareGBuffer && !visualizeOverlaps;
+	const GLenum surfaceNormalFormat = compactSurface ? GL_RG16 : GL_RGBA32F;
+	const GLenum diffuseFormat = compactSurface ? GL_RGBA8 : GL_RGBA32F;
 
+	// Tiled evaluation needs the tile lists of the compute list construction, which use the static sphere positions
+	// and a single pair of levels of detail.
+	// The marching options, measurements and the compact G-buffer are only available in the per-pixel pass.
+	const bool tiledSurface = surfaceEvaluation == 1 && !animated && !visualizeOverlaps && !measuringIterations && !lipschitzSurface && !heatmapSurface && !compactSurface && !perClusterLOD;
+
+	// The per-pixel pass can march a subset of the pixels into sparse targets first and reconstruct the others from
+	// their positions, which the compact G-buffer does not store
+	const bool interleavedSurface = surfaceInterleaving > 0 && !tiledSurface && !compactSurface && !visualizeOverlaps && !measuringIterations;
+
+	// The surface and its occlusion are reprojected from the last frame in the per-pixel pass, which needs the full
+	// precision targets and atoms that stay in place. Pixels are reused from the second frame with the same state on.
+	const bool temporalSurface = temporalReprojection && !tiledSurface && !compactSurface && !compareGBuffer && !visualizeOverlaps && !measuringIterations && !heatmapSurface && !animated && !streaming;
+	const bool ambientSampling = ambientShading && !compactSurface && !visualizeOverlaps;
+	const GLuint temporalPeriod = GLuint(1) << temporalPeriodIndex;
+	// Size of a pixel at unit distance, the reprojection tolerances are given in pixels
+	const float pixelFootprint = 2.0f / (projectionMatrix[1][1] * float(viewportSize.y));
+
+	if (temporalSurface)
+	{
+		m_temporalHistory.resize(m_framebufferSize);
+		m_temporalHistory.begin({ float(viewportSize.x), float(viewportSize.y), sharpness, interpolation, clustering, replaceScaleParam, float(startLODParam),
+			rLOD0, rLOD1, sharpnessOffset, float(perClusterLOD), coarsePixels, finePixels, float(ambientSampling), float(ambientResolution) });
+	}
+	else
+	{
+		m_temporalHistory.invalidate();
+	}
+
+	const bool temporalReuse = temporalSurface && m_temporalHistory.valid();
+	// Occlusion at half or quarter resolution is upsampled to the surface instead of being reprojected
+	const GLint ambientDivisor = GLint(1) << ambientResolution;
+	const bool temporalAmbient = temporalReuse && ambientDivisor == 1;
+	const mat4 previousModelViewProjectionMatrix = m_temporalHistory.previousModelViewProjectionMatrix();
+	const mat3 historyNormalMatrix = normalMatrix * inverse(m_temporalHistory.previousNormalMatrix());
+
+	auto depth = graph.createTexture("Depth", GL_DEPTH_COMPONENT, m_framebufferSize);
+	auto spherePosition = graph.createTexture("Sphere position", GL_RGBA32F, m_framebufferSize);
+	auto sphereNormal = graph.createTexture("Sphere normal", GL_RGBA32F, m_framebufferSize);
+	auto spherePositionNear = graph.createTexture("Sphere position near", GL_RGBA32F, m_framebufferSize);
+	auto sphereDiffuse = graph.createTexture("Sphere diffuse", diffuseFormat, m_framebufferSize);
+	auto surfacePosition = graph.createTexture("Surface position", GL_RGBA32F, m_framebufferSize);
+	auto surfaceNormal = graph.createTexture("Surface normal", surfaceNormalFormat, m_framebufferSize);
+	auto surfaceDiffuse = graph.createTexture("Surface diffuse", diffuseFormat, m_framebufferSize);
+	auto ambient = graph.createTexture("Ambient", GL_RGBA32F, m_framebufferSize);
+
+	// With reprojection the surface and the resolved occlusion are rendered into the current history targets
+	RenderGraph::Resource historyPosition, historyNormal, historyDiffuse, historyAmbient;
+
+	if (temporalSurface)
+	{
+		surfacePosition = graph.importTexture("Surface position", m_temporalHistory.current(TemporalHistory::Position));
+		surfaceNormal = graph.importTexture("Surface normal", m_temporalHistory.current(TemporalHistory::Normal));
+		surfaceDiffuse = graph.importTexture("Surface diffuse", m_temporalHistory.current(TemporalHistory::Diffuse));
+		historyPosition = graph.importTexture("History position", m_temporalHistory.previous(TemporalHistory::Position));
+		historyNormal = graph.importTexture("History normal", m_temporalHistory.previous(TemporalHistory::Normal));
+		historyDiffuse = graph.importTexture("History diffuse", m_temporalHistory.previous(TemporalHistory::Diffuse));
+
+		if (ambientSampling)
+		{
+			ambient = graph.importTexture("Ambient", m_temporalHistory.current(TemporalHistory::Ambient));
+			historyAmbient = graph.importTexture("History ambient", m_temporalHistory.previous(TemporalHistory::Ambient));
+		}
+	}
+
+	auto color = graph.createTexture("Color", GL_RGBA32F, m_framebufferSize);
+
+	// Level of detail targets, only needed until they are merged by the splitting pass
+	std::array<RenderGraph::Resource, 2> lodDepths = {
+		graph.createTexture("LOD0 depth", GL_DEPTH_COMPONENT, m_framebufferSize),
+		graph.createTexture("LOD1 depth", GL_DEPTH_COMPONENT, m_framebufferSize)
+	};
+	std::array<RenderGraph::Resource, 4> lodPositions = {
+		graph.createTexture("LOD0 position", GL_RGBA32F, m_framebufferSize),
+		graph.createTexture("LOD1 position", GL_RGBA32F, m_framebufferSize),
+		graph.createTexture("LOD0 position near", GL_RGBA32F, m_framebufferSize),
+		graph.createTexture("LOD1 position near", GL_RGBA32F, m_framebufferSize)
+	};
+	std::array<RenderGraph::Resource, 4> lodNormals = {
+		graph.createTexture("LOD0 normal", GL_RGBA32F, m_framebufferSize),
+		graph.createTexture("LOD1 normal", GL_RGBA32F, m_framebufferSize),
+		graph.createTexture("LOD0 normal near", GL_RGBA32F, m_framebufferSize),
+		graph.createTexture("LOD1 normal near", GL_RGBA32F, m_framebufferSize)
+	};
+
+	auto intersections = graph.importBuffer("Intersections", m_intersectionBuffer.entries());
+	auto pixelCounts = graph.importBuffer("Pixel counts", m_pixelCounts.get());
+	auto pixelOffsets = graph.importBuffer("Pixel offsets", m_pixelOffsets.get());
+	auto footprints = graph.importBuffer("Footprints", m_footprints.get());
+	auto tileCounts = graph.importBuffer("Tile counts", m_tileCounts.get());
+	auto tileOffsets = graph.importBuffer("Tile offsets", m_tileOffsets.get());
+	auto tileSpheres = graph.importBuffer("Tile spheres", m_tileSpheres.entries());
+	auto statistics = graph.importBuffer("Statistics", m_statisticsBuffer.get());
+	const auto sceneGraph = graph.importBuffer("Scene graph", m_sceneGraphBuffer.get());
+	auto depthPyramid = graph.importTexture("Depth pyramid", m_depthPyramid.texture());
+	auto cullIndices = graph.importBuffer("Cull indices", m_cullIndices.get());
+	auto cullCommands = graph.importBuffer("Cull commands", m_cullCommands.get());
+	auto clusterCommands = graph.importBuffer("Cluster commands", m_clusterCommands.get());
+	auto clusterWeights = graph.importBuffer("Cluster weights", m_clusterWeights.get());
+	auto clusterLevels = graph.importBuffer("Cluster levels", m_clusterLevels.get());
+
+	//////////////////////////////////////////////////////////////////////////
+	// Level of detail selection
+	//////////////////////////////////////////////////////////////////////////
+	/** Picks the level of detail of every cluster from its projected size and writes the indirect draws of the levels
+	 *  with the weights of the clusters, so that distant clusters are drawn coarse and close ones fine in one frame
+	 */
+	if (perClusterLOD)
+	{
+		graph.addPass("Cluster LOD selection", [&](Builder& builder) {
+			clusterCommands = builder.storage(clusterCommands, 13, GL_WRITE_ONLY);
+			clusterWeights = builder.storage(clusterWeights, 14, GL_WRITE_ONLY);
+			clusterLevels = builder.write(clusterLevels, Access::Transfer);
+			builder.storage(clusterLevels, 15, GL_WRITE_ONLY);
+		}, [&]() {
+			constexpr GLuint levelClearValue = 0;
+			m_clusterLevels->clearData(GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &levelClearValue);
+
+			bindLODVertices(&LODs[1]);
+
+			programClusterLOD->setUniform("modelViewMatrix", modelViewMatrix);
+			programClusterLOD->setUniform("projectionMatrix", projectionMatrix);
+			programClusterLOD->setUniform("framebufferSize", viewportSize);
+			programClusterLOD->setUniform("clusterCount", m_clusterCount);
+			programClusterLOD->setUniform("clusterSize", GLuint(Protein::SparseClusterSize));
+			programClusterLOD->setUniform("denseChildCount", GLuint(Protein::DenseChildCount));
+			programClusterLOD->setUniform("atomCount", GLuint(hierarchyPoints.size()));
+			programClusterLOD->setUniform("sparseCount", GLuint(m_sparseVertexCount));
+			programClusterLOD->setUniform("denseCount", GLuint(m_denseVertexCount));
+			programClusterLOD->setUniform("atomRadius", LODs[1].radius);
+			programClusterLOD->setUniform("coarsePixels", coarsePixels);
+			programClusterLOD->setUniform("finePixels", finePixels);
+			programClusterLOD->setUniform("pairEpsilon", PAIR_EPSILON);
+			programClusterLOD->setUniform("animationDelta", streamedVertices && interpolateTrajectory ? animationDelta : 0.0f);
+
+			programClusterLOD->use();
+			programClusterLOD->dispatchCompute((m_clusterCount + 63) / 64, 1, 1);
+			programClusterLOD->release();
+
+			Buffer::unbind(GL_SHADER_STORAGE_BUFFER, 10);
+			Buffer::unbind(GL_SHADER_STORAGE_BUFFER, 0);
+
+			// Statistics only, skipped while an earlier read back is in flight
+			if (!m_clusterReadbackFence)
+			{
+				glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+				m_clusterLevels->copySubData(m_clusterReadback.get(), 0, 0, sizeof(GLuint) * 3);
+				m_clusterReadbackFence = Sync::fence(GL_SYNC_GPU_COMMANDS_COMPLETE);
+			}
+		});
+	}
+
+	// Draws every level with the per-cluster commands of the selection, the weights of the clusters are instanced
+	// attributes. The uniforms of a level are set by the caller.
+	const auto drawClusterLODs = [&](Program* program, const std::function<void(const LOD&)>& setLevel) {
+		m_clusterCommands->bind(GL_DRAW_INDIRECT_BUFFER);
+
+		for (auto [level, lod] : enumerate(LODs)) {
+			setLevel(lod);
+			program->setUniform("lodLevel", GLuint(level));
+			lod.vao->multiDrawArraysIndirect(GL_POINTS, reinterpret_cast<const void*>(std::uintptr_t(ArraysCommandSize) * m_clusterCount * level), GLsizei(m_clusterCount));
+		}
+
+		Buffer::unbind(GL_DRAW_INDIRECT_BUFFER);
+	};
+
+	//////////////////////////////////////////////////////////////////////////
+	// Sphere rendering pass
+	//////////////////////////////////////////////////////////////////////////
+	/** Renders sphere's inner radius onto a position lookup texture
+	 */
 	programSphere->setUniform("modelViewMatrix", modelViewMatrix);
 	programSphere->setUniform("projectionMatrix", projectionMatrix);
 	programSphere->setUniform("modelViewProjectionMatrix", modelViewProjectionMatrix);
 	programSphere->setUniform("inverseModelViewProjectionMatrix", inverseModelViewProjectionMatrix);
 	programSphere->setUniform("nearPlaneZ", nearPlane.z);
-	programSphere->setUniform("animationDelta", animationDelta);
+	programSphere->setUniform("animationDelta", interpolateTrajectory ? animationDelta : 0.0f);
 	programSphere->setUniform("animationTime", animationTime);
 	programSphere->setUniform("animationAmplitude", animationAmplitude);
 	programSphere->setUniform("animationFrequency", animationFrequency);
@@ -1193,85 +1665,278 @@ void SphereRenderer::display()
 	programSphere->setUniform("minb", bounds.first);
 	programSphere->setUniform("maxb", bounds.second);
 
-	m_sceneGraphBuffer->bindBase(GL_SHADER_STORAGE_BUFFER, 7);
-
-	const auto getFramebuffer = [&](auto i){
-		return std::to_array({
-			m_sphereLOD0Framebuffer.get(),
-			m_sphereLOD1Framebuffer.get(),
-			m_sphereLOD0FramebufferNear.get(),
-			m_sphereLOD1FramebufferNear.get()
-		}).at(i);
-	};
+	// With per-cluster levels all levels are drawn into the targets of the first one, their blending is in the lists
+	const bool bSingleLOD = isSinglePair(interpolation) || perClusterLOD;
+	const auto spherePassNames = std::to_array({ "Spheres LOD0", "Spheres LOD1", "Spheres LOD0 near", "Spheres LOD1 near" });
+	const auto spherePassLODs = perClusterLOD ? std::to_array<const LOD*>({ &LODs[1], nullptr, &LODs[1], nullptr }) : cat(getPairwiseLODs(interpolation), getPairwiseLODs(interpolation));
 
-	for (auto [index, lod] : enumerate(cat(getPairwiseLODs(interpolation), getPairwiseLODs(interpolation)))) {
+	for (auto [index, lod] : enumerate(spherePassLODs)) {
 		if (lod == nullptr)
 			continue;
-		auto framebuffer = getFramebuffer(index);
-		framebuffer->bind();
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		auto& [vao, vCount, scale, cluster, sharp] = *lod;
-		const auto interp = clampedInterpolation(interpolation);
-		const auto weight = index % 2 == 0 ? 1.f - interp : interp;
-
-		// 2 renderpasses of each LOD with inner radiuses and 2 renderpasses of each LOD with outer radiuses
-		programSphere->setUniform("radiusScale", index < 2 ? scale : radiusScale * scale); // Inner radius
-		// programSpawn->setUniform("outerRadius", ATOM_SIZE * scale);
-		programSphere->setUniform("clipRadiusScale", radiusScale * scale); // Outer radius
-		programSphere->setUniform("clustering", cluster(interp));
-		programSphere->setUniform("individualSharpness", sharp(interp));
-		programSphere->setUniform("weight", weight);
-
-		vao->drawArrays(GL_POINTS, 0, vCount);
-		framebuffer->unbind();
-	}
 
-	programSphere->release();
+		// The near passes reuse the depth targets of their level of detail
+		graph.addPass(spherePassNames.at(index), [&, index = index](Builder& builder) {
+			lodPositions[index] = builder.colorAttachment(lodPositions[index], 0);
+			lodNormals[index] = builder.colorAttachment(lodNormals[index], 1);
+			lodDepths[index % 2] = builder.depthAttachment(lodDepths[index % 2], GL_WRITE_ONLY);
+			builder.storage(sceneGraph, 7, GL_READ_ONLY);
 
-	m_sceneGraphBuffer->unbind(GL_SHADER_STORAGE_BUFFER);
+			if (perClusterLOD) {
+				builder.read(clusterCommands, Access::Indirect);
+				builder.read(clusterWeights, Access::Vertex);
+			}
+		}, [&, index = index, lod = lod]() {
+			glClearDepth(1.0f);
+			glClearColor(0.0, 0.0, 0.0, 65535.0f);
+
+			glEnable(GL_DEPTH_TEST);
+			glDepthFunc(GL_LESS);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			auto& [vao, vCount, scale, cluster, sharp] = *lod;
+			const auto interp = clampedInterpolation(interpolation);
+			const auto weight = index % 2 == 0 ? 1.f - interp : interp;
+
+			// 2 renderpasses of each LOD with inner radiuses and 2 renderpasses of each LOD with outer radiuses
+			programSphere->setUniform("radiusScale", index < 2 ? scale : radiusScale * scale); // Inner radius
+			// programSpawn->setUniform("outerRadius", ATOM_SIZE * scale);
+			programSphere->setUniform("clipRadiusScale", radiusScale * scale); // Outer radius
+			programSphere->setUniform("clustering", cluster(interp));
+			programSphere->setUniform("individualSharpness", sharp(interp));
+			programSphere->setUniform("weight", weight);
+
+			programSphere->use();
+
+			if (perClusterLOD) {
+				drawClusterLODs(programSphere, [&](const LOD& level) {
+					programSphere->setUniform("radiusScale", index < 2 ? level.radius : radiusScale * level.radius);
+					programSphere->setUniform("clipRadiusScale", radiusScale * level.radius);
+					programSphere->setUniform("clustering", level.clustering(0.f));
+					programSphere->setUniform("individualSharpness", level.sharpness(0.f));
+					programSphere->setUniform("weight", 1.f);
+				});
+			}
+			else
+				vao->drawArrays(GL_POINTS, 0, vCount);
+
+			programSphere->release();
+		});
+	}
 
 	//////////////////////////////////////////////////////////////////////////
 	// Framebuffer splitting:
 	//////////////////////////////////////////////////////////////////////////
-	glMemoryBarrier(GL_ALL_BARRIER_BITS);
+	const auto programSplitting = bSingleLOD ? programFramebufferSplittingBlitting : programFramebufferSplitting;
 
-	const bool bSingleLOD = isSinglePair(interpolation);
-	m_sphereFramebuffer->bind();
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	glDepthFunc(GL_ALWAYS);
+	graph.addPass("Framebuffer splitting", [&](Builder& builder) {
+		builder.sample(lodPositions[0], 0);
+		builder.sample(lodNormals[0], 1);
+		builder.sample(lodPositions[2], 2);
 
-	const auto programSplitting = bSingleLOD ? programFramebufferSplittingBlitting : programFramebufferSplitting;
+		if (!bSingleLOD) {
+			builder.sample(lodPositions[1], 3);
+			builder.sample(lodNormals[1], 4);
+			builder.sample(lodPositions[3], 5);
+		}
 
-	programSplitting->use();
+		spherePosition = builder.colorAttachment(spherePosition, 0);
+		sphereNormal = builder.colorAttachment(sphereNormal, 1);
+		spherePositionNear = builder.colorAttachment(spherePositionNear, 2);
+		depth = builder.depthAttachment(depth, GL_WRITE_ONLY);
+	}, [&]() {
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		glDepthFunc(GL_ALWAYS);
 
-	m_sphereLOD0PositionTexture->bindActive(0);
-	m_sphereLOD0NormalTexture->bindActive(1);
-	m_sphereLOD0PositionTextureNear->bindActive(2);
-	
-	if (!bSingleLOD) {
-		programSplitting->setUniform("modelViewProjectionMatrix", modelViewProjectionMatrix);
-		programSplitting->setUniform("interpolation", clampedInterpolation(interpolation));
+		if (!bSingleLOD) {
+			programSplitting->setUniform("modelViewProjectionMatrix", modelViewProjectionMatrix);
+			programSplitting->setUniform("interpolation", clampedInterpolation(interpolation));
+		}
+
+		programSplitting->use();
+		m_vaoQuad->drawArrays(GL_POINTS, 0, 1);
+		programSplitting->release();
+	});
+
+	//////////////////////////////////////////////////////////////////////////
+	// CPU reference lists (on demand)
+	//////////////////////////////////////////////////////////////////////////
+	/** Builds the same lists as the spawn pass on the CPU to report per-pixel list lengths. Streamed trajectories use
+	 *  the positions of the current frame, animated atoms are displaced in sphere-vs.glsl and wait until it is off.
+	 */
+	if (measureIntersectionLists && !perClusterLOD && !animated)
+	{
+		measureIntersectionLists = false;
+
+		graph.addPass("CPU reference lists", [&](Builder& builder) {
+			builder.read(spherePosition, Access::Transfer);
+			builder.sideEffect();
+		}, [&]() {
+			const auto& protein = *viewer()->scene()->protein();
+			std::vector<vec4> positions(std::size_t(m_framebufferSize.x) * m_framebufferSize.y);
+			graph.texture(spherePosition)->getImage(0, GL_RGBA, GL_FLOAT, positions.data());
+			cropToViewport(positions);
+
+			std::vector<float> depthLimit(positions.size());
+			for (std::size_t i = 0; i < depthLimit.size(); i++)
+				depthLimit[i] = positions[i].w;
+
+			std::vector<std::vector<vec4>> spheres;
+			std::vector<IntersectionList::Layer> layers;
+
+			for (auto [index, lod] : enumerate(getPairwiseLODs(interpolation))) {
+				if (lod == nullptr)
+					continue;
+				const auto& points = lod == &LODs[0] ? protein.m_genAtomsSparse : (lod == &LODs[2] ? protein.m_genAtomsDense : protein.m_hierarchyPoints);
+				auto& lodSpheres = spheres.emplace_back(lod->vCount);
+
+				if (lod == &LODs[1] && streamedVertices) {
+					const auto& current = protein.atoms()[currentTimestep];
+					const auto& next = protein.atoms()[nextTimestep];
+					const float delta = interpolateTrajectory ? animationDelta : 0.0f;
+
+					for (std::size_t i = 0; i < lodSpheres.size(); i++)
+						lodSpheres[i] = vec4(mix(vec3(current[i]), vec3(next[i]), delta), current[i].w);
+				}
+				else {
+					for (std::size_t i = 0; i < lodSpheres.size(); i++)
+						lodSpheres[i] = points[i].pos;
+				}
+
+				const auto interp = clampedInterpolation(interpolation);
+				layers.push_back({ lodSpheres.data(), lodSpheres.size(), radiusScale * lod->radius, lod->radius, lod->sharpness(interp), index == 0 ? 1.f - interp : interp });
+			}
+
+			IntersectionList intersectionList;
+			intersectionList.build(layers, modelViewMatrix, projectionMatrix, viewportSize, depthLimit.data());
+			m_intersectionListStatistics = intersectionList.statistics();
+
+			// The marching variants on the same lists, they have to find the same surface as the sorted one with less work
+			std::vector<std::array<MarchStatistics, 3>> rowStatistics(viewportSize.y);
+			std::vector<std::array<std::size_t, 3>> rowMismatches(viewportSize.y);
+
+			ThreadPool::instance().parallelFor(std::size_t(viewportSize.y), [&](std::size_t y) {
+				for (int x = 0; x < viewportSize.x; x++) {
+					const auto entries = intersectionList.entries(ivec2(x, int(y)));
+					if (entries.empty())
+						continue;
+
+					const vec2 ndc = 2.0f * (vec2(float(x), float(y)) + 0.5f) / vec2(viewportSize) - 1.0f;
+					vec4 nearPosition = inverseModelViewProjectionMatrix * vec4(ndc, -1.0f, 1.0f);
+					nearPosition /= nearPosition.w;
+					vec4 farPosition = inverseModelViewProjectionMatrix * vec4(ndc, 1.0f, 1.0f);
+					farPosition /= farPosition.w;
+
+					const vec3 origin = vec3(nearPosition);
+					const vec3 direction = normalize(vec3(farPosition) - origin);
+					const float closestDistance = depthLimit[y * viewportSize.x + x];
+
+					const MarchResult sorted = marchSorted(entries, origin, direction, sharpness, closestDistance, rowStatistics[y][0]);
+					const MarchResult window = marchSlidingWindow(entries, origin, direction, sharpness, closestDistance, rowStatistics[y][1]);
+					const MarchResult lipschitz = marchSorted(entries, origin, direction, sharpness, closestDistance, rowStatistics[y][2], MarchStepping::Lipschitz);
+
+					if (std::abs(sorted.distance - window.distance) > 0.05f)
+						rowMismatches[y][1]++;
+
+					if (std::abs(sorted.distance - lipschitz.distance) > 0.05f)
+						rowMismatches[y][2]++;
+				}
+			}, 4);
+
+			m_referenceStatistics = {};
+			m_referenceMismatches = {};
+
+			for (int y = 0; y < viewportSize.y; y++) {
+				for (std::size_t variant = 0; variant < m_referenceStatistics.size(); variant++) {
+					m_referenceStatistics[variant] += rowStatistics[y][variant];
+					m_referenceMismatches[variant] += rowMismatches[y][variant];
+				}
+			}
+		});
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// Mesh export (on demand)
+	//////////////////////////////////////////////////////////////////////////
+	/** Extracts the surface of the current timestep with marching cubes and writes it as PLY or OBJ
+	 */
+	if (exportMesh)
+	{
+		exportMesh = false;
 
-		m_sphereLOD1PositionTexture->bindActive(3);
-		m_sphereLOD1NormalTexture->bindActive(4);
-		m_sphereLOD1PositionTextureNear->bindActive(5);
+		const char* filterExtensions[] = { "*.ply", "*.obj" };
+		const char* saveFileName = tinyfd_saveFileDialog("Export Mesh", "./surface.ply", 2, filterExtensions, "Mesh Files (*.ply, *.obj)");
+
+		if (saveFileName)
+		{
+			const double startTime = glfwGetTime();
+
+			const auto& atoms = viewer()->scene()->protein()->atoms()[currentTimestep];
+			GaussianDensity density(atoms, LODs[1].radius, sharpness, meshSpacing);
+			Mesh mesh = SurfaceMesher(density).marchingCubes();
+			const double meshTime = glfwGetTime();
+
+			if (mesh.write(saveFileName))
+				globjects::debug() << "Exported " << mesh.positions.size() << " vertices and " << mesh.triangles.size() << " triangles to " << saveFileName << " (meshing " << (meshTime - startTime) * 1000.0 << " ms, writing " << (glfwGetTime() - meshTime) * 1000.0 << " ms)";
+			else
+				globjects::critical() << "Could not write mesh to " << saveFileName;
+		}
 	}
 
-	m_vaoQuad->drawArrays(GL_POINTS, 0, 1);
+	//////////////////////////////////////////////////////////////////////////
+	// Density volume export and meshing (on demand)
+	//////////////////////////////////////////////////////////////////////////
+	/** Bakes the density of the current timestep into a sparse brick volume, or meshes a previously exported volume
+	 */
+	if (exportVolume)
+	{
+		exportVolume = false;
+
+		const char* filterExtensions[] = { "*.dmv" };
+		const char* saveFileName = tinyfd_saveFileDialog("Export Volume", "./density.dmv", 1, filterExtensions, "Density Volume Files (*.dmv)");
+
+		if (saveFileName)
+		{
+			const double startTime = glfwGetTime();
+
+			const auto& atoms = viewer()->scene()->protein()->atoms()[currentTimestep];
+			GaussianDensity density(atoms, LODs[1].radius, sharpness, meshSpacing);
+
+			// Keep enough bricks to re-mesh between half and twice the default isovalue
+			auto volume = DensityVolume::bake(density, volumeHalfPrecision, 0.5f * density.isovalue(), 2.0f * density.isovalue());
+			const double bakeTime = glfwGetTime();
 
-	if (!bSingleLOD) {
-		m_sphereLOD1PositionTextureNear->unbindActive(5);
-		m_sphereLOD1NormalTexture->unbindActive(4);
-		m_sphereLOD1PositionTexture->unbindActive(3);
+			if (volume->write(saveFileName))
+				globjects::debug() << "Exported " << volume->brickCount() << " bricks (" << volume->sizeInBytes() / 1024 << " KiB) to " << saveFileName << " (baking " << (bakeTime - startTime) * 1000.0 << " ms)";
+			else
+				globjects::critical() << "Could not write volume to " << saveFileName;
+		}
 	}
 
-	m_sphereLOD0PositionTextureNear->unbindActive(2);
-	m_sphereLOD0NormalTexture->unbindActive(1);
-	m_sphereLOD0PositionTexture->unbindActive(0);
-		
-	programSplitting->release();
+	if (meshVolume)
+	{
+		meshVolume = false;
+
+		const char* volumeExtensions[] = { "*.dmv" };
+		const char* openFileName = tinyfd_openFileDialog("Open Volume", "./", 1, volumeExtensions, "Density Volume Files (*.dmv)", 0);
+		auto volume = openFileName ? DensityVolume::load(openFileName) : nullptr;
+
+		if (openFileName && !volume)
+			globjects::critical() << "Could not load volume from " << openFileName;
+
+		const char* meshExtensions[] = { "*.ply", "*.obj" };
+		const char* saveFileName = volume ? tinyfd_saveFileDialog("Export Mesh", "./surface.ply", 2, meshExtensions, "Mesh Files (*.ply, *.obj)") : nullptr;
+
+		if (saveFileName)
+		{
+			const double startTime = glfwGetTime();
+			Mesh mesh = SurfaceMesher(*volume).marchingCubes();
 
-	m_sphereFramebuffer->unbind();
+			if (mesh.write(saveFileName))
+				globjects::debug() << "Exported " << mesh.triangles.size() << " triangles from " << volume->brickCount() << " bricks to " << saveFileName << " (meshing " << (glfwGetTime() - startTime) * 1000.0 << " ms)";
+			else
+				globjects::critical() << "Could not write mesh to " << saveFileName;
+		}
+	}
 
 	// //////////////////////////////////////////////////////////////////////////
 	// // Layer sphere rendering pass (for back position texture)
@@ -1332,182 +1997,805 @@ void SphereRenderer::display()
 	//////////////////////////////////////////////////////////////////////////
 	/** Generates an intersection list of the sphere's outer radius per pixel
 	 */
-	m_sphereFramebuffer->bind();
-	constexpr uint intersectionClearValue = 1;
-	constexpr uint offsetClearValue = 0;
-	// clear only the first intersection?
-	// m_intersectionBuffer->clearSubData(GL_R32UI, 0, sizeof(uint), GL_RED_INTEGER, GL_UNSIGNED_INT, &intersectionClearValue);
-
-
-	glMemoryBarrier(GL_ALL_BARRIER_BITS);
-
-	glDepthFunc(GL_ALWAYS);
-	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
-	glDepthMask(GL_FALSE);
+	constexpr uint pixelCountClearValue = 0;
+	const GLuint pixelCount = GLuint(viewportSize.x * viewportSize.y);
 
-	// Positions of fragments of spheres (only closest to camera)
-	// m_spherePositionTexture->bindActive(0);
-
-	m_intersectionCount[0]->clearSubData(GL_R32UI, 0, sizeof(uint), GL_RED_INTEGER, GL_UNSIGNED_INT, &intersectionClearValue);
-	m_offsetTexture[0]->clearImage(0, GL_RED_INTEGER, GL_UNSIGNED_INT, &offsetClearValue);
-
-	m_spherePositionTexture->bindActive(0);
-	m_spherePositionTextureNear->bindActive(1);
-	m_intersectionBuffer[0]->bindBase(GL_SHADER_STORAGE_BUFFER, 1);
-	m_intersectionCount[0]->bindBase(GL_ATOMIC_COUNTER_BUFFER, 1);
-	m_offsetTexture[0]->bindImageTexture(0, 0, false, 0, GL_READ_WRITE, GL_R32UI);
-	
+	// The compute path reads the static sphere positions, procedural animation is only done in the vertex shader.
+	// It bins one pair of levels for all atoms, so per-cluster levels are always rasterized.
+	const bool computeLists = listConstruction == 1 && !animated && !perClusterLOD;
+	// Culling tests the same positions and pairs, so it is not available with procedural animation or per-cluster levels
+	const bool cullSpheres = occlusionCulling && !computeLists && !animated && !perClusterLOD;
+	const ivec2 tileCount = (viewportSize + ivec2(ListTileSize - 1)) / ListTileSize;
+	const GLuint tileCountTotal = GLuint(tileCount.x * tileCount.y);
 
-	programSpawn->use();
-	
 	programSpawn->setUniform("modelViewMatrix", modelViewMatrix);
 	programSpawn->setUniform("projectionMatrix", projectionMatrix);
 	programSpawn->setUniform("modelViewProjectionMatrix", modelViewProjectionMatrix);
 	programSpawn->setUniform("inverseModelViewProjectionMatrix", inverseModelViewProjectionMatrix);
 	programSpawn->setUniform("nearPlaneZ", nearPlane.z);
-	programSpawn->setUniform("animationDelta", animationDelta);
+	programSpawn->setUniform("animationDelta", interpolateTrajectory ? animationDelta : 0.0f);
 	programSpawn->setUniform("animationTime", animationTime);
 	programSpawn->setUniform("animationAmplitude", animationAmplitude);
 	programSpawn->setUniform("animationFrequency", animationFrequency);
 	programSpawn->setUniform("gridScale", gridSize);
 	programSpawn->setUniform("minb", bounds.first);
 	programSpawn->setUniform("maxb", bounds.second);
-	programSpawn->setUniform("bucketSize", m_offsetBucketSize);
+	programSpawn->setUniform("framebufferSize", viewportSize);
+	programSpawn->setUniform("capacity", m_intersectionBuffer.capacity());
+
+	programTileFootprint->setUniform("modelViewMatrix", modelViewMatrix);
+	programTileFootprint->setUniform("projectionMatrix", projectionMatrix);
+	programTileFootprint->setUniform("nearPlaneZ", nearPlane.z);
+	programTileFootprint->setUniform("framebufferSize", viewportSize);
+	programTileFootprint->setUniform("tileCount", tileCount);
+
+	programTileFill->setUniform("tileCount", tileCount);
+	programTileFill->setUniform("capacity", m_tileSpheres.capacity());
+
+	programTileList->setUniform("inverseModelViewProjectionMatrix", inverseModelViewProjectionMatrix);
+	programTileList->setUniform("framebufferSize", viewportSize);
+	programTileList->setUniform("tileCount", tileCount);
+	programTileList->setUniform("capacity", m_intersectionBuffer.capacity());
+	programTileList->setUniform("tileCapacity", m_tileSpheres.capacity());
+
+	// Both passes have to produce exactly the same fragments
+	const auto drawSpawnLODs = [&]() {
+		m_intersectionBuffer.entries()->bindBase(GL_SHADER_STORAGE_BUFFER, 1);
+		m_pixelOffsets->bindBase(GL_SHADER_STORAGE_BUFFER, 3);
+		m_pixelCounts->bindBase(GL_SHADER_STORAGE_BUFFER, 4);
+
+		programSpawn->use();
+
+		// One blended level per cluster, weighted in sphere-gs.glsl
+		if (perClusterLOD) {
+			drawClusterLODs(programSpawn, [&](const LOD& level) {
+				glClear(GL_DEPTH_BUFFER_BIT);
+
+				programSpawn->setUniform("radiusScale", radiusScale * level.radius);
+				programSpawn->setUniform("outerRadius", level.radius);
+				programSpawn->setUniform("clipRadiusScale", radiusScale * level.radius);
+				programSpawn->setUniform("clustering", level.clustering(0.f));
+				programSpawn->setUniform("individualSharpness", level.sharpness(0.f));
+				programSpawn->setUniform("weight", 1.f);
+				programSpawn->setUniform("interpolation", 0.f);
+			});
+		}
 
-	for (auto [index, lod] : enumerate(getPairwiseLODs(interpolation))) {
-		if (lod == nullptr)
-			continue;
-		auto& [vao, vCount, scale, cluster, sharp] = *lod;
-		const auto interp = clampedInterpolation(interpolation);
-		const auto weight = index == 0 ? 1.f - interp : interp;
+		if (cullSpheres)
+			m_cullCommands->bind(GL_DRAW_INDIRECT_BUFFER);
+
+		// The pair of levels for all atoms, none with per-cluster levels
+		const auto spawnLODs = perClusterLOD ? decltype(getPairwiseLODs(interpolation)){} : getPairwiseLODs(interpolation);
+
+		for (auto [index, lod] : enumerate(spawnLODs)) {
+			if (lod == nullptr)
+				continue;
+			auto& [vao, vCount, scale, cluster, sharp] = *lod;
+			const auto interp = clampedInterpolation(interpolation);
+			const auto weight = index == 0 ? 1.f - interp : interp;
+
+			glClear(GL_DEPTH_BUFFER_BIT);
+
+			programSpawn->setUniform("radiusScale", radiusScale * scale); // Outer radius
+			programSpawn->setUniform("outerRadius", scale);
+			programSpawn->setUniform("clipRadiusScale", radiusScale * scale); // Also outer radius
+			programSpawn->setUniform("clustering", cluster(interp));
+			programSpawn->setUniform("individualSharpness", sharp(interp));
+			programSpawn->setUniform("weight", weight);
+			programSpawn->setUniform("interpolation", interp);
+
+			// Only the spheres that passed occlusion culling, in the order in which they passed
+			if (cullSpheres) {
+				vao->bindElementBuffer(m_cullIndices.get());
+				vao->drawElementsIndirect(GL_POINTS, GL_UNSIGNED_INT, reinterpret_cast<const void*>(std::uintptr_t(DrawCommandSize) * index));
+			}
+			else
+				vao->drawArrays(GL_POINTS, 0, vCount);
+		}
+
+		if (cullSpheres)
+			Buffer::unbind(GL_DRAW_INDIRECT_BUFFER);
+
+		programSpawn->release();
+
+		m_pixelCounts->unbind(GL_SHADER_STORAGE_BUFFER, 4);
+		m_pixelOffsets->unbind(GL_SHADER_STORAGE_BUFFER, 3);
+		m_intersectionBuffer.entries()->unbind(GL_SHADER_STORAGE_BUFFER, 1);
+	};
+
+	// Footprints of the spheres of both levels of detail, binned into tiles (count, scan, fill)
+	const auto binFootprints = [&]() {
+		m_tileCounts->clearData(GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &pixelCountClearValue);
+		m_footprints->bindBase(GL_SHADER_STORAGE_BUFFER, 5);
+		m_tileCounts->bindBase(GL_SHADER_STORAGE_BUFFER, 6);
+
+		programTileFootprint->use();
+
+		GLuint sphereOffset = 0;
+
+		for (auto [index, lod] : enumerate(getPairwiseLODs(interpolation))) {
+			if (lod == nullptr)
+				continue;
+			auto& [vao, vCount, scale, cluster, sharp] = *lod;
+			const auto interp = clampedInterpolation(interpolation);
+			const auto weight = index == 0 ? 1.f - interp : interp;
+
+			bindLODVertices(lod);
+
+			programTileFootprint->setUniform("radiusScale", radiusScale * scale);
+			programTileFootprint->setUniform("outerRadius", scale);
+			programTileFootprint->setUniform("clipRadiusScale", radiusScale * scale);
+			programTileFootprint->setUniform("clustering", cluster(interp));
+			programTileFootprint->setUniform("individualSharpness", sharp(interp));
+			programTileFootprint->setUniform("weight", weight);
+			programTileFootprint->setUniform("sphereCount", GLuint(vCount));
+			programTileFootprint->setUniform("sphereOffset", sphereOffset);
+			programTileFootprint->dispatchCompute((GLuint(vCount) + 255) / 256, 1, 1);
+
+			sphereOffset += GLuint(vCount);
+		}
+
+		programTileFootprint->release();
+
+		Buffer::unbind(GL_SHADER_STORAGE_BUFFER, 10);
+		Buffer::unbind(GL_SHADER_STORAGE_BUFFER, 0);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+		m_prefixSum.scan(programScanLocal, programScanAdd, m_tileCounts.get(), m_tileOffsets.get(), tileCountTotal + 1);
+		glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+		m_tileSpheres.readback(m_tileOffsets.get(), GLintptr(sizeof(uint)) * tileCountTotal);
+		m_tileCounts->clearData(GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &pixelCountClearValue);
+
+		m_tileSpheres.entries()->bindBase(GL_SHADER_STORAGE_BUFFER, 9);
+		m_tileOffsets->bindBase(GL_SHADER_STORAGE_BUFFER, 8);
+		m_tileCounts->bindBase(GL_SHADER_STORAGE_BUFFER, 6);
+		m_footprints->bindBase(GL_SHADER_STORAGE_BUFFER, 5);
+
+		programTileFill->setUniform("footprintCount", footprintCount);
+		programTileFill->use();
+		programTileFill->dispatchCompute((footprintCount + 255) / 256, 1, 1);
+		programTileFill->release();
+
+		m_tileCounts->unbind(GL_SHADER_STORAGE_BUFFER, 6);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	};
+
+	// Compute counterpart of drawSpawnLODs, one work group per tile
+	const auto traverseTiles = [&]() {
+		m_intersectionBuffer.entries()->bindBase(GL_SHADER_STORAGE_BUFFER, 1);
+		m_pixelOffsets->bindBase(GL_SHADER_STORAGE_BUFFER, 3);
+		m_pixelCounts->bindBase(GL_SHADER_STORAGE_BUFFER, 4);
+		m_footprints->bindBase(GL_SHADER_STORAGE_BUFFER, 5);
+		m_tileOffsets->bindBase(GL_SHADER_STORAGE_BUFFER, 8);
+		m_tileSpheres.entries()->bindBase(GL_SHADER_STORAGE_BUFFER, 9);
+
+		programTileList->use();
+		programTileList->dispatchCompute(GLuint(tileCount.x), GLuint(tileCount.y), 1);
+		programTileList->release();
+
+		m_tileSpheres.entries()->unbind(GL_SHADER_STORAGE_BUFFER, 9);
+		m_tileOffsets->unbind(GL_SHADER_STORAGE_BUFFER, 8);
+		m_footprints->unbind(GL_SHADER_STORAGE_BUFFER, 5);
+		m_pixelCounts->unbind(GL_SHADER_STORAGE_BUFFER, 4);
+		m_pixelOffsets->unbind(GL_SHADER_STORAGE_BUFFER, 3);
+		m_intersectionBuffer.entries()->unbind(GL_SHADER_STORAGE_BUFFER, 1);
+	};
+
+	//////////////////////////////////////////////////////////////////////////
+	// Occlusion culling
+	//////////////////////////////////////////////////////////////////////////
+	/** Spheres whose outer radius is behind the closest inner sphere over their whole footprint only produce fragments
+	 *  that the spawn pass discards. They are removed with a depth pyramid of the sphere pass before the lists are built.
+	 */
+	if (cullSpheres)
+	{
+		const mat4 transposedModelViewProjection = transpose(modelViewProjectionMatrix);
+		vec4 modelNearPlane = transposedModelViewProjection[3] + transposedModelViewProjection[2];
+		modelNearPlane /= length(vec3(modelNearPlane));
+
+		graph.addPass("Hi-Z", [&](Builder& builder) {
+			builder.read(spherePosition, Access::Sampled);
+			depthPyramid = builder.write(depthPyramid, Access::Image);
+		}, [&]() {
+			m_depthPyramid.build(programHiZ, graph.texture(spherePosition));
+		});
 
-		glClear(GL_DEPTH_BUFFER_BIT);
+		graph.addPass("Occlusion culling", [&](Builder& builder) {
+			builder.sample(depthPyramid, 1);
+			cullCommands = builder.write(cullCommands, Access::Transfer);
+			builder.write(cullCommands, Access::Storage);
+			cullIndices = builder.write(cullIndices, Access::Storage);
+		}, [&, modelNearPlane]() {
+			const auto lods = getPairwiseLODs(interpolation);
+			const auto interp = clampedInterpolation(interpolation);
+
+			// Empty draws with the index range of each level of detail, the counts are incremented by the culling
+			std::array<GLuint, 2 * DrawCommandSize / sizeof(GLuint)> commands = {};
+			GLuint indexOffset = 0;
+
+			for (auto [index, lod] : enumerate(lods)) {
+				GLuint* command = commands.data() + index * DrawCommandSize / sizeof(GLuint);
+				command[1] = 1;
+				command[2] = indexOffset;
+
+				if (lod != nullptr)
+					indexOffset += GLuint(lod->vCount);
+			}
 
-		programSpawn->setUniform("radiusScale", radiusScale * scale); // Outer radius
-		programSpawn->setUniform("outerRadius", scale);
-		programSpawn->setUniform("clipRadiusScale", radiusScale * scale); // Also outer radius
-		programSpawn->setUniform("clustering", cluster(interp));
-		programSpawn->setUniform("individualSharpness", sharp(interp));
-		programSpawn->setUniform("weight", weight);
-		programSpawn->setUniform("interpolation", interp);
+			m_cullCommands->setSubData(0, GLsizeiptr(sizeof(commands)), commands.data());
+			m_cullIndices->bindBase(GL_SHADER_STORAGE_BUFFER, 11);
+			m_cullCommands->bindBase(GL_SHADER_STORAGE_BUFFER, 12);
+
+			programOcclusionCull->setUniform("modelViewMatrix", modelViewMatrix);
+			programOcclusionCull->setUniform("projectionMatrix", projectionMatrix);
+			programOcclusionCull->setUniform("nearPlaneZ", nearPlane.z);
+			programOcclusionCull->setUniform("nearPlane", modelNearPlane);
+			programOcclusionCull->setUniform("framebufferSize", viewportSize);
+			programOcclusionCull->setUniform("levels", m_depthPyramid.levels());
+			programOcclusionCull->use();
+
+			for (auto [index, lod] : enumerate(lods)) {
+				if (lod == nullptr)
+					continue;
+				auto& [vao, vCount, scale, cluster, sharp] = *lod;
+
+				bindLODVertices(lod);
+
+				// Outer radius of the spawn pass
+				programOcclusionCull->setUniform("radiusScale", radiusScale * scale);
+				programOcclusionCull->setUniform("clipRadiusScale", radiusScale * scale);
+				programOcclusionCull->setUniform("clustering", cluster(interp));
+				programOcclusionCull->setUniform("animationDelta", lod == &LODs[1] && streamedVertices && interpolateTrajectory ? animationDelta : 0.0f);
+				programOcclusionCull->setUniform("sphereCount", GLuint(vCount));
+				programOcclusionCull->setUniform("command", GLuint(index));
+				programOcclusionCull->setUniform("indexOffset", commands[index * DrawCommandSize / sizeof(GLuint) + 2]);
+				programOcclusionCull->dispatchCompute((GLuint(vCount) + 255) / 256, 1, 1);
+			}
 
+			programOcclusionCull->release();
 
-		vao->drawArrays(GL_POINTS, 0, vCount);
+			Buffer::unbind(GL_SHADER_STORAGE_BUFFER, 12);
+			Buffer::unbind(GL_SHADER_STORAGE_BUFFER, 11);
+			Buffer::unbind(GL_SHADER_STORAGE_BUFFER, 10);
+			Buffer::unbind(GL_SHADER_STORAGE_BUFFER, 0);
+
+			// Statistics only, skipped while an earlier read back is in flight
+			if (!m_cullReadbackFence)
+			{
+				glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+				m_cullCommands->copySubData(m_cullReadback.get(), 0, 0, DrawCommandSize * 2);
+				m_cullReadbackFence = Sync::fence(GL_SYNC_GPU_COMMANDS_COMPLETE);
+				m_cullPendingSpheres = indexOffset;
+			}
+		});
 	}
 
-	m_spherePositionTextureNear->unbindActive(1);
-	m_spherePositionTexture->unbindActive(0);
-	m_offsetTexture[0]->unbindImageTexture(0);
-	m_intersectionCount[0]->unbind(GL_ATOMIC_COUNTER_BUFFER);
-	m_intersectionBuffer[0]->unbind(GL_SHADER_STORAGE_BUFFER);
-		
-	programSpawn->release();
+	const std::function<void()> generateLists = computeLists ? std::function<void()>(traverseTiles) : std::function<void()>(drawSpawnLODs);
+	const auto programLists = computeLists ? programTileList : programSpawn;
+	GpuTimer& listTimer = computeLists ? m_computeListTimer : m_rasterListTimer;
+
+	// The buffers are bound by the list functions, they are used by several programs with different bindings
+	graph.addPass("Lists", [&](Builder& builder) {
+		builder.sample(spherePosition, 0);
+		builder.depthAttachment(depth, GL_READ_ONLY);
+
+		pixelCounts = builder.write(pixelCounts, Access::Transfer);
+		builder.write(pixelCounts, Access::Storage);
+		pixelOffsets = builder.write(pixelOffsets, Access::Storage);
+		intersections = builder.write(intersections, Access::Storage);
+
+		if (computeLists) {
+			footprints = builder.write(footprints, Access::Storage);
+			tileCounts = builder.write(tileCounts, Access::Transfer);
+			builder.write(tileCounts, Access::Storage);
+			tileOffsets = builder.write(tileOffsets, Access::Storage);
+			tileSpheres = builder.write(tileSpheres, Access::Storage);
+		}
 
-	glMemoryBarrier(GL_ALL_BARRIER_BITS);
+		if (cullSpheres) {
+			builder.read(cullCommands, Access::Indirect);
+			builder.read(cullIndices, Access::Vertex);
+		}
 
-	m_sphereFramebuffer->unbind();
+		if (perClusterLOD) {
+			builder.read(clusterCommands, Access::Indirect);
+			builder.read(clusterWeights, Access::Vertex);
+		}
+	}, [&]() {
+		glDepthFunc(GL_ALWAYS);
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		glDepthMask(GL_FALSE);
+
+		m_pixelCounts->clearData(GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &pixelCountClearValue);
+
+		listTimer.begin();
+
+		if (computeLists)
+			binFootprints();
+
+		// Count entries per pixel
+		programLists->setUniform("countPass", true);
+		generateLists();
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+		// Exclusive scan of the counts, the extra element at the end receives the total which is read back to size the intersection buffer
+		m_prefixSum.scan(programScanLocal, programScanAdd, m_pixelCounts.get(), m_pixelOffsets.get(), pixelCount + 1);
+		glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+		m_intersectionBuffer.readback(m_pixelOffsets.get(), GLintptr(sizeof(uint)) * pixelCount);
+
+		// Fill the per-pixel ranges, the counts are reset to serve as write cursors
+		m_pixelCounts->clearData(GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &pixelCountClearValue);
+		programLists->setUniform("countPass", false);
+		generateLists();
+
+		listTimer.end();
+	});
 
 	//////////////////////////////////////////////////////////////////////////
 	// Surface intersection pass
 	//////////////////////////////////////////////////////////////////////////
-	
-	(bVisualizeOverlaps ? m_shadeFramebuffer : m_surfaceFramebuffer)->bind();
-	// Framebuffer::defaultFBO()->bind();
+	GpuTimer& surfaceTimer = tiledSurface ? m_tiledSurfaceTimer : m_surfaceTimer;
+
+	// The overlap visualization is written straight into the color target
+	RenderGraph::Resource overlapColor;
+
+	const auto setSurfaceUniforms = [&]() {
+		programSurface->setUniform("modelViewMatrix", modelViewMatrix);
+		programSurface->setUniform("projectionMatrix", projectionMatrix);
+		programSurface->setUniform("modelViewProjectionMatrix", modelViewProjectionMatrix);
+		programSurface->setUniform("inverseModelViewProjectionMatrix", inverseModelViewProjectionMatrix);
+		programSurface->setUniform("normalMatrix", normalMatrix);
+		programSurface->setUniform("lightPosition", vec3(worldLightPosition));
+		programSurface->setUniform("ambientMaterial", ambientMaterial);
+		programSurface->setUniform("diffuseMaterial", diffuseMaterial);
+		programSurface->setUniform("specularMaterial", specularMaterial);
+		programSurface->setUniform("shininess", shininess);
+		programSurface->setUniform("focusPosition", focusPosition);
+		programSurface->setUniform("sharpness", sharpness);
+		programSurface->setUniform("coloring", uint(coloring));
+		programSurface->setUniform("environment", environmentShading);
+		programSurface->setUniform("lens", lens);
+		programSurface->setUniform("compactGBuffer", compactSurface);
+		programSurface->setUniform("interpolation", clampedInterpolation(interpolation));
+		programSurface->setUniform("framebufferSize", viewportSize);
+		programSurface->setUniform("capacity", m_intersectionBuffer.capacity());
+		programSurface->setUniform("temporalReuse", temporalReuse);
+		programSurface->setUniform("temporalFrame", m_temporalHistory.frame());
+		programSurface->setUniform("temporalPeriod", temporalPeriod);
+		programSurface->setUniform("previousModelViewProjectionMatrix", previousModelViewProjectionMatrix);
+		programSurface->setUniform("historyNormalMatrix", historyNormalMatrix);
+		programSurface->setUniform("pixelFootprint", pixelFootprint);
+
+		programSurface->setUniform("gridScale", gridSize);
+		programSurface->setUniform("gridDepth", gridDepth);
+		programSurface->setUniform("minb", bounds.first);
+		programSurface->setUniform("maxb", bounds.second);
+		const auto t = float(glfwGetTime());
+		programSurface->setUniform("time", t);
+	};
 
-	glMemoryBarrier(GL_ALL_BARRIER_BITS);
-	
-	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-	glDepthMask(GL_TRUE);
+	// Marched subset of the pixels for the reconstruction by the surface pass
+	std::array<RenderGraph::Resource, 3> sparseSurface;
 
-	glClearDepth(1.0f);
-	glClearColor(0.0f, 0.0f, 0.0f, 65535.0f);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	if (interleavedSurface)
+	{
+		sparseSurface = {
+			graph.createTexture("Sparse surface position", GL_RGBA32F, m_framebufferSize),
+			graph.createTexture("Sparse surface normal", GL_RGBA32F, m_framebufferSize),
+			graph.createTexture("Sparse surface diffuse", GL_RGBA32F, m_framebufferSize)
+		};
+
+		graph.addPass("Sparse surface", [&](Builder& builder) {
+			builder.storage(intersections, 1, GL_READ_ONLY);
+			builder.storage(pixelOffsets, 3, GL_READ_ONLY);
+			builder.sample(spherePosition, 2);
+			builder.sample(sphereNormal, 3);
+
+			if (temporalReuse) {
+				builder.sample(historyPosition, 4);
+				builder.sample(historyNormal, 5);
+				builder.sample(historyDiffuse, 6);
+			}
 
-	// m_spherePositionTexture->bindActive(0);
-	// m_sphereNormalTexture->bindActive(1);
-	m_offsetTexture[0]->bindActive(0);
-	m_offsetTexture[1]->bindActive(1);
-	m_intersectionBuffer[0]->bindBase(GL_SHADER_STORAGE_BUFFER, 1);
-	m_intersectionBuffer[1]->bindBase(GL_SHADER_STORAGE_BUFFER, 2);
-	m_intersectionCount[0]->bindBase(GL_ATOMIC_COUNTER_BUFFER, 1);
-	m_intersectionCount[1]->bindBase(GL_ATOMIC_COUNTER_BUFFER, 2);
-	// m_statisticsBuffer->bindBase(GL_SHADER_STORAGE_BUFFER, 2);
-	m_spherePositionTexture->bindActive(2);
-	m_sphereNormalTexture->bindActive(3);
-	// m_sphereLOD1PositionTexture->bindActive(4);
-	// m_sphereLOD1NormalTexture->bindActive(5);
-
-	programSurface->setUniform("modelViewMatrix", modelViewMatrix);
-	programSurface->setUniform("projectionMatrix", projectionMatrix);
-	programSurface->setUniform("modelViewProjectionMatrix", modelViewProjectionMatrix);
-	programSurface->setUniform("inverseModelViewProjectionMatrix", inverseModelViewProjectionMatrix);
-	programSurface->setUniform("normalMatrix", normalMatrix);
-	programSurface->setUniform("lightPosition", vec3(worldLightPosition));
-	programSurface->setUniform("ambientMaterial", ambientMaterial);
-	programSurface->setUniform("diffuseMaterial", diffuseMaterial);
-	programSurface->setUniform("specularMaterial", specularMaterial);
-	programSurface->setUniform("shininess", shininess);
-	programSurface->setUniform("focusPosition", focusPosition);
-	programSurface->setUniform("sharpness", sharpness);
-	programSurface->setUniform("coloring", uint(coloring));
-	programSurface->setUniform("environment", environmentMapping);
-	programSurface->setUniform("lens", lens);
-	programSurface->setUniform("interpolation", clampedInterpolation(interpolation));
-
-	programSurface->setUniform("gridScale", gridSize);
-	programSurface->setUniform("gridDepth", gridDepth);
-	programSurface->setUniform("minb", bounds.first);
-	programSurface->setUniform("maxb", bounds.second);
-	const auto t = float(glfwGetTime());
-	programSurface->setUniform("time", t);
-
-	m_vaoQuad->bind();
-	programSurface->use();
-	m_vaoQuad->drawArrays(GL_POINTS, 0, 1);
-	programSurface->release();
-	m_vaoQuad->unbind();
+			for (GLuint index = 0; index < sparseSurface.size(); index++)
+				sparseSurface[index] = builder.colorAttachment(sparseSurface[index], index);
+		}, [&]() {
+			glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+			glClearColor(0.0f, 0.0f, 0.0f, 65535.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
+
+			// Timed together with the reconstruction
+			m_surfaceTimer.begin();
+
+			setSurfaceUniforms();
+			programSurface->setUniform("interleaving", GLuint(surfaceInterleaving));
+			programSurface->setUniform("reconstruct", false);
+
+			m_vaoQuad->bind();
+			programSurface->use();
+			m_vaoQuad->drawArrays(GL_POINTS, 0, 1);
+			programSurface->release();
+			m_vaoQuad->unbind();
+		});
+	}
+
+	graph.addPass("Surface", [&](Builder& builder) {
+		builder.storage(intersections, 1, GL_READ_ONLY);
+		builder.storage(pixelOffsets, 3, GL_READ_ONLY);
+		builder.sample(spherePosition, 2);
+		builder.sample(sphereNormal, 3);
+		depth = builder.depthAttachment(depth, GL_WRITE_ONLY);
+
+		if (interleavedSurface) {
+			builder.sample(sparseSurface[0], 7);
+			builder.sample(sparseSurface[1], 8);
+			builder.sample(sparseSurface[2], 9);
+		}
+		else if (temporalReuse) {
+			builder.sample(historyPosition, 4);
+			builder.sample(historyNormal, 5);
+			builder.sample(historyDiffuse, 6);
+		}
+
+		if (visualizeOverlaps) {
+			color = builder.colorAttachment(color, 0);
+			overlapColor = color;
+		}
+		else {
+			if (!compactSurface)
+				surfacePosition = builder.colorAttachment(surfacePosition, 0);
+
+			surfaceNormal = builder.colorAttachment(surfaceNormal, 1);
+			surfaceDiffuse = builder.colorAttachment(surfaceDiffuse, 2);
+			sphereDiffuse = builder.colorAttachment(sphereDiffuse, 3);
+		}
 
-	m_intersectionBuffer[1]->unbind(GL_SHADER_STORAGE_BUFFER);
-	m_intersectionBuffer[0]->unbind(GL_SHADER_STORAGE_BUFFER);
-	m_intersectionCount[1]->unbind(GL_ATOMIC_COUNTER_BUFFER);
-	m_intersectionCount[0]->unbind(GL_ATOMIC_COUNTER_BUFFER);
+		if (tiledSurface) {
+			// The images are bound by the pass, the positions are read back for the depth
+			builder.write(surfacePosition, Access::Image);
+			builder.write(surfaceNormal, Access::Image);
+			builder.write(surfaceDiffuse, Access::Image);
 
-	m_sphereNormalTexture->unbindActive(3);
-	m_spherePositionTexture->unbindActive(2);
+			if (computeLists) {
+				builder.read(footprints, Access::Storage);
+				builder.read(tileOffsets, Access::Storage);
+				builder.read(tileSpheres, Access::Storage);
+			}
+			else {
+				footprints = builder.write(footprints, Access::Storage);
+				tileCounts = builder.write(tileCounts, Access::Transfer);
+				builder.write(tileCounts, Access::Storage);
+				tileOffsets = builder.write(tileOffsets, Access::Storage);
+				tileSpheres = builder.write(tileSpheres, Access::Storage);
+			}
+		}
+
+		if (measuringIterations) {
+			statistics = builder.write(statistics, Access::Transfer);
+			builder.write(statistics, Access::Storage);
+		}
+	}, [&]() {
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		glDepthMask(GL_TRUE);
+
+		glClearDepth(1.0f);
+		glClearColor(0.0f, 0.0f, 0.0f, 65535.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	// m_sphereLOD1NormalTexture->unbindActive(5);
-	// m_sphereLOD1PositionTexture->unbindActive(4);
-	// m_sphereLOD0NormalTexture->unbindActive(3);
-	// m_sphereLOD0PositionTexture->unbindActive(2);
-	m_offsetTexture[1]->unbindActive(1);
-	m_offsetTexture[0]->unbindActive(0);;
+		if (!interleavedSurface)
+			surfaceTimer.begin();
 
-	m_chainColors->unbind(GL_UNIFORM_BUFFER);
-	m_residueColors->unbind(GL_UNIFORM_BUFFER);
-	m_elementColorsRadii->unbind(GL_UNIFORM_BUFFER);
+		if (tiledSurface)
+		{
+			if (!computeLists)
+				binFootprints();
+
+			m_footprints->bindBase(GL_SHADER_STORAGE_BUFFER, 5);
+			m_tileOffsets->bindBase(GL_SHADER_STORAGE_BUFFER, 8);
+			m_tileSpheres.entries()->bindBase(GL_SHADER_STORAGE_BUFFER, 9);
+			graph.texture(surfacePosition)->bindImageTexture(0, 0, false, 0, GL_WRITE_ONLY, GL_RGBA32F);
+			graph.texture(surfaceNormal)->bindImageTexture(1, 0, false, 0, GL_WRITE_ONLY, GL_RGBA32F);
+			graph.texture(surfaceDiffuse)->bindImageTexture(2, 0, false, 0, GL_WRITE_ONLY, GL_RGBA32F);
+
+			programSurfaceTile->setUniform("modelViewMatrix", modelViewMatrix);
+			programSurfaceTile->setUniform("inverseModelViewProjectionMatrix", inverseModelViewProjectionMatrix);
+			programSurfaceTile->setUniform("normalMatrix", normalMatrix);
+			programSurfaceTile->setUniform("eyePosition", vec3(inverseModelViewMatrix * vec4(0.0f, 0.0f, 0.0f, 1.0f)));
+			programSurfaceTile->setUniform("sharpness", sharpness);
+			programSurfaceTile->setUniform("framebufferSize", viewportSize);
+			programSurfaceTile->setUniform("tileCount", tileCount);
+			programSurfaceTile->setUniform("tileCapacity", m_tileSpheres.capacity());
+			programSurfaceTile->setUniform("capacity", m_intersectionBuffer.capacity());
+
+			programSurfaceTile->use();
+			programSurfaceTile->dispatchCompute(GLuint(tileCount.x), GLuint(tileCount.y), 1);
+			programSurfaceTile->release();
+
+			graph.texture(surfaceDiffuse)->unbindImageTexture(2);
+			graph.texture(surfaceNormal)->unbindImageTexture(1);
+			graph.texture(surfacePosition)->unbindImageTexture(0);
+			m_tileSpheres.entries()->unbind(GL_SHADER_STORAGE_BUFFER, 9);
+			m_tileOffsets->unbind(GL_SHADER_STORAGE_BUFFER, 8);
+			m_footprints->unbind(GL_SHADER_STORAGE_BUFFER, 5);
+
+			glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+			// Depth of the surface for the following passes, only the depth attachment is written
+			glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			graph.texture(surfacePosition)->bindImageTexture(0, 0, false, 0, GL_READ_ONLY, GL_RGBA32F);
+
+			programSurfaceDepth->setUniform("modelViewProjectionMatrix", modelViewProjectionMatrix);
+
+			m_vaoQuad->bind();
+			programSurfaceDepth->use();
+			m_vaoQuad->drawArrays(GL_POINTS, 0, 1);
+			programSurfaceDepth->release();
+			m_vaoQuad->unbind();
+
+			graph.texture(surfacePosition)->unbindImageTexture(0);
+			glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		}
+		else
+		{
+			// Pixels without entries are discarded before writing their statistics
+			const std::size_t statisticsSize = sizeof(uvec4) * std::size_t(viewportSize.x) * viewportSize.y;
 
-	if (!bVisualizeOverlaps) {
-		m_surfaceFramebuffer->unbind();
+			if (measuringIterations)
+			{
+				const GLuint statisticsClearValue = 0;
+				m_statisticsBuffer->setData(GLsizeiptr(statisticsSize), nullptr, GL_STREAM_READ);
+				m_statisticsBuffer->clearData(GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &statisticsClearValue);
+				m_statisticsBuffer->bindBase(GL_SHADER_STORAGE_BUFFER, 2);
+			}
 
+			// m_sphereLOD1PositionTexture->bindActive(4);
+			// m_sphereLOD1NormalTexture->bindActive(5);
 
-		//////////////////////////////////////////////////////////////////////////
-		// Shading
-		//////////////////////////////////////////////////////////////////////////
-		m_shadeFramebuffer->bind();
-		glDepthMask(GL_FALSE);
+			setSurfaceUniforms();
+			programSurface->setUniform("interleaving", interleavedSurface ? GLuint(surfaceInterleaving) : GLuint(0));
+			programSurface->setUniform("reconstruct", interleavedSurface);
 
-		m_spherePositionTexture->bindActive(0);
-		m_sphereNormalTexture->bindActive(1);
-		m_sphereDiffuseTexture->bindActive(2);
-		m_surfacePositionTexture->bindActive(3);
-		m_surfaceNormalTexture->bindActive(4);
-		m_surfaceDiffuseTexture->bindActive(5);
-		m_depthTexture->bindActive(6);
-		m_ambientTexture->bindActive(7);
-		m_materialTextures[materialTextureIndex]->bindActive(8);
-		m_environmentTextures[environmentTextureIndex]->bindActive(9);
-		m_shadowColorTexture->bindActive(10);
-		m_shadowDepthTexture->bindActive(11);
+			if (interleavedSurface)
+				programSurface->setUniform("temporalReuse", false);
+
+			m_vaoQuad->bind();
+			programSurface->use();
+			m_vaoQuad->drawArrays(GL_POINTS, 0, 1);
+			programSurface->release();
+			m_vaoQuad->unbind();
+
+			if (measuringIterations)
+			{
+				measureIterations = false;
+				m_statisticsBuffer->unbind(GL_SHADER_STORAGE_BUFFER, 2);
+				glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+				std::vector<uvec4> pixelStatistics(statisticsSize / sizeof(uvec4));
+				m_statisticsBuffer->getSubData(0, GLsizeiptr(statisticsSize), pixelStatistics.data());
+
+				m_surfaceStatistics = {};
+
+				for (const uvec4& pixel : pixelStatistics) {
+					if (pixel.x == 0)
+						continue;
+
+					m_surfaceStatistics.pixels++;
+					m_surfaceStatistics.sortComparisons += pixel.y;
+					m_surfaceStatistics.marchSteps += pixel.z;
+					m_surfaceStatistics.atomEvaluations += pixel.w;
+					m_surfaceStatistics.maximumMarchSteps = std::max<std::size_t>(m_surfaceStatistics.maximumMarchSteps, pixel.z);
+				}
+			}
+		}
+
+		surfaceTimer.end();
+
+		// m_sphereLOD1NormalTexture->unbindActive(5);
+		// m_sphereLOD1PositionTexture->unbindActive(4);
+		// m_sphereLOD0NormalTexture->unbindActive(3);
+		// m_sphereLOD0PositionTexture->unbindActive(2);
+
+		m_chainColors->unbind(GL_UNIFORM_BUFFER);
+		m_residueColors->unbind(GL_UNIFORM_BUFFER);
+		m_elementColorsRadii->unbind(GL_UNIFORM_BUFFER);
+	});
+
+	// Full precision targets of this frame against what the compact G-buffer would store for them
+	if (compareGBuffer && !visualizeOverlaps)
+	{
+		graph.addPass("G-buffer comparison", [&](Builder& builder) {
+			builder.read(surfacePosition, Access::Transfer);
+			builder.read(surfaceNormal, Access::Transfer);
+			builder.read(depth, Access::Transfer);
+			builder.sideEffect();
+		}, [&]() {
+			compareGBuffer = false;
+
+			const std::size_t pixelCount = std::size_t(m_framebufferSize.x) * m_framebufferSize.y;
+			std::vector<vec4> positions(pixelCount);
+			std::vector<vec4> normals(pixelCount);
+			std::vector<float> depths(pixelCount);
+
+			graph.texture(surfacePosition)->getImage(0, GL_RGBA, GL_FLOAT, positions.data());
+			graph.texture(surfaceNormal)->getImage(0, GL_RGBA, GL_FLOAT, normals.data());
+			graph.texture(depth)->getImage(0, GL_DEPTH_COMPONENT, GL_FLOAT, depths.data());
+			cropToViewport(positions);
+			cropToViewport(normals);
+			cropToViewport(depths);
+
+			m_gbufferComparison = compareCompactGBuffer(positions, normals, depths, viewportSize, inverseModelViewProjectionMatrix);
+		});
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// Shading
+	//////////////////////////////////////////////////////////////////////////
+	// Scalable ambient obscurance from the view space normals and depths of the surface pass. With reprojection the
+	// pixels whose surface was visible in the last frame are only marked and resolved from the history afterwards.
+	// At a reduced resolution only the occlusion is sampled into a single channel target, blurred there and upsampled
+	// with weights that respect the depth and normal of the surface.
+	// Without the full precision surface an unoccluded target keeps AMBIENT shading neutral.
+	const ivec2 ambientSize = (viewportSize + ambientDivisor - 1) / ambientDivisor;
+	const ivec2 ambientTargetSize = (m_framebufferSize + ambientDivisor - 1) / ambientDivisor;
+	RenderGraph::Resource ambientSamples = ambient;
+	RenderGraph::Resource ambientBlur;
+
+	if (ambientSampling)
+	{
+		if (ambientDivisor > 1) {
+			ambientSamples = graph.createTexture("Reduced ambient", GL_R8, ambientTargetSize);
+			ambientBlur = graph.createTexture("Reduced ambient blur", GL_R8, ambientTargetSize);
+		}
+		else if (temporalAmbient) {
+			ambientSamples = graph.createTexture("Ambient samples", GL_RGBA32F, m_framebufferSize);
+		}
+
+		graph.addPass("Ambient occlusion", [&](Builder& builder) {
+			builder.sample(surfaceNormal, 0);
+			builder.sample(surfacePosition, 1);
+
+			if (temporalAmbient)
+				builder.sample(historyPosition, 2);
+
+			ambientSamples = builder.colorAttachment(ambientSamples, 0);
+		}, [&]() {
+			glViewport(0, 0, ambientSize.x, ambientSize.y);
+
+			programAOSample->setUniform("surfaceNormalTexture", 0);
+			programAOSample->setUniform("surfacePositionTexture", 1);
+			programAOSample->setUniform("historyPositionTexture", 2);
+			programAOSample->setUniform("projectionInfo", projectionInfo);
+			programAOSample->setUniform("projectionScale", projectionScale);
+			programAOSample->setUniform("viewLightPosition", vec3(viewLightPosition));
+			programAOSample->setUniform("temporalReuse", temporalAmbient);
+			programAOSample->setUniform("temporalFrame", m_temporalHistory.frame());
+			programAOSample->setUniform("temporalPeriod", temporalPeriod);
+			programAOSample->setUniform("previousModelViewProjectionMatrix", previousModelViewProjectionMatrix);
+			programAOSample->setUniform("pixelFootprint", pixelFootprint);
+			programAOSample->setUniform("framebufferSize", viewportSize);
+			programAOSample->setUniform("resolutionDivisor", ambientDivisor);
+
+			m_vaoQuad->bind();
+			programAOSample->use();
+			m_vaoQuad->drawArrays(GL_POINTS, 0, 1);
+			programAOSample->release();
+			m_vaoQuad->unbind();
+
+			glViewport(0, 0, viewportSize.x, viewportSize.y);
+		});
+
+		if (ambientDivisor > 1)
+		{
+			// Separable blur of the sampling noise, the second direction writes back into the samples
+			for (const ivec2 direction : { ivec2(1, 0), ivec2(0, 1) })
+			{
+				const bool horizontal = direction.x > 0;
+
+				graph.addPass(horizontal ? "Ambient blur horizontal" : "Ambient blur vertical", [&, horizontal](Builder& builder) {
+					builder.sample(surfaceNormal, 0);
+
+					if (horizontal) {
+						builder.sample(ambientSamples, 1);
+						ambientBlur = builder.colorAttachment(ambientBlur, 0);
+					}
+					else {
+						builder.sample(ambientBlur, 1);
+						ambientSamples = builder.colorAttachment(ambientSamples, 0);
+					}
+				}, [&, direction]() {
+					glViewport(0, 0, ambientSize.x, ambientSize.y);
+
+					programAOBlur->setUniform("direction", direction);
+					programAOBlur->setUniform("resolutionDivisor", ambientDivisor);
+					programAOBlur->setUniform("ambientSize", ambientSize);
+					programAOBlur->setUniform("framebufferSize", viewportSize);
+
+					m_vaoQuad->bind();
+					programAOBlur->use();
+					m_vaoQuad->drawArrays(GL_POINTS, 0, 1);
+					programAOBlur->release();
+					m_vaoQuad->unbind();
+
+					glViewport(0, 0, viewportSize.x, viewportSize.y);
+				});
+			}
+
+			graph.addPass("Ambient upsampling", [&](Builder& builder) {
+				builder.sample(surfaceNormal, 0);
+				builder.sample(ambientSamples, 1);
+				ambient = builder.colorAttachment(ambient, 0);
+			}, [&]() {
+				programAOUpsample->setUniform("resolutionDivisor", ambientDivisor);
+				programAOUpsample->setUniform("ambientSize", ambientSize);
+				programAOUpsample->setUniform("framebufferSize", viewportSize);
+
+				m_vaoQuad->bind();
+				programAOUpsample->use();
+				m_vaoQuad->drawArrays(GL_POINTS, 0, 1);
+				programAOUpsample->release();
+				m_vaoQuad->unbind();
+			});
+		}
+		else if (temporalAmbient)
+		{
+			graph.addPass("Ambient reprojection", [&](Builder& builder) {
+				builder.sample(ambientSamples, 0);
+				builder.sample(surfacePosition, 1);
+				builder.sample(historyAmbient, 2);
+				ambient = builder.colorAttachment(ambient, 0);
+			}, [&]() {
+				programAOTemporal->setUniform("previousModelViewProjectionMatrix", previousModelViewProjectionMatrix);
+				programAOTemporal->setUniform("framebufferSize", viewportSize);
+
+				m_vaoQuad->bind();
+				programAOTemporal->use();
+				m_vaoQuad->drawArrays(GL_POINTS, 0, 1);
+				programAOTemporal->release();
+				m_vaoQuad->unbind();
+			});
+		}
+		else
+		{
+			ambient = ambientSamples;
+		}
+	}
+	else
+	{
+		graph.addPass("Ambient", [&](Builder& builder) {
+			ambient = builder.write(ambient, Access::Transfer);
+		}, [&]() {
+			const vec4 ambientClearValue(0.0f, 0.0f, 0.0f, 1.0f);
+			graph.texture(ambient)->clearImage(0, GL_RGBA, GL_FLOAT, &ambientClearValue);
+		});
+	}
+
+	const auto material = graph.importTexture("Material", m_materialTextures[materialTextureIndex].get());
+	const auto environment = graph.importTexture("Environment", m_environmentTextures[environmentTextureIndex].get());
+	const auto shadowColor = graph.importTexture("Shadow color", m_shadowColorTexture.get());
+	const auto shadowDepth = graph.importTexture("Shadow depth", m_shadowDepthTexture.get());
+
+	// Culled together with the ambient pass when the overlap visualization is displayed instead
+	graph.addPass("Shading", [&](Builder& builder) {
+		builder.sample(spherePosition, 0);
+		builder.sample(sphereNormal, 1);
+		builder.sample(sphereDiffuse, 2);
+
+		if (!compactSurface)
+			builder.sample(surfacePosition, 3);
+
+		builder.sample(surfaceNormal, 4);
+		builder.sample(surfaceDiffuse, 5);
+		builder.sample(depth, 6);
+		builder.sample(ambient, 7);
+		builder.sample(material, 8);
+		builder.sample(environment, 9);
+		builder.sample(shadowColor, 10);
+		builder.sample(shadowDepth, 11);
+
+		builder.depthAttachment(depth, GL_READ_ONLY);
+		color = builder.colorAttachment(color, 0);
+	}, [&]() {
+		glDepthMask(GL_FALSE);
 
 		programShade->setUniform("modelViewMatrix", modelViewMatrix);
 		programShade->setUniform("projectionMatrix", projectionMatrix);
@@ -1543,7 +2831,8 @@ void SphereRenderer::display()
 		programShade->setUniform("shadowColorTexture", 10);
 		programShade->setUniform("shadowDepthTexture", 11);
 
-		programShade->setUniform("environment", environmentMapping);
+		programShade->setUniform("environment", environmentShading);
+		programShade->setUniform("compactGBuffer", compactSurface);
 		programShade->setUniform("maximumCoCRadius", maximumCoCRadius);
 		programShade->setUniform("aparture", aparture);
 		programShade->setUniform("focalDistance", focalDistance);
@@ -1556,23 +2845,7 @@ void SphereRenderer::display()
 		m_vaoQuad->drawArrays(GL_POINTS, 0, 1);
 		programShade->release();
 		m_vaoQuad->unbind();
-
-		m_shadowDepthTexture->unbindActive(11);
-		m_shadowColorTexture->unbindActive(10);
-		m_environmentTextures[environmentTextureIndex]->unbindActive(9);
-		m_materialTextures[materialTextureIndex]->unbindActive(8);
-		m_ambientTexture->unbindActive(7);
-		m_depthTexture->unbindActive(6);
-		m_surfaceDiffuseTexture->unbindActive(5);
-		m_surfaceNormalTexture->unbindActive(4);
-		m_surfacePositionTexture->unbindActive(3);
-		m_sphereDiffuseTexture->unbindActive(2);
-		m_sphereNormalTexture->unbindActive(1);
-		m_spherePositionTexture->unbindActive(0);
-	}
-
-	m_shadeFramebuffer->unbind();
-
+	});
 
 	// Draw test square
 	// Framebuffer::defaultFBO()->bind();
@@ -1599,32 +2872,56 @@ void SphereRenderer::display()
 	// m_spherePositionTextureNear->unbindActive(1);
 	// m_spherePositionTexture->unbindActive(0);
 
-	if (viewportSize == viewer()->viewportSize())
-	{
-		// Blit final image into visible framebuffer
-		m_shadeFramebuffer->blit(GL_COLOR_ATTACHMENT0, { 0,0,viewer()->viewportSize().x, viewer()->viewportSize().y }, Framebuffer::defaultFBO().get(), GL_BACK, { 0,0,viewer()->viewportSize().x, viewer()->viewportSize().y }, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, GL_NEAREST);
-	}
-	else
-	{
-		m_colorTexture->bindActive(0);
-		m_depthTexture->bindActive(1);
+	// Final image into the visible framebuffer, scaled if the resolution is reduced
+	const auto displayColor = visualizeOverlaps ? overlapColor : color;
+	const bool blitDisplay = viewportSize == viewer()->viewportSize();
 
-		glViewport(0, 0, viewer()->viewportSize().x, viewer()->viewportSize().y);
-		glDepthMask(GL_TRUE);
+	graph.addPass("Display", [&](Builder& builder) {
+		if (blitDisplay) {
+			builder.read(displayColor, Access::Transfer);
+			builder.read(depth, Access::Transfer);
+		}
+		else {
+			builder.sample(displayColor, 0);
+			builder.sample(depth, 1);
+		}
 
-		programDisplay->setUniform("colorTexture", 0);
-		programDisplay->setUniform("depthTexture", 1);
+		builder.sideEffect();
+	}, [&]() {
+		if (blitDisplay)
+		{
+			m_displayFramebuffer->attachTexture(GL_COLOR_ATTACHMENT0, graph.texture(displayColor));
+			m_displayFramebuffer->attachTexture(GL_DEPTH_ATTACHMENT, graph.texture(depth));
 
-		m_vaoQuad->bind();
-		programDisplay->use();
-		m_vaoQuad->drawArrays(GL_POINTS, 0, 1);
-		programDisplay->release();
-		m_vaoQuad->unbind();
+			// Blit final image into visible framebuffer
+			m_displayFramebuffer->blit(GL_COLOR_ATTACHMENT0, { 0,0,viewer()->viewportSize().x, viewer()->viewportSize().y }, Framebuffer::defaultFBO().get(), GL_BACK, { 0,0,viewer()->viewportSize().x, viewer()->viewportSize().y }, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+		}
+		else
+		{
+			glViewport(0, 0, viewer()->viewportSize().x, viewer()->viewportSize().y);
+			glDepthMask(GL_TRUE);
+
+			programDisplay->setUniform("colorTexture", 0);
+			programDisplay->setUniform("depthTexture", 1);
+			programDisplay->setUniform("sourceSize", viewportSize);
+
+			m_vaoQuad->bind();
+			programDisplay->use();
+			m_vaoQuad->drawArrays(GL_POINTS, 0, 1);
+			programDisplay->release();
+			m_vaoQuad->unbind();
+		}
+	});
 
-		m_depthTexture->unbindActive(1);
-		m_colorTexture->unbindActive(0);
+	// The display pass sets the viewport of the window itself
+	glViewport(0, 0, viewportSize.x, viewportSize.y);
+	graph.execute(m_renderTargets, &m_profiler);
 
-	}
+	if (temporalSurface)
+		m_temporalHistory.end(modelViewProjectionMatrix, normalMatrix);
+
+	if (streamedVertices)
+		m_atomStream->fence();
 
 	// Restore OpenGL state
 	currentState->apply();
@@ -1,6 +1,20 @@
 #pragma once
 #include "Renderer.h"
+#include "IntersectionList.h"
+#include "IntersectionBuffer.h"
+#include "PrefixSum.h"
+#include "GpuTimer.h"
+#include "GpuProfiler.h"
+#include "RenderTargetPool.h"
+#include "RenderGraph.h"
+#include "SurfaceMarching.h"
+#include "CompactGBuffer.h"
+#include "StreamingBuffer.h"
+#include "DepthPyramid.h"
+#include "DynamicResolution.h"
+#include "TemporalHistory.h"
 #include <memory>
+#include <optional>
 #include <array>
 
 #include <glm/glm.hpp>
@@ -18,6 +32,7 @@
 #include <globjects/Texture.h>
 #include <globjects/base/File.h>
 #include <globjects/TextureHandle.h>
+#include <globjects/Sync.h>
 #include <globjects/NamedString.h>
 #include <globjects/base/StaticStringSource.h>
 
@@ -37,7 +52,19 @@ namespace dynamol
 
 		static std::unique_ptr<globjects::Texture> loadTexture(const std::string& filename);
 
+		// Timestep and atom radius of the last displayed frame, so that other renderers can show the same atoms
+		glm::uint currentTimestep() const;
+		float atomRadius() const;
+
 	private:
+		// Tile size of the compute list construction, matches the work group size of tile-list-cs.glsl
+		static constexpr int ListTileSize = 16;
+		// Size of Footprint in tile-footprint-cs.glsl with std430 layout
+		static constexpr gl::GLuint FootprintSize = 48;
+		// Size of DrawCommand in occlusion-cull-cs.glsl, one per level of detail of a pair
+		static constexpr gl::GLuint DrawCommandSize = 20;
+		// Size of DrawCommand in cluster-lod-cs.glsl, one per cluster and level of detail
+		static constexpr gl::GLuint ArraysCommandSize = 16;
 		
 		std::vector< std::unique_ptr<globjects::Buffer> > m_vertices;
 		std::unique_ptr<globjects::VertexArray> m_vao = std::make_unique<globjects::VertexArray>();
@@ -50,46 +77,61 @@ namespace dynamol
 		
 		std::unique_ptr<globjects::StaticStringSource> m_shaderSourceDefines = nullptr;
 		std::unique_ptr<globjects::NamedString> m_shaderDefines = nullptr;
+		// Defines whose neighbouring permutations have been queued for background compilation
+		std::optional<std::string> m_precompiledDefines;
 
-		std::array<std::unique_ptr<globjects::Buffer>, 2> m_intersectionBuffer{ std::make_unique<globjects::Buffer>(), std::make_unique<globjects::Buffer>() };
-		std::array<std::unique_ptr<globjects::Buffer>, 2> m_intersectionCount{ std::make_unique<globjects::Buffer>(), std::make_unique<globjects::Buffer>() };
+		IntersectionBuffer m_intersectionBuffer;
+		// Per-pixel surface pass statistics (entries, sort comparisons, march steps, atom evaluations), written on demand
 		std::unique_ptr<globjects::Buffer> m_statisticsBuffer = std::make_unique<globjects::Buffer>();
-		std::array<std::unique_ptr<globjects::Texture>, 2> m_offsetTexture{nullptr, nullptr};
-		std::unique_ptr<globjects::Texture> m_depthTexture = nullptr;
-		std::unique_ptr<globjects::Texture> m_LOD0depthTexture{nullptr},
-											m_LOD1depthTexture{nullptr};
-		std::unique_ptr<globjects::Texture> m_depthStencilTexture = nullptr;
-		std::unique_ptr<globjects::Texture> m_spherePositionTexture{nullptr}, m_spherePositionTextureNear{nullptr},
-									m_sphereLOD0PositionTexture{nullptr}, m_sphereLOD0PositionTextureNear{nullptr},
-									m_sphereLOD1PositionTexture{nullptr}, m_sphereLOD1PositionTextureNear{nullptr};
-		std::unique_ptr<globjects::Texture> m_sphereNormalTexture = nullptr;
-		std::unique_ptr<globjects::Texture> m_sphereLOD0NormalTexture{nullptr},
-											m_sphereLOD1NormalTexture{nullptr},
-											m_sphereLOD0NormalTextureNear{nullptr},
-											m_sphereLOD1NormalTextureNear{nullptr};
-		std::unique_ptr<globjects::Texture> m_surfacePositionTexture = nullptr;
-		std::unique_ptr<globjects::Texture> m_surfaceNormalTexture = nullptr;
-		std::unique_ptr<globjects::Texture> m_sphereDiffuseTexture = nullptr;
-		std::unique_ptr<globjects::Texture> m_surfaceDiffuseTexture = nullptr;
-		std::unique_ptr<globjects::Texture> m_ambientTexture = nullptr;
-		std::unique_ptr<globjects::Texture> m_blurTexture = nullptr;
-		std::unique_ptr<globjects::Texture> m_colorTexture = nullptr;
+		// Per-pixel entry counts (reused as write cursors) and their exclusive scan, both with one element per pixel plus one
+		std::unique_ptr<globjects::Buffer> m_pixelCounts = nullptr;
+		std::unique_ptr<globjects::Buffer> m_pixelOffsets = nullptr;
+		PrefixSum m_prefixSum;
+		// Compute list construction: sphere footprints, their per-tile counts and offsets and the per-tile footprint indices
+		std::unique_ptr<globjects::Buffer> m_footprints = nullptr;
+		gl::GLuint m_footprintCapacity = 0;
+		std::unique_ptr<globjects::Buffer> m_tileCounts = nullptr;
+		std::unique_ptr<globjects::Buffer> m_tileOffsets = nullptr;
+		IntersectionBuffer m_tileSpheres{ IntersectionBuffer::MinimumCapacity, sizeof(gl::GLuint) };
+		// Occlusion culling before the spawn pass: depth pyramid of the sphere pass, indices of the remaining spheres and
+		// the indirect draws of both levels of detail, whose counts are read back without waiting for statistics
+		DepthPyramid m_depthPyramid;
+		std::unique_ptr<globjects::Buffer> m_cullIndices = nullptr;
+		gl::GLuint m_cullCapacity = 0;
+		std::unique_ptr<globjects::Buffer> m_cullCommands = std::make_unique<globjects::Buffer>();
+		std::unique_ptr<globjects::Buffer> m_cullReadback = std::make_unique<globjects::Buffer>();
+		const gl::GLuint* m_cullReadbackData = nullptr;
+		std::unique_ptr<globjects::Sync> m_cullReadbackFence;
+		gl::GLuint m_cullPendingSpheres = 0;
+		gl::GLuint m_cullSpawnedSpheres = 0;
+		gl::GLuint m_cullTestedSpheres = 0;
+		// Per-cluster level of detail: the indirect draws of every level per cluster, the level weights of the clusters
+		// and the number of clusters that draw each level, read back like the culling counts
+		gl::GLuint m_clusterCount = 0;
+		std::unique_ptr<globjects::Buffer> m_clusterCommands = std::make_unique<globjects::Buffer>();
+		std::unique_ptr<globjects::Buffer> m_clusterWeights = std::make_unique<globjects::Buffer>();
+		std::unique_ptr<globjects::Buffer> m_clusterLevels = std::make_unique<globjects::Buffer>();
+		std::unique_ptr<globjects::Buffer> m_clusterReadback = std::make_unique<globjects::Buffer>();
+		const gl::GLuint* m_clusterReadbackData = nullptr;
+		std::unique_ptr<globjects::Sync> m_clusterReadbackFence;
+		std::array<gl::GLuint, 3> m_clusterLevelCounts = {};
+		GpuTimer m_rasterListTimer;
+		GpuTimer m_computeListTimer;
+		GpuTimer m_surfaceTimer;
+		GpuTimer m_tiledSurfaceTimer;
+		GpuProfiler m_profiler;
+		// Scale of the automatic resolution, the targets keep the size of its maximum
+		DynamicResolution m_dynamicResolution;
+		// Surface and ambient occlusion of the last frame, reprojected to skip recomputing most pixels
+		TemporalHistory m_temporalHistory;
+		// Full resolution targets, acquired from the pool by the render graph for the passes of a frame that use them
+		RenderTargetPool m_renderTargets;
+		RenderGraph m_renderGraph;
 		std::unique_ptr<globjects::Texture> m_shadowColorTexture = nullptr;
 		std::unique_ptr<globjects::Texture> m_shadowDepthTexture = nullptr;
 
-		std::unique_ptr<globjects::Framebuffer> m_sphereFramebuffer{nullptr},
-												m_sphereLOD0Framebuffer{globjects::Framebuffer::create()},
-												m_sphereLOD0FramebufferNear{globjects::Framebuffer::create()},
-												m_sphereLOD1Framebuffer{globjects::Framebuffer::create()},
-												m_sphereLOD1FramebufferNear{globjects::Framebuffer::create()};
-		std::unique_ptr<globjects::Framebuffer> m_sphereSplitFramebuffer{nullptr};
-		std::unique_ptr<globjects::Framebuffer> m_surfaceFramebuffer = nullptr;
-		std::unique_ptr<globjects::Framebuffer> m_ambientFramebuffer = nullptr;
-		std::unique_ptr<globjects::Framebuffer> m_shadeFramebuffer = nullptr;
-		std::unique_ptr<globjects::Framebuffer> m_aoFramebuffer = nullptr;
-		std::unique_ptr<globjects::Framebuffer> m_aoBlurFramebuffer = nullptr;
-		std::unique_ptr<globjects::Framebuffer> m_dofFramebuffer = nullptr;
-		std::unique_ptr<globjects::Framebuffer> m_dofBlurFramebuffer = nullptr;
+		// Blit source for the final image, the framebuffers of the passes are managed by the render graph
+		std::unique_ptr<globjects::Framebuffer> m_displayFramebuffer = nullptr;
 		std::unique_ptr<globjects::Framebuffer> m_shadowFramebuffer = nullptr;
 
 		std::vector< std::unique_ptr<globjects::Texture> > m_environmentTextures;
@@ -98,18 +140,30 @@ namespace dynamol
 
 		glm::ivec2 m_shadowMapSize = glm::ivec2(512, 512);
 		glm::ivec2 m_framebufferSize;
-		unsigned int m_offsetBucketSize = 64u;
 
 		std::unique_ptr<globjects::Buffer> m_sceneGraphBuffer, m_denseAtomVertices, m_hiarchyVertices,
 											m_sparseAtomVertices, m_triangleVertices;
 		std::unique_ptr<globjects::VertexArray> m_denseVAO = std::make_unique<globjects::VertexArray>();
 		std::unique_ptr<globjects::VertexArray> m_sparseVAO, m_triangleVAO, m_redrawingVAO, m_gridToPointVAO;
 		gl::GLsizei m_denseVertexCount{0}, m_sparseVertexCount{0};
+		// LOD0 vertices with the atom positions of the current timestep, created when streaming is enabled
+		std::unique_ptr<StreamingBuffer> m_atomStream;
+		glm::uint m_streamedTimestep = glm::uint(-1);
+		glm::uint m_currentTimestep = 0;
+		float m_atomRadius = 1.7f;
 		const glm::uint gridSize;
 		const glm::uint gridDepth;
 
 		std::unique_ptr<globjects::Buffer> m_redrawCounter, m_initialGridPoints;
 		std::array<std::unique_ptr<globjects::Buffer>, 2> m_redrawIndices;
+
+		IntersectionList::Statistics m_intersectionListStatistics;
+		// Surface pass work per pixel measured with ITERATION_STATISTICS, and the marching variants on the CPU lists
+		MarchStatistics m_surfaceStatistics;
+		std::array<MarchStatistics, 3> m_referenceStatistics;
+		std::array<std::size_t, 3> m_referenceMismatches = {};
+		// Error of the compact G-buffer encodings on the last compared frame
+		GBufferComparison m_gbufferComparison;
 	};
 
 }
\ No newline at end of file
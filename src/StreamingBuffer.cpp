@@ -0,0 +1,134 @@
+#include "StreamingBuffer.h"
+
+#include <globjects/logging.h>
+
+#include <algorithm>
+
+using namespace dynamol;
+using namespace gl;
+using namespace globjects;
+
+namespace
+{
+	// Wait in steps of a millisecond so that a lost context does not hang forever without a message
+	constexpr GLuint64 waitTimeout = 1000000;
+	constexpr std::size_t warnAfterWaits = 1000;
+}
+
+StreamingBuffer::StreamingBuffer(std::size_t frameSize) :
+	m_frameSize(frameSize)
+{
+	GLint alignment = 1;
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	alignment = std::max(alignment, 16);
+
+	m_frameStride = (std::max<std::size_t>(frameSize, 1) + std::size_t(alignment) - 1) / std::size_t(alignment) * std::size_t(alignment);
+
+	const GLsizeiptr size = GLsizeiptr(m_frameStride * Frames);
+	m_buffer->setStorage(size, nullptr, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+	m_data = static_cast<std::byte*>(m_buffer->mapRange(0, size, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT));
+
+	if (m_data == nullptr)
+		globjects::critical() << "Mapping of the streaming buffer failed (" << size << " bytes)";
+}
+
+Buffer* StreamingBuffer::buffer() const
+{
+	return m_buffer.get();
+}
+
+std::size_t StreamingBuffer::frameSize() const
+{
+	return m_frameSize;
+}
+
+std::size_t StreamingBuffer::frameStride() const
+{
+	return m_frameStride;
+}
+
+GLintptr StreamingBuffer::offset(std::size_t age) const
+{
+	age = std::min(age, ReadableFrames - 1);
+	return GLintptr((m_currentFrame + Frames - age) % Frames * m_frameStride);
+}
+
+std::size_t StreamingBuffer::readableFrames() const
+{
+	return m_readableFrames;
+}
+
+std::span<std::byte> StreamingBuffer::acquire()
+{
+	if (m_data == nullptr)
+		return {};
+
+	// Readable frames are never written, so a consumer always sees complete ones
+	if (!m_acquired)
+	{
+		m_writeFrame = m_readableFrames > 0 ? (m_currentFrame + 1) % Frames : m_currentFrame;
+		m_acquired = true;
+	}
+
+	if (auto& fence = m_fences[m_writeFrame])
+	{
+		GLenum status = fence->clientWait(GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+		{
+			m_stalls++;
+
+			for (std::size_t waits = 1; status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED; waits++)
+			{
+				if (status == GL_WAIT_FAILED)
+				{
+					globjects::critical() << "Waiting for a streaming buffer frame failed";
+					break;
+				}
+
+				if (waits == warnAfterWaits)
+					globjects::warning() << "Waiting for the GPU to release a streaming buffer frame for more than a second";
+
+				status = fence->clientWait(GL_SYNC_FLUSH_COMMANDS_BIT, waitTimeout);
+			}
+		}
+
+		fence.reset();
+	}
+
+	return { m_data + m_writeFrame * m_frameStride, m_frameSize };
+}
+
+void StreamingBuffer::commit()
+{
+	if (!m_acquired)
+		return;
+
+	// The mapping is coherent, writes are visible to commands issued after this point
+	m_currentFrame = m_writeFrame;
+	m_readableFrames = std::min(m_readableFrames + 1, ReadableFrames);
+	m_acquired = false;
+	m_committedFrames++;
+}
+
+void StreamingBuffer::fence()
+{
+	if (m_readableFrames == 0)
+		return;
+
+	// A newer fence also covers the earlier reads of the same frames
+	const std::shared_ptr<Sync> fence = Sync::fence(GL_SYNC_GPU_COMMANDS_COMPLETE);
+
+	for (std::size_t age = 0; age < m_readableFrames; age++)
+		m_fences[(m_currentFrame + Frames - age) % Frames] = fence;
+}
+
+std::size_t StreamingBuffer::committedFrames() const
+{
+	return m_committedFrames;
+}
+
+std::size_t StreamingBuffer::stalls() const
+{
+	return m_stalls;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <span>
+
+#include <glbinding/gl/gl.h>
+#include <globjects/Buffer.h>
+#include <globjects/Sync.h>
+
+namespace dynamol
+{
+	// Ring of Frames equally sized frames in one persistently and coherently mapped buffer, for data that changes
+	// every frame such as streamed atom positions. The last ReadableFrames committed frames can be read at the same
+	// time, e.g. two consecutive timesteps for interpolation. The CPU writes the next frame while the GPU still reads
+	// the previous ones, a fence per frame tells when a frame can be overwritten. The GPU may still be drawing the last
+	// Frames - ReadableFrames frames when the next one is written, writing only waits if it is further behind.
+	class StreamingBuffer
+	{
+	public:
+		static constexpr std::size_t ReadableFrames = 2;
+		static constexpr std::size_t Frames = ReadableFrames + 2;
+
+		explicit StreamingBuffer(std::size_t frameSize);
+
+		globjects::Buffer* buffer() const;
+		std::size_t frameSize() const;
+		// Distance between frames, aligned so that frames can be bound as shader storage ranges
+		std::size_t frameStride() const;
+
+		// Offset of the frame committed age commits before the most recent one, age < ReadableFrames
+		gl::GLintptr offset(std::size_t age = 0) const;
+		// Number of frames that can be read, up to ReadableFrames
+		std::size_t readableFrames() const;
+
+		// Waits until the GPU is done with the frame that is written next and returns its mapped memory.
+		// The memory can be filled from any thread, acquire() and commit() need the thread of the context.
+		std::span<std::byte> acquire();
+		void commit();
+
+		// After the last command that reads the readable frames, they are not overwritten before these have finished
+		void fence();
+
+		std::size_t committedFrames() const;
+		// Acquires that had to wait for the GPU
+		std::size_t stalls() const;
+
+	private:
+		std::unique_ptr<globjects::Buffer> m_buffer = globjects::Buffer::create();
+		std::byte* m_data = nullptr;
+		// Shared by the frames that were readable when the fence was placed
+		std::array<std::shared_ptr<globjects::Sync>, Frames> m_fences;
+
+		std::size_t m_frameSize = 0;
+		std::size_t m_frameStride = 0;
+		std::size_t m_currentFrame = 0;
+		std::size_t m_writeFrame = 0;
+		std::size_t m_readableFrames = 0;
+		bool m_acquired = false;
+		std::size_t m_committedFrames = 0;
+		std::size_t m_stalls = 0;
+	};
+}
@@ -0,0 +1,293 @@
+#include "SurfaceMarching.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+using namespace dynamol;
+using namespace glm;
+
+namespace
+{
+	// Sphere tracing parameters of surface-fs.glsl
+	constexpr uint maximumEntries = 128;
+	constexpr uint maximumSteps = 32;
+	constexpr float eps = 0.0125f;
+	constexpr float omega = 1.2f;
+
+
+	using Entry = IntersectionList::Entry;
+
+	// Sorting state shared by both variants, indices and near distances are swapped together as in the shader
+	struct EntryOrder
+	{
+		std::span<const Entry> entries;
+		uint count = 0;
+		std::array<uint, maximumEntries> indices;
+		std::array<float, maximumEntries> nearDistances;
+
+		explicit EntryOrder(std::span<const Entry> entries) :
+			entries(entries), count(uint(std::min<std::size_t>(entries.size(), maximumEntries)))
+		{
+			for (uint i = 0; i < count; i++)
+			{
+				indices[i] = i;
+				nearDistances[i] = entries[i].near;
+			}
+		}
+
+		// One step of the selection sort, moves the smallest of [index, count) to index
+		void selectMinimum(uint index, MarchStatistics& statistics)
+		{
+			uint minimumIndex = index;
+
+			for (uint i = index + 1; i < count; i++)
+				if (nearDistances[i] < nearDistances[minimumIndex])
+					minimumIndex = i;
+
+			statistics.sortComparisons += count - index - 1;
+
+			if (minimumIndex != index)
+			{
+				std::swap(indices[minimumIndex], indices[index]);
+				std::swap(nearDistances[minimumIndex], nearDistances[index]);
+			}
+		}
+
+		const Entry& operator[](uint index) const
+		{
+			return entries[indices[index]];
+		}
+	};
+
+	struct FieldSample
+	{
+		float distance; // distance estimate sqrt(-log(f) / s) - 1 in units of the radius, negative inside
+		float lipschitz; // Lipschitz constant of the estimate in world units, 0 for relaxed stepping
+		vec3 normal;
+	};
+
+	// Signed distance estimate to the surface from the entries in [begin, end)
+	FieldSample surfaceDistance(const EntryOrder& order, uint begin, uint end, const vec3& position, float s, MarchStepping stepping, MarchStatistics& statistics)
+	{
+		float sumValue = 0.0f;
+		float sumWeight = 0.0f;
+		float minimumRadius = std::numeric_limits<float>::max();
+		vec3 sumNormal(0.0f);
+
+		for (uint j = begin; j < end; j++)
+		{
+			const Entry& entry = order[j];
+
+			const vec3 atomOffset = position - entry.center;
+			const float atomDistanceSquared = dot(atomOffset, atomOffset) / (entry.radius * entry.radius);
+
+			const float atomValue = std::exp(-s * atomDistanceSquared) * entry.weight;
+			sumValue += atomValue;
+			sumNormal += atomValue * normalize(atomOffset);
+			sumWeight += entry.weight;
+			minimumRadius = std::min(minimumRadius, entry.radius);
+		}
+
+		statistics.marchSteps++;
+		statistics.atomEvaluations += end - begin;
+
+		const float distance = std::sqrt(-std::log(sumValue) / s) - 1.0f;
+
+		// Outside of the surface the gradient of sqrt(-log(f) / s) is bounded by sqrt(1 + log(W) / s) / r for a window
+		// with total weight W and smallest radius r, the bound of a single sphere (W = 1) being exact
+		if (stepping == MarchStepping::Lipschitz)
+			return { distance, std::sqrt(1.0f + std::log(std::max(sumWeight, 1.0f)) / s) / minimumRadius, sumNormal };
+
+		return { distance, 0.0f, sumNormal };
+	}
+
+	float stepLength(const FieldSample& sample)
+	{
+		return sample.lipschitz > 0.0f ? sample.distance / sample.lipschitz : sample.distance * omega;
+	}
+
+	// With a Lipschitz bound the estimate cannot drop to the surface before farDistance if this holds
+	bool unreachable(const FieldSample& sample, float t, float farDistance)
+	{
+		return sample.lipschitz > 0.0f && sample.distance > sample.lipschitz * (farDistance - t);
+	}
+}
+
+MarchStatistics& MarchStatistics::operator+=(const MarchStatistics& other)
+{
+	pixels += other.pixels;
+	sortComparisons += other.sortComparisons;
+	marchSteps += other.marchSteps;
+	atomEvaluations += other.atomEvaluations;
+	maximumMarchSteps = std::max(maximumMarchSteps, other.maximumMarchSteps);
+	return *this;
+}
+
+MarchResult dynamol::marchSorted(std::span<const Entry> entries, const vec3& origin, const vec3& direction, float sharpness, float closestDistance, MarchStatistics& statistics, MarchStepping stepping)
+{
+	EntryOrder order(entries);
+	MarchResult result{ closestDistance, vec3(0.0f) };
+
+	const std::size_t stepsBefore = statistics.marchSteps;
+	statistics.pixels++;
+
+	uint startIndex = 0;
+	uint endIndex = 0;
+
+	for (uint currentIndex = 0; currentIndex <= order.count; ++currentIndex)
+	{
+		if (currentIndex + 1 < order.count)
+			order.selectMinimum(currentIndex, statistics);
+
+		while (endIndex < currentIndex && order[endIndex].near <= order[startIndex].far)
+			++endIndex;
+
+		if (endIndex < order.count && order[endIndex].near <= order[startIndex].far)
+			continue;
+
+		if (startIndex >= order.count)
+			break;
+
+		const float nearDistance = order[startIndex].near;
+		const float farDistance = order[endIndex - 1].far;
+
+		float minimumDistance = farDistance - nearDistance;
+		float candidateDistance = nearDistance;
+		vec3 candidateNormal(0.0f);
+
+		uint currentStep = 0;
+		float t = nearDistance;
+
+		while (++currentStep <= maximumSteps && t <= farDistance)
+		{
+			if (t > result.distance)
+				break;
+
+			const FieldSample sample = surfaceDistance(order, startIndex, endIndex, origin + direction * t, sharpness, stepping, statistics);
+
+			if (sample.distance < eps)
+			{
+				result = { t, sample.normal };
+				break;
+			}
+
+			if (unreachable(sample, t, farDistance))
+				break;
+
+			if (sample.distance < minimumDistance)
+			{
+				minimumDistance = sample.distance;
+				candidateDistance = t;
+				candidateNormal = sample.normal;
+			}
+
+			t += stepLength(sample);
+		}
+
+		if (currentStep > maximumSteps)
+			result = { candidateDistance, candidateNormal };
+
+		++startIndex;
+	}
+
+	statistics.maximumMarchSteps = std::max(statistics.maximumMarchSteps, statistics.marchSteps - stepsBefore);
+	return result;
+}
+
+MarchResult dynamol::marchSlidingWindow(std::span<const Entry> entries, const vec3& origin, const vec3& direction, float sharpness, float closestDistance, MarchStatistics& statistics, MarchStepping stepping)
+{
+	EntryOrder order(entries);
+	MarchResult result{ closestDistance, vec3(0.0f) };
+
+	const std::size_t stepsBefore = statistics.marchSteps;
+	statistics.pixels++;
+
+	// Entries in [0, sortedCount) are in their final order
+	uint sortedCount = 0;
+
+	const auto sortThrough = [&](uint index) {
+		while (sortedCount <= index && sortedCount < order.count)
+			order.selectMinimum(sortedCount++, statistics);
+	};
+
+	uint startIndex = 0;
+	uint endIndex = 0;
+	float t = 0.0f;
+
+	uint groupSteps = 0;
+	float minimumDistance = std::numeric_limits<float>::max();
+	float candidateDistance = 0.0f;
+	vec3 candidateNormal(0.0f);
+
+	sortThrough(0);
+
+	while (startIndex < order.count)
+	{
+		// Drop entries the ray has already left
+		while (startIndex < order.count && order[startIndex].far < t)
+			sortThrough(++startIndex);
+
+		if (startIndex >= order.count)
+			break;
+
+		// Jump over gaps, which start a new group of overlapping entries
+		if (t < order[startIndex].near)
+		{
+			t = order[startIndex].near;
+			groupSteps = 0;
+			minimumDistance = std::numeric_limits<float>::max();
+		}
+
+		// Extend the window by all entries that start before the first one ends
+		endIndex = std::max(endIndex, startIndex + 1);
+
+		while (endIndex < order.count)
+		{
+			sortThrough(endIndex);
+
+			if (order[endIndex].near >= order[startIndex].far)
+				break;
+
+			endIndex++;
+		}
+
+		if (t > result.distance)
+			break;
+
+		const FieldSample sample = surfaceDistance(order, startIndex, endIndex, origin + direction * t, sharpness, stepping, statistics);
+
+		if (sample.distance < eps)
+		{
+			result = { t, sample.normal };
+			break;
+		}
+
+		// Nothing to find before the first entry of the window ends, continue just behind it
+		if (unreachable(sample, t, order[startIndex].far))
+		{
+			t = order[startIndex].far + eps;
+			continue;
+		}
+
+		if (sample.distance < minimumDistance)
+		{
+			minimumDistance = sample.distance;
+			candidateDistance = t;
+			candidateNormal = sample.normal;
+		}
+
+		if (++groupSteps >= maximumSteps)
+		{
+			result = { candidateDistance, candidateNormal };
+			break;
+		}
+
+		t += stepLength(sample);
+	}
+
+	statistics.maximumMarchSteps = std::max(statistics.maximumMarchSteps, statistics.marchSteps - stepsBefore);
+	return result;
+}
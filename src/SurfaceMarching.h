@@ -0,0 +1,45 @@
+#pragma once
+
+#include "IntersectionList.h"
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <span>
+
+namespace dynamol
+{
+	// Work done for one or more pixels, gathered in the same way by surface-fs.glsl with ITERATION_STATISTICS
+	struct MarchStatistics
+	{
+		std::size_t pixels = 0;
+		std::size_t sortComparisons = 0;
+		std::size_t marchSteps = 0;
+		std::size_t atomEvaluations = 0;
+		std::size_t maximumMarchSteps = 0;
+
+		MarchStatistics& operator+=(const MarchStatistics& other);
+	};
+
+	// Step size of the sphere tracing, LIPSCHITZ_STEPPING in surface-fs.glsl
+	enum class MarchStepping
+	{
+		Relaxed, // over-relaxed steps from the distance estimate of the field, may overshoot thin features
+		Lipschitz // conservative steps of the distance estimate divided by its Lipschitz constant over the window
+	};
+
+	struct MarchResult
+	{
+		// Distance along the ray, unchanged from the start value if no closer surface was found
+		float distance = 0.0f;
+		glm::vec3 normal = glm::vec3(0.0f);
+	};
+
+	// Sphere tracing of one pixel as in surface-fs.glsl. Entries are the unsorted list of the pixel, of which the
+	// first 128 are used, closestDistance is the distance of the inner sphere hit (w of the sphere position texture).
+	// The default variant selection-sorts the whole list while it walks over groups of overlapping entries.
+	MarchResult marchSorted(std::span<const IntersectionList::Entry> entries, const glm::vec3& origin, const glm::vec3& direction, float sharpness, float closestDistance, MarchStatistics& statistics, MarchStepping stepping = MarchStepping::Relaxed);
+
+	// SLIDING_WINDOW variant: keeps a window of entries around the current ray position and only sorts as far as
+	// the window has been extended, so entries behind the surface are never sorted (algorithm_sketch.md)
+	MarchResult marchSlidingWindow(std::span<const IntersectionList::Entry> entries, const glm::vec3& origin, const glm::vec3& direction, float sharpness, float closestDistance, MarchStatistics& statistics, MarchStepping stepping = MarchStepping::Relaxed);
+}
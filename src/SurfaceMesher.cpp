@@ -0,0 +1,369 @@
+#include "SurfaceMesher.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+using namespace dynamol;
+using namespace glm;
+
+namespace
+{
+	constexpr int BlockSize = DensityField::BlockSize;
+	constexpr int PointSize = BlockSize + 1;
+
+	ivec3 cornerOffset(int corner)
+	{
+		return ivec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1);
+	}
+
+	// Edges as pairs of corners, grouped by axis so that edge / 4 is the axis of the edge
+	constexpr std::array<std::array<int, 2>, 12> cubeEdges = { {
+		{ 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 },
+		{ 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 },
+		{ 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }
+	} };
+
+	// Triangle table generated from the cube topology instead of being spelled out. On every face the contour segments
+	// separate the inside corners, walking the segments from edge to edge gives closed polygons which are fanned into
+	// triangles. Ambiguous faces are resolved the same way by both cells sharing them, so the result is watertight.
+	struct MarchingCubesTable
+	{
+		std::array<std::array<std::int8_t, 16>, 256> triangles;
+
+		MarchingCubesTable()
+		{
+			int edgeIndex[8][8];
+
+			for (int i = 0; i < 12; i++)
+			{
+				edgeIndex[cubeEdges[i][0]][cubeEdges[i][1]] = i;
+				edgeIndex[cubeEdges[i][1]][cubeEdges[i][0]] = i;
+			}
+
+			// Corners of every face in counter-clockwise order seen from outside the cube
+			std::array<std::array<int, 4>, 6> faces;
+
+			for (int axis = 0; axis < 3; axis++)
+			{
+				for (int side = 0; side < 2; side++)
+				{
+					// Walk around the face in the plane spanned by the two other axes
+					const int u = 1 << ((axis + 1) % 3);
+					const int v = 1 << ((axis + 2) % 3);
+					const int base = side << axis;
+					std::array<int, 4> face = { base, base | u, base | u | v, base | v };
+
+					if (side == 0)
+						std::swap(face[1], face[3]);
+
+					faces[axis * 2 + side] = face;
+				}
+			}
+
+			for (int configuration = 0; configuration < 256; configuration++)
+			{
+				const auto inside = [configuration](int corner) { return (configuration >> corner) & 1; };
+
+				std::array<int, 12> next;
+				next.fill(-1);
+
+				for (const auto& face : faces)
+				{
+					for (int k = 0; k < 4; k++)
+					{
+						if (inside(face[k]) || !inside(face[(k + 1) % 4]))
+							continue;
+
+						// Entering the inside region, the segment ends where the walk leaves it again
+						for (int j = 1; j < 4; j++)
+						{
+							const int from = face[(k + j) % 4];
+							const int to = face[(k + j + 1) % 4];
+
+							if (inside(from) && !inside(to))
+							{
+								next[edgeIndex[face[k]][face[(k + 1) % 4]]] = edgeIndex[from][to];
+								break;
+							}
+						}
+					}
+				}
+
+				auto& entry = triangles[configuration];
+				entry.fill(-1);
+				int count = 0;
+
+				for (int start = 0; start < 12; start++)
+				{
+					if (next[start] < 0)
+						continue;
+
+					std::array<int, 12> polygon;
+					int size = 0;
+
+					for (int edge = start; next[edge] >= 0;)
+					{
+						polygon[size++] = edge;
+						const int following = next[edge];
+						next[edge] = -1;
+						edge = following;
+					}
+
+					for (int i = 1; i + 1 < size; i++)
+					{
+						entry[count++] = std::int8_t(polygon[0]);
+						entry[count++] = std::int8_t(polygon[i]);
+						entry[count++] = std::int8_t(polygon[i + 1]);
+					}
+				}
+			}
+		}
+	};
+
+	const MarchingCubesTable& marchingCubesTable()
+	{
+		static const MarchingCubesTable table;
+		return table;
+	}
+
+	std::uint64_t edgeKey(const ivec3& gridPoint, int axis)
+	{
+		constexpr std::int64_t bias = 1 << 19;
+		return std::uint64_t(gridPoint.x + bias) | (std::uint64_t(gridPoint.y + bias) << 20) | (std::uint64_t(gridPoint.z + bias) << 40) | (std::uint64_t(axis) << 60);
+	}
+
+	// Open addressing hash from edge keys to vertex indices, insertion is lock-free
+	class WeldTable
+	{
+	public:
+		static constexpr std::uint64_t emptyKey = ~std::uint64_t(0);
+		static constexpr glm::uint pendingIndex = ~glm::uint(0);
+
+		explicit WeldTable(std::size_t count)
+		{
+			m_capacity = std::bit_ceil(std::max<std::size_t>(2 * count, 16));
+			m_keys = std::make_unique<std::atomic<std::uint64_t>[]>(m_capacity);
+			m_indices = std::make_unique<std::atomic<glm::uint>[]>(m_capacity);
+
+			for (std::size_t i = 0; i < m_capacity; i++)
+			{
+				m_keys[i].store(emptyKey, std::memory_order_relaxed);
+				m_indices[i].store(pendingIndex, std::memory_order_relaxed);
+			}
+		}
+
+		// Returns the vertex index of the key and whether this call created it
+		std::pair<glm::uint, bool> insert(std::uint64_t key)
+		{
+			for (std::size_t slot = hash(key) & (m_capacity - 1);; slot = (slot + 1) & (m_capacity - 1))
+			{
+				std::uint64_t current = m_keys[slot].load(std::memory_order_acquire);
+
+				if (current == emptyKey)
+				{
+					if (m_keys[slot].compare_exchange_strong(current, key, std::memory_order_acq_rel))
+					{
+						const glm::uint index = m_count.fetch_add(1, std::memory_order_relaxed);
+						m_indices[slot].store(index, std::memory_order_release);
+						return { index, true };
+					}
+				}
+
+				if (current == key)
+				{
+					glm::uint index;
+
+					while ((index = m_indices[slot].load(std::memory_order_acquire)) == pendingIndex)
+						std::this_thread::yield();
+
+					return { index, false };
+				}
+			}
+		}
+
+		glm::uint count() const
+		{
+			return m_count.load();
+		}
+
+	private:
+		static std::uint64_t hash(std::uint64_t key)
+		{
+			key ^= key >> 33;
+			key *= 0xff51afd7ed558ccdull;
+			key ^= key >> 33;
+			key *= 0xc4ceb9fe1a85ec53ull;
+			key ^= key >> 33;
+			return key;
+		}
+
+		std::size_t m_capacity = 0;
+		std::unique_ptr<std::atomic<std::uint64_t>[]> m_keys;
+		std::unique_ptr<std::atomic<glm::uint>[]> m_indices;
+		std::atomic<glm::uint> m_count = 0;
+	};
+
+	struct BlockMesh
+	{
+		std::vector<std::uint64_t> keys;
+		std::vector<vec3> positions;
+		std::vector<vec3> normals;
+		std::vector<uvec3> triangles;
+	};
+}
+
+SurfaceMesher::SurfaceMesher(const DensityField& field) : m_field(field)
+{
+}
+
+Mesh SurfaceMesher::marchingCubes() const
+{
+	auto& pool = ThreadPool::instance();
+	const auto& table = marchingCubesTable();
+	const auto& blocks = m_field.blocks();
+	const float isovalue = m_field.isovalue();
+	const float spacing = m_field.spacing();
+
+	std::vector<BlockMesh> blockMeshes(blocks.size());
+
+	pool.parallelFor(blocks.size(), [&](std::size_t blockIndex) {
+		const ivec3 block = blocks[blockIndex];
+		std::vector<float> samples(DensityField::SampleCount);
+		m_field.sampleBlock(block, samples.data());
+
+		const auto sample = [&samples](const ivec3& p) {
+			return samples[DensityField::sampleIndex(p.x, p.y, p.z)];
+		};
+
+		// Skip blocks that are completely inside or outside
+		float minimum = sample(ivec3(0)), maximum = minimum;
+
+		for (int z = 0; z < PointSize; z++)
+		{
+			for (int y = 0; y < PointSize; y++)
+			{
+				for (int x = 0; x < PointSize; x++)
+				{
+					minimum = std::min(minimum, sample(ivec3(x, y, z)));
+					maximum = std::max(maximum, sample(ivec3(x, y, z)));
+				}
+			}
+		}
+
+		if (minimum > isovalue || maximum <= isovalue)
+			return;
+
+		const auto gradient = [&sample, spacing](const ivec3& p) {
+			return vec3(
+				sample(p + ivec3(1, 0, 0)) - sample(p - ivec3(1, 0, 0)),
+				sample(p + ivec3(0, 1, 0)) - sample(p - ivec3(0, 1, 0)),
+				sample(p + ivec3(0, 0, 1)) - sample(p - ivec3(0, 0, 1))) / (2.0f * spacing);
+		};
+
+		BlockMesh& mesh = blockMeshes[blockIndex];
+		std::vector<int> edgeVertices(PointSize * PointSize * PointSize * 3, -1);
+
+		// Vertices are unique within the block, so every edge is interpolated only once
+		const auto edgeVertex = [&](const ivec3& cell, int edge) {
+			const ivec3 p0 = cell + cornerOffset(cubeEdges[edge][0]);
+			const ivec3 p1 = cell + cornerOffset(cubeEdges[edge][1]);
+			const int axis = edge / 4;
+			int& vertex = edgeVertices[((p0.z * PointSize + p0.y) * PointSize + p0.x) * 3 + axis];
+
+			if (vertex < 0)
+			{
+				const float v0 = sample(p0);
+				const float v1 = sample(p1);
+				const float t = std::clamp((isovalue - v0) / (v1 - v0), 0.0f, 1.0f);
+				const ivec3 gridPoint = block * BlockSize + p0;
+
+				vec3 normal = -mix(gradient(p0), gradient(p1), t);
+				const float normalLength = length(normal);
+				normal = normalLength > 0.0f ? normal / normalLength : vec3(0.0f, 0.0f, 1.0f);
+
+				vertex = int(mesh.positions.size());
+				mesh.keys.push_back(edgeKey(gridPoint, axis));
+				mesh.positions.push_back(m_field.position(vec3(gridPoint) + t * vec3(cornerOffset(cubeEdges[edge][1]) - cornerOffset(cubeEdges[edge][0]))));
+				mesh.normals.push_back(normal);
+			}
+
+			return glm::uint(vertex);
+		};
+
+		for (int z = 0; z < BlockSize; z++)
+		{
+			for (int y = 0; y < BlockSize; y++)
+			{
+				for (int x = 0; x < BlockSize; x++)
+				{
+					const ivec3 cell(x, y, z);
+					int configuration = 0;
+
+					for (int corner = 0; corner < 8; corner++)
+					{
+						if (sample(cell + cornerOffset(corner)) > isovalue)
+							configuration |= 1 << corner;
+					}
+
+					const auto& triangles = table.triangles[configuration];
+
+					for (int i = 0; i < 16 && triangles[i] >= 0; i += 3)
+						mesh.triangles.push_back(uvec3(edgeVertex(cell, triangles[i]), edgeVertex(cell, triangles[i + 1]), edgeVertex(cell, triangles[i + 2])));
+				}
+			}
+		}
+	});
+
+	// Weld vertices on block boundaries through a shared lock-free table
+	std::size_t vertexCount = 0;
+	std::vector<std::size_t> triangleOffsets(blocks.size() + 1, 0);
+
+	for (std::size_t i = 0; i < blocks.size(); i++)
+	{
+		vertexCount += blockMeshes[i].positions.size();
+		triangleOffsets[i + 1] = triangleOffsets[i] + blockMeshes[i].triangles.size();
+	}
+
+	Mesh result;
+	result.positions.resize(vertexCount);
+	result.normals.resize(vertexCount);
+	result.triangles.resize(triangleOffsets.back());
+
+	WeldTable weldTable(vertexCount);
+
+	pool.parallelFor(blocks.size(), [&](std::size_t blockIndex) {
+		BlockMesh& mesh = blockMeshes[blockIndex];
+		std::vector<glm::uint> indices(mesh.positions.size());
+
+		for (std::size_t i = 0; i < mesh.positions.size(); i++)
+		{
+			const auto [index, created] = weldTable.insert(mesh.keys[i]);
+			indices[i] = index;
+
+			if (created)
+			{
+				result.positions[index] = mesh.positions[i];
+				result.normals[index] = mesh.normals[i];
+			}
+		}
+
+		for (std::size_t i = 0; i < mesh.triangles.size(); i++)
+		{
+			const uvec3& triangle = mesh.triangles[i];
+			result.triangles[triangleOffsets[blockIndex] + i] = uvec3(indices[triangle.x], indices[triangle.y], indices[triangle.z]);
+		}
+
+		mesh = BlockMesh();
+	});
+
+	result.positions.resize(weldTable.count());
+	result.normals.resize(weldTable.count());
+
+	return result;
+}
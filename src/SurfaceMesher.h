@@ -0,0 +1,20 @@
+#pragma once
+
+#include "DensityField.h"
+#include "Mesh.h"
+
+namespace dynamol
+{
+	// Extracts a triangle mesh of the isosurface of a density field, every block of the field is processed on the thread pool
+	class SurfaceMesher
+	{
+	public:
+		explicit SurfaceMesher(const DensityField& field);
+
+		// Marching cubes on the grid of the field, vertices shared between cells and blocks are welded
+		Mesh marchingCubes() const;
+
+	private:
+		const DensityField& m_field;
+	};
+}
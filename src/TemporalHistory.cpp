@@ -0,0 +1,86 @@
+#include "TemporalHistory.h"
+
+using namespace dynamol;
+using namespace gl;
+using namespace glm;
+using namespace globjects;
+
+void TemporalHistory::resize(const ivec2& size)
+{
+	if (m_textures[0][0] && size == m_size)
+		return;
+
+	m_size = max(size, ivec2(1));
+
+	for (auto& set : m_textures)
+	{
+		for (auto& texture : set)
+		{
+			texture = Texture::create(GL_TEXTURE_2D);
+			texture->setParameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			texture->setParameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			texture->setParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			texture->setParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			texture->storage2D(1, GL_RGBA32F, m_size);
+		}
+	}
+
+	invalidate();
+}
+
+void TemporalHistory::begin(const std::vector<float>& state)
+{
+	if (state != m_state)
+	{
+		m_state = state;
+		invalidate();
+	}
+}
+
+void TemporalHistory::end(const mat4& modelViewProjectionMatrix, const mat3& normalMatrix)
+{
+	m_modelViewProjectionMatrix = modelViewProjectionMatrix;
+	m_normalMatrix = normalMatrix;
+	m_current = 1 - m_current;
+
+	if (m_valid)
+		m_frame++;
+
+	m_valid = true;
+}
+
+void TemporalHistory::invalidate()
+{
+	m_valid = false;
+	m_frame = 0;
+}
+
+Texture* TemporalHistory::current(Target target) const
+{
+	return m_textures[m_current][target].get();
+}
+
+Texture* TemporalHistory::previous(Target target) const
+{
+	return m_textures[1 - m_current][target].get();
+}
+
+bool TemporalHistory::valid() const
+{
+	return m_valid;
+}
+
+std::uint32_t TemporalHistory::frame() const
+{
+	return m_frame;
+}
+
+const mat4& TemporalHistory::previousModelViewProjectionMatrix() const
+{
+	return m_modelViewProjectionMatrix;
+}
+
+const mat3& TemporalHistory::previousNormalMatrix() const
+{
+	return m_normalMatrix;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glbinding/gl/gl.h>
+#include <globjects/Texture.h>
+
+namespace dynamol
+{
+	// Surface and ambient occlusion targets of the previous frame for temporal reprojection. Two sets of targets are
+	// alternated: the passes of a frame render into the current set and reproject into the previous one, which holds
+	// the last frame together with the matrices it was rendered with. The history is dropped whenever the size or the
+	// state the surface depends on changes, so the first frame after a change is computed in full.
+	class TemporalHistory
+	{
+	public:
+		enum Target
+		{
+			Position, // world position and distance from the near plane, like the surface pass
+			Normal,   // view space normal and depth
+			Diffuse,
+			Ambient,  // resolved ambient occlusion
+			TargetCount
+		};
+
+		// Pixels are recomputed in one of every period frames, in subsets interleaved in 4x4 blocks (temporal.glsl)
+		static constexpr gl::GLuint MaximumPeriod = 16;
+
+		// Keeps the textures if the size is unchanged
+		void resize(const glm::ivec2& size);
+		// Starts a frame, the history is only kept if the state is the same as in the last frame
+		void begin(const std::vector<float>& state);
+		// Makes the current set the history of the next frame
+		void end(const glm::mat4& modelViewProjectionMatrix, const glm::mat3& normalMatrix);
+		void invalidate();
+
+		globjects::Texture* current(Target target) const;
+		globjects::Texture* previous(Target target) const;
+
+		bool valid() const;
+		// Counts the frames with history, selects the subset of pixels that is recomputed
+		std::uint32_t frame() const;
+		const glm::mat4& previousModelViewProjectionMatrix() const;
+		const glm::mat3& previousNormalMatrix() const;
+
+	private:
+		std::array<std::array<std::unique_ptr<globjects::Texture>, TargetCount>, 2> m_textures;
+		std::size_t m_current = 0;
+		glm::ivec2 m_size = glm::ivec2(0);
+		std::vector<float> m_state;
+		bool m_valid = false;
+		std::uint32_t m_frame = 0;
+		glm::mat4 m_modelViewProjectionMatrix = glm::mat4(1.0f);
+		glm::mat3 m_normalMatrix = glm::mat3(1.0f);
+	};
+}
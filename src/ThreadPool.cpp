@@ -0,0 +1,144 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+using namespace dynamol;
+
+namespace
+{
+	thread_local bool insideWorker = false;
+}
+
+ThreadPool& ThreadPool::instance()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+ThreadPool::ThreadPool(std::size_t threadCount)
+{
+	const std::size_t workerCount = std::max<std::size_t>(threadCount, 1) - 1;
+
+	for (std::size_t i = 0; i < workerCount; i++)
+		m_threads.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+
+	m_wake.notify_all();
+
+	for (auto& thread : m_threads)
+		thread.join();
+}
+
+std::size_t ThreadPool::threadCount() const
+{
+	return m_threads.size() + 1;
+}
+
+void ThreadPool::process(Job& job)
+{
+	for (;;)
+	{
+		const std::size_t begin = job.next.fetch_add(job.grainSize);
+
+		if (begin >= job.count)
+			break;
+
+		try
+		{
+			(*job.range)(begin, std::min(begin + job.grainSize, job.count));
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(job.exceptionMutex);
+
+			if (!job.exception)
+				job.exception = std::current_exception();
+
+			job.next = job.count;
+		}
+	}
+}
+
+void ThreadPool::run(std::size_t count, std::size_t grainSize, const std::function<void(std::size_t, std::size_t)>& range)
+{
+	if (count == 0)
+		return;
+
+	Job job;
+	job.count = count;
+	job.grainSize = std::max<std::size_t>(grainSize, 1);
+	job.range = &range;
+
+	// Nested calls and small jobs are executed on the calling thread
+	if (insideWorker || m_threads.empty() || count <= job.grainSize)
+	{
+		process(job);
+
+		if (job.exception)
+			std::rethrow_exception(job.exception);
+
+		return;
+	}
+
+	std::lock_guard<std::mutex> runLock(m_runMutex);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_job = &job;
+		m_finished = 0;
+		m_generation++;
+	}
+
+	m_wake.notify_all();
+
+	insideWorker = true;
+	process(job);
+	insideWorker = false;
+
+	// Every worker has to check in before the job goes out of scope
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done.wait(lock, [this] { return m_finished == m_threads.size(); });
+	m_job = nullptr;
+	lock.unlock();
+
+	if (job.exception)
+		std::rethrow_exception(job.exception);
+}
+
+void ThreadPool::work()
+{
+	insideWorker = true;
+	std::uint64_t generation = 0;
+
+	for (;;)
+	{
+		Job* job = nullptr;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [this, generation] { return m_stop || m_generation != generation; });
+
+			if (m_stop)
+				return;
+
+			generation = m_generation;
+			job = m_job;
+		}
+
+		process(*job);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_finished++;
+		}
+
+		m_done.notify_one();
+	}
+}
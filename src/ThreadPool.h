@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dynamol
+{
+	// Persistent worker threads for the CPU side algorithms, the calling thread always takes part in the work
+	class ThreadPool
+	{
+	public:
+		static ThreadPool& instance();
+
+		explicit ThreadPool(std::size_t threadCount = std::thread::hardware_concurrency());
+		~ThreadPool();
+
+		std::size_t threadCount() const;
+
+		// Calls body(i) for every i in [0, count), indices are handed out dynamically in chunks of grainSize.
+		// If body throws, the remaining chunks are skipped and the first exception is rethrown once all threads are done.
+		template <typename F>
+		void parallelFor(std::size_t count, F&& body, std::size_t grainSize = 1)
+		{
+			const std::function<void(std::size_t, std::size_t)> range = [&body](std::size_t begin, std::size_t end) {
+				for (std::size_t i = begin; i < end; i++)
+					body(i);
+			};
+
+			run(count, grainSize, range);
+		}
+
+	private:
+		struct Job
+		{
+			std::size_t count = 0;
+			std::size_t grainSize = 1;
+			std::atomic<std::size_t> next = 0;
+			const std::function<void(std::size_t, std::size_t)>* range = nullptr;
+			std::mutex exceptionMutex;
+			std::exception_ptr exception;
+		};
+
+		void run(std::size_t count, std::size_t grainSize, const std::function<void(std::size_t, std::size_t)>& range);
+		static void process(Job& job);
+		void work();
+
+		std::vector<std::thread> m_threads;
+		std::mutex m_runMutex;
+		std::mutex m_mutex;
+		std::condition_variable m_wake;
+		std::condition_variable m_done;
+		Job* m_job = nullptr;
+		std::uint64_t m_generation = 0;
+		std::size_t m_finished = 0;
+		bool m_stop = false;
+	};
+}
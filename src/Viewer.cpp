@@ -18,6 +18,7 @@
 #include "SphereRenderer.h"
 #include "ImageDepthScaleRenderer.h"
 #include "ScalableRenderer.h"
+#include "MeshRenderer.h"
 #include "Scene.h"
 #include "Protein.h"
 #include <fstream>
@@ -54,10 +55,14 @@ Viewer::Viewer(GLFWwindow *window, Scene *scene) : m_window(window), m_scene(sce
 	io.Fonts->AddFontFromFileTTF("./res/ui/Lato-Semibold.ttf", 18);
 
 	m_interactors.emplace_back(std::make_unique<CameraInteractor>(this));
-	m_renderers.emplace_back(std::make_unique<SphereRenderer>(this));
+	auto sphereRenderer = std::make_unique<SphereRenderer>(this);
+	const SphereRenderer* spheres = sphereRenderer.get();
+
+	m_renderers.emplace_back(std::move(sphereRenderer));
 	m_renderers.emplace_back(std::make_unique<BoundingBoxRenderer>(this));
 	m_renderers.emplace_back(std::make_unique<ScalableRenderer>(this))->setEnabled(false);
 	m_renderers.emplace_back(std::make_unique<ImageDepthScaleRenderer>(this))->setEnabled(false);
+	m_renderers.emplace_back(std::make_unique<MeshRenderer>(this, spheres))->setEnabled(false);
 
 	int i = 1;
 
@@ -72,6 +77,7 @@ Viewer::Viewer(GLFWwindow *window, Scene *scene) : m_window(window), m_scene(sce
 
 void Viewer::display()
 {
+	m_frameTimer.begin();
 	beginFrame();
 	mainMenu();
 
@@ -94,6 +100,7 @@ void Viewer::display()
 	}
 
 	endFrame();
+	m_frameTimer.end();
 }
 
 GLFWwindow * Viewer::window()
@@ -106,6 +113,11 @@ Scene* Viewer::scene()
 	return m_scene;
 }
 
+const GpuTimer& Viewer::frameTimer() const
+{
+	return m_frameTimer;
+}
+
 ivec2 Viewer::viewportSize() const
 {
 	int width, height;
@@ -11,6 +11,7 @@
 #include "Scene.h"
 #include "Interactor.h"
 #include "Renderer.h"
+#include "GpuTimer.h"
 
 namespace dynamol
 {
@@ -26,6 +27,9 @@ namespace dynamol
 
 		glm::ivec2 viewportSize() const;
 
+		// GPU time of whole frames, from the first command of display() to the user interface
+		const GpuTimer& frameTimer() const;
+
 		glm::vec3 backgroundColor() const;
 		glm::mat4 modelTransform() const;
 		glm::mat4 viewTransform() const;
@@ -66,6 +70,7 @@ namespace dynamol
 
 		std::vector<std::unique_ptr<Interactor>> m_interactors;
 		std::vector<std::unique_ptr<Renderer>> m_renderers;
+		GpuTimer m_frameTimer;
 
 		glm::vec3 m_backgroundColor = glm::vec3(0.2f, 0.2f, 0.2f);
 		glm::mat4 m_modelTransform = glm::mat4(1.0f);
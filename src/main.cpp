@@ -26,6 +26,7 @@
 #include "Viewer.h"
 #include "Interactor.h"
 #include "Renderer.h"
+#include "ShaderCompiler.h"
 
 using namespace gl;
 using namespace glm;
@@ -83,6 +84,9 @@ int main(int argc, char *argv[])
 		<< "OpenGL Vendor:   " << glbinding::aux::ContextInfo::vendor() << std::endl
 		<< "OpenGL Renderer: " << glbinding::aux::ContextInfo::renderer() << std::endl;
 
+	// Shader permutations are compiled ahead of time on a second context
+	ShaderCompiler::instance().start(window);
+
 	std::string fileName = "./dat/6b0x.pdb";
 
 	if (argc > 1)
@@ -119,6 +123,9 @@ int main(int argc, char *argv[])
 		glfwSwapBuffers(window);
 	}
 
+	viewer.reset();
+	ShaderCompiler::instance().stop();
+
 	// Destroy window
 	glfwDestroyWindow(window);
 
@@ -0,0 +1,234 @@
+#include "RayPacket.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Compares intersect() and intersectClosest() against the scalar reference paths over randomized packets and spheres,
+// including misses, tangent rays and ray origins inside a sphere, and times both paths.
+
+using namespace dynamol;
+using namespace glm;
+
+namespace
+{
+	constexpr std::size_t packetCount = 2048;
+	constexpr std::size_t sphereCount = 256;
+	constexpr int timingRepetitions = 4;
+
+	std::mt19937 generator(20231019u);
+
+	float uniform(float minimum, float maximum)
+	{
+		return std::uniform_real_distribution<float>(minimum, maximum)(generator);
+	}
+
+	vec3 uniformDirection()
+	{
+		const float z = uniform(-1.0f, 1.0f);
+		const float phi = uniform(0.0f, 6.2831853f);
+		const float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+		return vec3(r * std::cos(phi), r * std::sin(phi), z);
+	}
+
+	// Any unit vector perpendicular to direction
+	vec3 perpendicular(const vec3& direction)
+	{
+		const vec3 axis = std::abs(direction.x) < 0.5f ? vec3(1.0f, 0.0f, 0.0f) : vec3(0.0f, 1.0f, 0.0f);
+		return normalize(cross(direction, axis));
+	}
+
+	// Coherent packet: origins close to each other and directions around a common one, like the rays of a pixel block
+	RayPacket randomPacket()
+	{
+		RayPacket packet;
+		const vec3 origin = vec3(uniform(-20.0f, 20.0f), uniform(-20.0f, 20.0f), uniform(-20.0f, 20.0f));
+		const vec3 direction = uniformDirection();
+
+		for (std::size_t i = 0; i < RayPacket::Width; i++)
+		{
+			const vec3 laneOrigin = origin + vec3(uniform(-0.5f, 0.5f), uniform(-0.5f, 0.5f), uniform(-0.5f, 0.5f));
+			const vec3 laneDirection = normalize(direction + uniformDirection() * 0.2f);
+			packet.setRay(i, laneOrigin, laneDirection);
+		}
+
+		return packet;
+	}
+
+	// Random spheres around the packet together with spheres that are tangent to a lane, contain a lane origin or lie
+	// behind the packet
+	std::vector<vec4> randomSpheres(const RayPacket& packet)
+	{
+		std::vector<vec4> spheres;
+		const vec3 origin = packet.origin(0);
+
+		while (spheres.size() < sphereCount)
+		{
+			const std::size_t lane = spheres.size() % RayPacket::Width;
+			const vec3 laneOrigin = packet.origin(lane);
+			const vec3 laneDirection = packet.direction(lane);
+			const float radius = uniform(0.5f, 2.0f);
+
+			switch (spheres.size() % 8)
+			{
+			case 0:
+				// Tangent to the ray
+				spheres.push_back(vec4(laneOrigin + laneDirection * uniform(1.0f, 30.0f) + perpendicular(laneDirection) * radius, radius));
+				break;
+			case 1:
+				// Ray origin inside of the sphere
+				spheres.push_back(vec4(laneOrigin + uniformDirection() * uniform(0.0f, radius * 0.9f), radius));
+				break;
+			case 2:
+				// Behind the ray origin
+				spheres.push_back(vec4(laneOrigin - laneDirection * uniform(radius + 0.1f, 30.0f), radius));
+				break;
+			case 3:
+			case 4:
+				// Close to the ray, hit or narrowly missed
+				spheres.push_back(vec4(laneOrigin + laneDirection * uniform(1.0f, 30.0f) + uniformDirection() * uniform(0.0f, radius * 1.5f), radius));
+				break;
+			default:
+				spheres.push_back(vec4(origin + uniformDirection() * uniform(0.0f, 40.0f), radius));
+				break;
+			}
+		}
+
+		return spheres;
+	}
+
+	bool close(float a, float b)
+	{
+		return std::abs(a - b) <= 1e-5f * std::max(1.0f, std::max(std::abs(a), std::abs(b)));
+	}
+
+	bool equal(const PacketIntersection& a, const PacketIntersection& b)
+	{
+		if (a.mask != b.mask)
+			return false;
+
+		for (std::size_t i = 0; i < RayPacket::Width; i++)
+		{
+			if (!close(a.near[i], b.near[i]) || !close(a.far[i], b.far[i]))
+				return false;
+		}
+
+		return true;
+	}
+
+	// Indices have to match, except for spheres that are hit at the same distance and may be reported in either order
+	bool equal(const PacketHit& a, const PacketHit& b, const RayPacket& packet, const std::vector<vec4>& spheres)
+	{
+		if (a.mask != b.mask)
+			return false;
+
+		for (std::size_t i = 0; i < RayPacket::Width; i++)
+		{
+			if (!(a.mask >> i & 1u))
+			{
+				if (a.index[i] != b.index[i])
+					return false;
+
+				continue;
+			}
+
+			if (!close(a.distance[i], b.distance[i]) || a.index[i] >= spheres.size())
+				return false;
+
+			if (a.index[i] != b.index[i])
+			{
+				const PacketIntersection tie = intersectReference(packet, spheres[a.index[i]]);
+
+				if (!tie.hit(i) || !close(tie.near[i], b.distance[i]))
+					return false;
+			}
+		}
+
+		return true;
+	}
+
+	template <typename Function>
+	double milliseconds(Function function)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		for (int i = 0; i < timingRepetitions; i++)
+			function();
+
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / timingRepetitions;
+	}
+}
+
+int main()
+{
+	std::vector<RayPacket> packets;
+	std::vector<std::vector<vec4>> spheres;
+
+	for (std::size_t i = 0; i < packetCount; i++)
+	{
+		packets.push_back(randomPacket());
+		spheres.push_back(randomSpheres(packets.back()));
+		sortSpheres(spheres.back(), packets.back().origin(0));
+	}
+
+	std::size_t intersectionErrors = 0;
+	std::size_t closestErrors = 0;
+	std::size_t hits = 0;
+	std::size_t lanes = 0;
+
+	for (std::size_t i = 0; i < packetCount; i++)
+	{
+		for (const vec4& sphere : spheres[i])
+		{
+			const PacketIntersection intersection = intersect(packets[i], sphere);
+
+			if (!equal(intersection, intersectReference(packets[i], sphere)))
+				intersectionErrors++;
+
+			for (std::size_t lane = 0; lane < RayPacket::Width; lane++)
+				hits += intersection.hit(lane);
+
+			lanes += RayPacket::Width;
+		}
+
+		if (!equal(intersectClosest(packets[i], spheres[i].data(), sphereCount), intersectClosestReference(packets[i], spheres[i].data(), sphereCount), packets[i], spheres[i]))
+			closestErrors++;
+	}
+
+	std::printf("AVX2 kernels: %s\n", vectorizedPackets() ? "yes" : "no");
+	std::printf("intersect: %zu of %zu sphere tests differ from the reference (%zu of %zu lanes hit)\n", intersectionErrors, packetCount * sphereCount, hits, lanes);
+	std::printf("intersectClosest: %zu of %zu packets differ from the reference\n", closestErrors, packetCount);
+
+	// Keeps the timed calls from being optimized away
+	volatile std::uint32_t sink = 0;
+
+	const double intersectTime = milliseconds([&]() {
+		for (std::size_t i = 0; i < packetCount; i++)
+			for (const vec4& sphere : spheres[i])
+				sink = sink + intersect(packets[i], sphere).mask;
+	});
+
+	const double intersectReferenceTime = milliseconds([&]() {
+		for (std::size_t i = 0; i < packetCount; i++)
+			for (const vec4& sphere : spheres[i])
+				sink = sink + intersectReference(packets[i], sphere).mask;
+	});
+
+	const double closestTime = milliseconds([&]() {
+		for (std::size_t i = 0; i < packetCount; i++)
+			sink = sink + intersectClosest(packets[i], spheres[i].data(), sphereCount).mask;
+	});
+
+	const double closestReferenceTime = milliseconds([&]() {
+		for (std::size_t i = 0; i < packetCount; i++)
+			sink = sink + intersectClosestReference(packets[i], spheres[i].data(), sphereCount).mask;
+	});
+
+	std::printf("intersect: %.3f ms, reference %.3f ms (%.2fx)\n", intersectTime, intersectReferenceTime, intersectReferenceTime / intersectTime);
+	std::printf("intersectClosest: %.3f ms, reference %.3f ms (%.2fx)\n", closestTime, closestReferenceTime, closestReferenceTime / closestTime);
+
+	return intersectionErrors == 0 && closestErrors == 0 ? 0 : 1;
+}